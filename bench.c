@@ -0,0 +1,558 @@
+/*
+ * yjson_bench: parse, stringify and free throughput on generated corpora.
+ *
+ * The library is compiled into this program with counting allocators, so
+ * allocations and peak heap use are exact for every operation. Corpora are
+ * generated deterministically; extra files may be given on the command line.
+ * Results are a table by default, or one record per line with --csv/--json.
+ * With --reuse, documents are parsed with one yjson_parser per corpus, with
+ * --intern into one yjson_intern table per corpus.
+ */
+#define _POSIX_C_SOURCE 200112L /* clock_gettime() under -ansi */
+#include <stddef.h>
+
+static void* bench_malloc(size_t size);
+static void* bench_realloc(void* ptr, size_t size);
+static void bench_free(void* ptr);
+
+#define YJSON_MALLOC bench_malloc
+#define YJSON_REALLOC bench_realloc
+#define YJSON_FREE bench_free
+#include "yjson.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* not thread-safe: the benchmark never parses on more than one thread */
+typedef union { size_t size; double d; void* p; } bench_header;
+
+static size_t bench_allocs = 0;
+static size_t bench_bytes = 0;
+static size_t bench_peak = 0;
+
+static void* bench_malloc(size_t size) {
+    bench_header* h = (bench_header*)malloc(sizeof(bench_header) + size);
+    if (h == NULL)
+        return NULL;
+    h->size = size;
+    bench_allocs++;
+    if ((bench_bytes += size) > bench_peak)
+        bench_peak = bench_bytes;
+    return h + 1;
+}
+
+static void* bench_realloc(void* ptr, size_t size) {
+    bench_header* h;
+    size_t old;
+    if (ptr == NULL)
+        return bench_malloc(size);
+    old = ((bench_header*)ptr - 1)->size;
+    h = (bench_header*)realloc((bench_header*)ptr - 1, sizeof(bench_header) + size);
+    if (h == NULL)
+        return NULL;
+    h->size = size;
+    bench_allocs++;
+    if ((bench_bytes += size - old) > bench_peak)
+        bench_peak = bench_bytes;
+    return h + 1;
+}
+
+static void bench_free(void* ptr) {
+    bench_header* h;
+    if (ptr == NULL)
+        return;
+    h = (bench_header*)ptr - 1;
+    bench_bytes -= h->size;
+    free(h);
+}
+
+static double bench_now(void) {
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* growable output buffer for the generators */
+typedef struct {
+    char* s;
+    size_t len, size;
+} bench_buf;
+
+static void buf_grow(bench_buf* b, size_t n) {
+    if (b->len + n + 1 > b->size) {
+        while (b->len + n + 1 > b->size)
+            b->size = b->size ? b->size + (b->size >> 1) : 4096;
+        b->s = (char*)realloc(b->s, b->size);
+        if (b->s == NULL) {
+            fprintf(stderr, "yjson_bench: out of memory\n");
+            exit(1);
+        }
+    }
+}
+
+static void buf_puts(bench_buf* b, const char* s) {
+    size_t n = strlen(s);
+    buf_grow(b, n);
+    memcpy(b->s + b->len, s, n);
+    b->s[b->len += n] = '\0';
+}
+
+static void buf_printf(bench_buf* b, const char* format, double d) {
+    char tmp[128];
+    sprintf(tmp, format, d);
+    buf_puts(b, tmp);
+}
+
+/* deterministic, so every run and every commit sees the same bytes */
+static uint32_t bench_seed = 1;
+
+static uint32_t rnd(uint32_t n) {
+    bench_seed = bench_seed * 1103515245u + 12345u;
+    return (bench_seed >> 8) % n;
+}
+
+static void put_word(bench_buf* b) {
+    static const char* words[] = {
+        "json", "parse", "value", "stream", "array", "object", "number", "string",
+        "caf\xc3\xa9", "na\xc3\xafve", "\xe6\x97\xa5\xe6\x9c\xac", "\xf0\x9f\x98\x80", "tab\\t", "quote\\\"", "line\\n", "\\u00e9t\\u00e9"
+    };
+    buf_puts(b, words[rnd(sizeof(words) / sizeof(words[0]))]);
+}
+
+static void put_text(bench_buf* b, uint32_t words) {
+    uint32_t i;
+    buf_puts(b, "\"");
+    for (i = 0; i < words; i++) {
+        if (i > 0)
+            buf_puts(b, " ");
+        put_word(b);
+    }
+    buf_puts(b, "\"");
+}
+
+static void put_id(bench_buf* b) {
+    char tmp[32];
+    sprintf(tmp, "50587%07lu%07lu", (unsigned long)rnd(10000000), (unsigned long)rnd(10000000));
+    buf_puts(b, tmp);
+}
+
+/* geographic polygons: long runs of 17-digit doubles */
+static void gen_canada(bench_buf* b, size_t target) {
+    int first = 1;
+    buf_puts(b, "{\"type\":\"FeatureCollection\",\"features\":[");
+    while (b->len < target) {
+        int i;
+        if (!first)
+            buf_puts(b, ",");
+        first = 0;
+        buf_puts(b, "{\"type\":\"Feature\",\"properties\":{\"name\":\"Canada\"},"
+                    "\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[[");
+        for (i = 0; i < 1000; i++) {
+            buf_printf(b, i ? ",[%.17g" : "[%.17g", -140.0 + rnd(8000000) / 100000.0);
+            buf_printf(b, ",%.17g]", 42.0 + rnd(4000000) / 100000.0);
+        }
+        buf_puts(b, "]]}}");
+    }
+    buf_puts(b, "]}");
+}
+
+/* social media statuses: nested objects, 64-bit ids, short strings */
+static void gen_twitter(bench_buf* b, size_t target) {
+    int first = 1;
+    buf_puts(b, "{\"statuses\":[");
+    while (b->len < target) {
+        buf_puts(b, first ? "{\"metadata\":{\"result_type\":\"recent\",\"iso_language_code\":\"ja\"}," :
+                            ",{\"metadata\":{\"result_type\":\"recent\",\"iso_language_code\":\"ja\"},");
+        first = 0;
+        buf_puts(b, "\"created_at\":\"Sun Aug 31 00:29:15 +0000 2014\",\"id\":");
+        put_id(b);
+        buf_puts(b, ",\"id_str\":\"");
+        put_id(b);
+        buf_puts(b, "\",\"text\":");
+        put_text(b, 4 + rnd(16));
+        buf_puts(b, ",\"source\":\"<a href=\\\"https://example.com\\\" rel=\\\"nofollow\\\">client</a>\","
+                    "\"truncated\":false,\"in_reply_to_status_id\":null,\"user\":{\"id\":");
+        buf_printf(b, "%.0f", (double)rnd(2000000000));
+        buf_puts(b, ",\"name\":");
+        put_text(b, 1 + rnd(2));
+        buf_puts(b, ",\"screen_name\":\"user\",\"location\":\"\",\"description\":");
+        put_text(b, rnd(12));
+        buf_puts(b, ",\"protected\":false,\"followers_count\":");
+        buf_printf(b, "%.0f", (double)rnd(100000));
+        buf_puts(b, ",\"friends_count\":");
+        buf_printf(b, "%.0f", (double)rnd(10000));
+        buf_puts(b, ",\"verified\":false,\"lang\":\"ja\",\"profile_background_color\":\"C0DEED\"},"
+                    "\"geo\":null,\"coordinates\":null,\"retweet_count\":");
+        buf_printf(b, "%.0f", (double)rnd(1000));
+        buf_puts(b, ",\"entities\":{\"hashtags\":[],\"symbols\":[],\"urls\":[],\"user_mentions\":"
+                    "[{\"screen_name\":\"someone\",\"name\":\"Some One\",\"id\":");
+        buf_printf(b, "%.0f", (double)rnd(2000000000));
+        buf_puts(b, ",\"indices\":[3,13]}]},\"favorited\":false,\"retweeted\":false,\"lang\":\"ja\"}");
+    }
+    buf_puts(b, "]}");
+}
+
+/* event catalogue: objects keyed by numeric ids, integer arrays, nulls */
+static void gen_citm(bench_buf* b, size_t target) {
+    int first = 1;
+    buf_puts(b, "{\"areaNames\":{\"205705993\":\"Arri\xc3\xa8re-sc\xc3\xa8ne central\","
+                "\"205705994\":\"1er balcon central\"},\"events\":{");
+    while (b->len < target / 2) {
+        unsigned long id = 138586341ul + rnd(100000000);
+        buf_printf(b, first ? "\"%.0f\":" : ",\"%.0f\":", (double)id);
+        first = 0;
+        buf_printf(b, "{\"description\":null,\"id\":%.0f,\"logo\":null,\"name\":", (double)id);
+        put_text(b, 2 + rnd(4));
+        buf_puts(b, ",\"subTopicIds\":[337184269,337184283],\"subjectCode\":null,"
+                    "\"subtitle\":null,\"topicIds\":[324846099,107888604]}");
+    }
+    buf_puts(b, "},\"performances\":[");
+    first = 1;
+    while (b->len < target) {
+        int i, n = 1 + rnd(6);
+        buf_printf(b, first ? "{\"eventId\":%.0f" : ",{\"eventId\":%.0f", (double)(138586341ul + rnd(100000000)));
+        first = 0;
+        buf_printf(b, ",\"id\":%.0f,\"logo\":null,\"name\":null,\"prices\":[", (double)(339887544ul + rnd(1000000)));
+        for (i = 0; i < n; i++) {
+            buf_printf(b, i ? ",{\"amount\":%.0f" : "{\"amount\":%.0f", (double)(rnd(100) * 1000 + 250));
+            buf_puts(b, ",\"audienceSubCategoryId\":337100890,\"seatCategoryId\":338937295}");
+        }
+        buf_puts(b, "],\"seatCategories\":[{\"areas\":[{\"areaId\":205705999,\"blockIds\":[]}],"
+                    "\"seatCategoryId\":338937295}],\"seatMapImage\":null,\"start\":");
+        buf_printf(b, "%.0f", 1372701600000.0 + rnd(100000) * 1000.0);
+        buf_puts(b, ",\"venueCode\":\"PLEYEL_PLEYEL\"}");
+    }
+    buf_puts(b, "]}");
+}
+
+/* plain doubles and integers */
+static void gen_numbers(bench_buf* b, size_t target) {
+    buf_puts(b, "[");
+    while (b->len < target) {
+        if (b->len > 1)
+            buf_puts(b, ",");
+        switch (rnd(4)) {
+            case 0:  buf_printf(b, "%.0f", (double)rnd(1000)); break;
+            case 1:  buf_printf(b, "-%.0f", (double)rnd(2000000000)); break;
+            case 2:  buf_printf(b, "%.17g", rnd(1000000) / 7.0); break;
+            default: buf_printf(b, "%.6e", rnd(1000000) * 1e-3); break;
+        }
+    }
+    buf_puts(b, "]");
+}
+
+/* strings of all lengths, with escapes and multi-byte UTF-8 */
+static void gen_strings(bench_buf* b, size_t target) {
+    buf_puts(b, "[");
+    while (b->len < target) {
+        if (b->len > 1)
+            buf_puts(b, ",");
+        put_text(b, rnd(3) ? rnd(3) : 8 + rnd(64));
+    }
+    buf_puts(b, "]");
+}
+
+/* many deep, thin trees of arrays and objects */
+static void gen_nested(bench_buf* b, size_t target) {
+    buf_puts(b, "[");
+    while (b->len < target) {
+        int i, depth = 32 + rnd(96);
+        if (b->len > 1)
+            buf_puts(b, ",");
+        for (i = 0; i < depth; i++)
+            buf_puts(b, i & 1 ? "{\"k\":" : "[");
+        buf_puts(b, "null");
+        for (i = depth - 1; i >= 0; i--)
+            buf_puts(b, i & 1 ? "}" : ",true]");
+    }
+    buf_puts(b, "]");
+}
+
+/* one small record per document, NUL-separated */
+static void gen_small(bench_buf* b, size_t target) {
+    while (b->len < target) {
+        buf_printf(b, "{\"id\":%.0f,\"ok\":true,\"name\":", (double)rnd(1000000));
+        put_text(b, 1);
+        buf_printf(b, ",\"score\":%.17g,\"tags\":[\"a\",\"b\"],\"parent\":null}", rnd(1000) / 3.0);
+        b->len++; /* keep buf_puts()'s NUL as the separator */
+    }
+}
+
+typedef struct {
+    const char* name;
+    void (*generate)(bench_buf* b, size_t target);
+} bench_generator;
+
+static const bench_generator generators[] = {
+    { "canada",  gen_canada },
+    { "twitter", gen_twitter },
+    { "citm",    gen_citm },
+    { "numbers", gen_numbers },
+    { "strings", gen_strings },
+    { "nested",  gen_nested },
+    { "small",   gen_small }
+};
+
+typedef struct {
+    const char* corpus;
+    const char* op;
+    size_t bytes, docs, iterations, allocs, peak;
+    double seconds; /* best iteration */
+} bench_result;
+
+enum { FORMAT_TABLE, FORMAT_CSV, FORMAT_JSON };
+enum { MODE_PARSE, MODE_REUSE, MODE_INTERN };
+
+static void report(const bench_result* r, int format) {
+    double mbs = r->bytes / r->seconds / 1e6, dps = r->docs / r->seconds;
+    switch (format) {
+        case FORMAT_CSV:
+            printf("%s,%s,%lu,%lu,%lu,%.9f,%.3f,%.1f,%lu,%lu\n", r->corpus, r->op,
+                (unsigned long)r->bytes, (unsigned long)r->docs, (unsigned long)r->iterations,
+                r->seconds, mbs, dps, (unsigned long)r->allocs, (unsigned long)r->peak);
+            break;
+        case FORMAT_JSON:
+            printf("{\"corpus\":\"%s\",\"op\":\"%s\",\"bytes\":%lu,\"docs\":%lu,\"iterations\":%lu,"
+                "\"seconds\":%.9f,\"mb_per_s\":%.3f,\"docs_per_s\":%.1f,\"allocs\":%lu,\"peak_bytes\":%lu}\n",
+                r->corpus, r->op, (unsigned long)r->bytes, (unsigned long)r->docs, (unsigned long)r->iterations,
+                r->seconds, mbs, dps, (unsigned long)r->allocs, (unsigned long)r->peak);
+            break;
+        default:
+            printf("%-12s %-10s %10.1f %12.0f %12lu %12lu\n", r->corpus, r->op, mbs, dps,
+                (unsigned long)r->allocs, (unsigned long)r->peak);
+            break;
+    }
+    fflush(stdout);
+}
+
+/* runs parse, stringify and free over the NUL-terminated documents in json[0..len) */
+static int bench_corpus(const char* name, const char* json, size_t len, double min_time, int format, int mode) {
+    size_t docs = 0, i, iter, out_bytes = 0;
+    const char** d;
+    yjson_value* v;
+    yjson_parser* p = mode == MODE_REUSE ? yjson_parser_create() : NULL;
+    yjson_intern* in = mode == MODE_INTERN ? yjson_intern_create(16) : NULL;
+    bench_result parse, stringify, release;
+    double total[3];
+
+    for (i = 0; i < len; i += strlen(json + i) + 1)
+        docs++;
+    d = (const char**)malloc(docs * sizeof(const char*));
+    v = (yjson_value*)malloc(docs * sizeof(yjson_value));
+    for (i = docs = 0; i < len; i += strlen(json + i) + 1)
+        d[docs++] = json + i;
+
+    parse.corpus = stringify.corpus = release.corpus = name;
+    parse.op = p ? "parse_with" : in ? "parse_intern" : "parse";
+    stringify.op = "stringify";
+    release.op = "free";
+    parse.docs = stringify.docs = release.docs = docs;
+    parse.bytes = release.bytes = len - docs;
+    parse.seconds = stringify.seconds = release.seconds = 1e300;
+    total[0] = total[1] = total[2] = 0.0;
+
+    for (iter = 0; iter == 0 || total[0] + total[1] + total[2] < min_time; iter++) {
+        size_t allocs, base;
+        double t;
+
+        allocs = bench_allocs;
+        bench_peak = base = bench_bytes;
+        t = bench_now();
+        for (i = 0; i < docs; i++) {
+            int ret;
+            yjson_init(&v[i]);
+            if (p)
+                ret = yjson_parse_with(p, &v[i], d[i]);
+            else if (in)
+                ret = yjson_parse_intern(&v[i], d[i], in);
+            else
+                ret = yjson_parse(&v[i], d[i]);
+            if (ret != YJSON_PARSE_OK) {
+                fprintf(stderr, "yjson_bench: %s: document %lu does not parse (%d)\n", name, (unsigned long)i, ret);
+                while (i > 0)
+                    yjson_free(&v[--i]);
+                yjson_parser_destroy(p);
+                yjson_intern_destroy(in);
+                free(d);
+                free(v);
+                return 1;
+            }
+        }
+        t = bench_now() - t;
+        total[0] += t;
+        if (t < parse.seconds)
+            parse.seconds = t;
+        parse.allocs = bench_allocs - allocs;
+        parse.peak = bench_peak - base;
+
+        allocs = bench_allocs;
+        bench_peak = base = bench_bytes;
+        out_bytes = 0;
+        t = bench_now();
+        for (i = 0; i < docs; i++) {
+            size_t n;
+            char* s = yjson_stringify(&v[i], &n);
+            out_bytes += n;
+            bench_free(s);
+        }
+        t = bench_now() - t;
+        total[1] += t;
+        if (t < stringify.seconds)
+            stringify.seconds = t;
+        stringify.allocs = bench_allocs - allocs;
+        stringify.peak = bench_peak - base;
+
+        allocs = bench_allocs;
+        bench_peak = base = bench_bytes;
+        t = bench_now();
+        for (i = 0; i < docs; i++)
+            yjson_free(&v[i]);
+        t = bench_now() - t;
+        total[2] += t;
+        if (t < release.seconds)
+            release.seconds = t;
+        release.allocs = bench_allocs - allocs;
+        release.peak = bench_peak - base;
+    }
+    stringify.bytes = out_bytes;
+    parse.iterations = stringify.iterations = release.iterations = iter;
+    yjson_parser_destroy(p);
+    yjson_intern_destroy(in);
+    free(d);
+    free(v);
+    if (bench_bytes != 0) {
+        fprintf(stderr, "yjson_bench: %s: %lu bytes leaked\n", name, (unsigned long)bench_bytes);
+        return 1;
+    }
+    /* clamp to the clock resolution so tiny corpora do not divide by zero */
+    if (parse.seconds <= 0.0) parse.seconds = 1e-9;
+    if (stringify.seconds <= 0.0) stringify.seconds = 1e-9;
+    if (release.seconds <= 0.0) release.seconds = 1e-9;
+    report(&parse, format);
+    report(&stringify, format);
+    report(&release, format);
+    return 0;
+}
+
+static char* load_file(const char* path, size_t* len) {
+    FILE* f = fopen(path, "rb");
+    char* s;
+    long n;
+    if (f == NULL || fseek(f, 0, SEEK_END) != 0 || (n = ftell(f)) < 0) {
+        if (f)
+            fclose(f);
+        return NULL;
+    }
+    rewind(f);
+    s = (char*)malloc((size_t)n + 1);
+    if (s == NULL || fread(s, 1, (size_t)n, f) != (size_t)n) {
+        free(s);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    s[n] = '\0';
+    *len = (size_t)n + 1;
+    return s;
+}
+
+static void usage(void) {
+    size_t i;
+    fprintf(stderr,
+        "usage: yjson_bench [options] [file.json ...]\n"
+        "  --size MB      size of each generated corpus (default 4)\n"
+        "  --time SEC     minimum time spent on each corpus (default 1)\n"
+        "  --corpus NAME  run one generated corpus only:");
+    for (i = 0; i < sizeof(generators) / sizeof(generators[0]); i++)
+        fprintf(stderr, " %s", generators[i].name);
+    fprintf(stderr,
+        "\n"
+        "  --reuse        parse with one yjson_parser per corpus\n"
+        "  --intern       parse into one yjson_intern table per corpus\n"
+        "  --csv, --json  machine-readable output, one line per corpus and op\n"
+        "Files named on the command line replace the generated corpora.\n");
+}
+
+int main(int argc, char* argv[]) {
+    double size = 4.0, min_time = 1.0;
+    const char* only = NULL;
+    int format = FORMAT_TABLE, mode = MODE_PARSE, files = 0, ret = 0, i;
+    size_t g;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            size = atof(argv[++i]);
+        else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc)
+            min_time = atof(argv[++i]);
+        else if (strcmp(argv[i], "--corpus") == 0 && i + 1 < argc)
+            only = argv[++i];
+        else if (strcmp(argv[i], "--csv") == 0)
+            format = FORMAT_CSV;
+        else if (strcmp(argv[i], "--json") == 0)
+            format = FORMAT_JSON;
+        else if (strcmp(argv[i], "--reuse") == 0)
+            mode = MODE_REUSE;
+        else if (strcmp(argv[i], "--intern") == 0)
+            mode = MODE_INTERN;
+        else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        }
+        else
+            files++;
+    }
+
+#ifndef NDEBUG
+    fprintf(stderr, "yjson_bench: assertions are enabled; build with -DCMAKE_BUILD_TYPE=Release for real numbers\n");
+#endif
+    if (format == FORMAT_CSV)
+        printf("corpus,op,bytes,docs,iterations,seconds,mb_per_s,docs_per_s,allocs,peak_bytes\n");
+    else if (format == FORMAT_TABLE)
+        printf("%-12s %-10s %10s %12s %12s %12s\n", "corpus", "op", "MB/s", "docs/s", "allocs", "peak bytes");
+
+    if (files > 0) {
+        for (i = 1; i < argc; i++) {
+            size_t len;
+            char* json;
+            if (strcmp(argv[i], "--size") == 0 || strcmp(argv[i], "--time") == 0 || strcmp(argv[i], "--corpus") == 0) {
+                i++;
+                continue;
+            }
+            if (argv[i][0] == '-')
+                continue;
+            if ((json = load_file(argv[i], &len)) == NULL) {
+                fprintf(stderr, "yjson_bench: cannot read %s\n", argv[i]);
+                return 1;
+            }
+            ret |= bench_corpus(argv[i], json, len, min_time, format, mode);
+            free(json);
+        }
+        return ret;
+    }
+
+    for (g = 0; g < sizeof(generators) / sizeof(generators[0]); g++) {
+        bench_buf b;
+        if (only && strcmp(only, generators[g].name) != 0)
+            continue;
+        b.s = NULL;
+        b.len = b.size = 0;
+        bench_seed = 1;
+        generators[g].generate(&b, (size_t)(size * 1e6));
+        if (b.len == 0) {
+            /* --size 0: some generators emit nothing at all */
+            free(b.s);
+            continue;
+        }
+        if (b.s[b.len - 1] != '\0')
+            b.len++; /* the last document's NUL */
+        ret |= bench_corpus(generators[g].name, b.s, b.len, min_time, format, mode);
+        free(b.s);
+    }
+    return ret;
+}
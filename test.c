@@ -1,6 +1,17 @@
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(YJSON_NO_THREADS)
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* pthreads under -ansi */
+#endif
+#define TEST_THREADS
+#include <pthread.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#ifdef TEST_THREADS
+#include <time.h>
+#endif
 #include "yjson.h"
 
 static int main_ret = 0;
@@ -24,6 +35,9 @@ static int test_pass = 0;
 #define EXPECT_EQ_DOUBLE(expect, actual) EXPECT_EQ_BASE((expect) == (actual), expect, actual, "%.17g")
 #define EXPECT_EQ_STRING(expect, actual, alength) \
     EXPECT_EQ_BASE(sizeof(expect) - 1 == alength && memcmp(expect, actual, alength) == 0, expect, actual, "%s")
+#define EXPECT_TRUE(actual) EXPECT_EQ_BASE((actual) != 0, "true", "false", "%s")
+#define EXPECT_FALSE(actual) EXPECT_EQ_BASE((actual) == 0, "false", "true", "%s")
+#define EXPECT_EQ_SIZE_T(expect, actual) EXPECT_EQ_BASE((expect) == (actual), (unsigned long)(expect), (unsigned long)(actual), "%lu")
 
 
 
@@ -102,6 +116,98 @@ static void test_parse_number()
     TEST_NUMBER( 1.7976931348623157e+308, "1.7976931348623157e+308");
     TEST_NUMBER(-1.7976931348623157e+308, "-1.7976931348623157e+308");
 
+    TEST_NUMBER(0.1, "0.1");
+    TEST_NUMBER(0.30000000000000004, "0.30000000000000004");
+    TEST_NUMBER(1e23, "1e23");
+    TEST_NUMBER(1e-5, "0.00001");
+    TEST_NUMBER(123456789012345678901234567890.0, "123456789012345678901234567890");
+    TEST_NUMBER(1.2345678901234567, "1.23456789012345678901234567890");
+    TEST_NUMBER(9007199254740992.0, "9007199254740993"); /* halfway, rounds to even */
+    TEST_NUMBER(1.0, "1.00000000000000011102230246251565404236316680908203125");
+    TEST_NUMBER(1.0000000000000002, "1.00000000000000011102230246251565404236316680908203126");
+    TEST_NUMBER(2.2250738585072011e-308, "2.2250738585072011e-308");
+    TEST_NUMBER(0.0, "2.4703282292062327e-324");
+    TEST_NUMBER(4.9406564584124654e-324, "2.4703282292062328e-324");
+    TEST_NUMBER(1.7976931348623157e+308, "1.7976931348623158e+308");
+}
+
+#define TEST_INT64(expect, json)\
+    do {\
+        yjson_value v;\
+        yjson_init(&v);\
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, json));\
+        EXPECT_EQ_INT(YJSON_NUMBER, yjson_get_type(&v));\
+        EXPECT_TRUE(yjson_is_int64(&v));\
+        EXPECT_TRUE(yjson_get_int64(&v) == (expect));\
+    } while(0)
+
+#define TEST_UINT64(expect, json)\
+    do {\
+        yjson_value v;\
+        yjson_init(&v);\
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, json));\
+        EXPECT_EQ_INT(YJSON_NUMBER, yjson_get_type(&v));\
+        EXPECT_TRUE(yjson_is_uint64(&v));\
+        EXPECT_TRUE(yjson_get_uint64(&v) == (expect));\
+    } while(0)
+
+static void test_parse_integer() {
+    yjson_value v;
+
+    TEST_INT64(0, "0");
+    TEST_INT64(1, "1");
+    TEST_INT64(-1, "-1");
+    TEST_INT64(INT64_C(9007199254740993), "9007199254740993");
+    TEST_INT64(INT64_C(1700000000123456789), "1700000000123456789");
+    TEST_INT64(INT64_MAX, "9223372036854775807");
+    TEST_INT64(INT64_MIN, "-9223372036854775808");
+    TEST_UINT64(UINT64_C(9223372036854775808), "9223372036854775808");
+    TEST_UINT64(UINT64_MAX, "18446744073709551615");
+
+    /* beyond 64 bits, fractions, exponents and -0 stay doubles */
+    yjson_init(&v);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, "18446744073709551616"));
+    EXPECT_FALSE(yjson_is_uint64(&v));
+    EXPECT_EQ_DOUBLE(18446744073709551616.0, yjson_get_number(&v));
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, "-9223372036854775809"));
+    EXPECT_FALSE(yjson_is_int64(&v));
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, "1.0"));
+    EXPECT_FALSE(yjson_is_int64(&v));
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, "1e2"));
+    EXPECT_FALSE(yjson_is_int64(&v));
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, "-0"));
+    EXPECT_FALSE(yjson_is_int64(&v));
+
+    /* the double accessor still works on integers */
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, "-42"));
+    EXPECT_EQ_DOUBLE(-42.0, yjson_get_number(&v));
+    EXPECT_FALSE(yjson_is_uint64(&v));
+}
+
+/* every double printed with 17 digits must come back bit for bit */
+static void test_parse_number_roundtrip() {
+    uint64_t x = UINT64_C(88172645463325252);
+    char buf[32];
+    double d, r;
+    int i, bad = 0;
+    for (i = 0; i < 100000; i++) {
+        yjson_value v;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        memcpy(&d, &x, sizeof(d));
+        if (d != d || d - d != 0)
+            continue;
+        sprintf(buf, "%.17g", d);
+        yjson_init(&v);
+        if (yjson_parse(&v, buf) != YJSON_PARSE_OK)
+            bad++;
+        else {
+            r = yjson_get_number(&v);
+            bad += memcmp(&d, &r, sizeof(d)) != 0;
+        }
+    }
+    EXPECT_EQ_INT(0, bad);
 }
 
 #define TEST_STRING(expect, json)\
@@ -152,6 +258,8 @@ static void test_parse_root_not_sigular()
 static void test_parse_number_too_big() {
     TEST_ERROR(YJSON_PARSE_NUMBER_TOO_BIG, "1e309");
     TEST_ERROR(YJSON_PARSE_NUMBER_TOO_BIG, "-1e309");
+    TEST_ERROR(YJSON_PARSE_NUMBER_TOO_BIG, "1.7976931348623159e+308");
+    TEST_ERROR(YJSON_PARSE_NUMBER_TOO_BIG, "1e100000000000");
 }
 static void test_access_null() {
     yjson_value v;
@@ -164,15 +272,1421 @@ static void test_access_null() {
 static void test_parse_missing_quotation_mark() {
     TEST_ERROR(YJSON_PARSE_MISS_QUOTATION_MARK, "\"");
     TEST_ERROR(YJSON_PARSE_MISS_QUOTATION_MARK, "\"abc");
+    TEST_ERROR(YJSON_PARSE_MISS_QUOTATION_MARK, "\"0123456789abcdef0123456789abcdef0123456789abcdef");
+}
+
+static void test_parse_invalid_string_char() {
+    TEST_ERROR(YJSON_PARSE_INVALID_STRING_CHAR, "\"\x01\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_STRING_CHAR, "\"\x1F\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_STRING_CHAR, "\"0123456789abcdef0123456789abcdef\x1F\"");
+}
+
+static void test_parse_whitespace() {
+    TEST_NUMBER(1.0, "                                                                1");
+    TEST_NUMBER(1.0, "\n\t\r \n\t\r \n\t\r \n\t\r \n\t\r \n\t\r \n\t\r \n\t\r \n\t\r 1\n\t\r \n\t\r \n\t\r \n\t\r ");
+    TEST_ERROR(YJSON_PARSE_EXPECT_VALUE, "                                                                   ");
+    TEST_ERROR(YJSON_PARSE_ROOT_NOT_SINGULAR, "1                                                       x");
 }
 
 static void test_parse_string() {
     TEST_STRING("", "\"\"");
     TEST_STRING("Hello", "\"Hello\"");
+    /* long runs cross several vector blocks before hitting the quote */
+    TEST_STRING("0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef!",
+        "\"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef!\"");
+    TEST_STRING("0123456789abcdef0123456789abcdef\n0123456789abcdef0123456789abcdef\\",
+        "\"0123456789abcdef0123456789abcdef\\n0123456789abcdef0123456789abcdef\\\\\"");
 
     TEST_STRING("Hello\nWorld", "\"Hello\\nWorld\"");
     TEST_STRING("\" \\ / \b \f \n \r \t", "\"\\\" \\\\ \\/ \\b \\f \\n \\r \\t\"");
+    TEST_STRING("Hello\0World", "\"Hello\\u0000World\"");
+    TEST_STRING("\x24", "\"\\u0024\"");         /* Dollar sign U+0024 */
+    TEST_STRING("\xC2\xA2", "\"\\u00A2\"");     /* Cents sign U+00A2 */
+    TEST_STRING("\xE2\x82\xAC", "\"\\u20AC\""); /* Euro sign U+20AC */
+    TEST_STRING("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\"");  /* G clef sign U+1D11E */
+    TEST_STRING("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\"");  /* G clef sign U+1D11E */
+    TEST_STRING("\xF4\x8F\xBF\xBF!", "\"\\uDBFF\\uDFFF!\""); /* U+10FFFF */
+}
+
+static void test_parse_invalid_unicode_hex() {
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u0\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u01\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u012\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u/000\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\uG000\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u0/00\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u0G00\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u00/0\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u00G0\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u000/\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u000G\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u 123\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_HEX, "\"\\uD800\\u12\"");
+}
+
+static void test_parse_invalid_unicode_surrogate() {
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDBFF\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\\\\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uDBFF\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uE000\"");
+    TEST_ERROR(YJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDC00\"");
+}
+
+#define TEST_UTF8(error, json)\
+    do {\
+        yjson_value v;\
+        yjson_init(&v);\
+        EXPECT_EQ_INT(error, yjson_parse_ex(&v, json, strlen(json), YJSON_PARSE_VALIDATE_UTF8));\
+        yjson_free(&v);\
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, json));\
+        yjson_free(&v);\
+    } while(0)
+
+static void test_parse_validate_utf8() {
+    TEST_UTF8(YJSON_PARSE_OK, "\"\x7F \xC2\x80 \xDF\xBF \xE0\xA0\x80 \xED\x9F\xBF \xEE\x80\x80 \xF0\x90\x80\x80 \xF4\x8F\xBF\xBF\"");
+    TEST_UTF8(YJSON_PARSE_OK, "{\"\xE4\xBD\xA0\xE5\xA5\xBD\":\"0123456789abcdef0123456789abcdef\xC3\xA9\\n\xC3\xA9\"}");
+    TEST_UTF8(YJSON_PARSE_INVALID_UTF8, "\"\x80\"");                 /* lone continuation */
+    TEST_UTF8(YJSON_PARSE_INVALID_UTF8, "\"\xC0\xAF\"");             /* overlong '/' */
+    TEST_UTF8(YJSON_PARSE_INVALID_UTF8, "\"\xC1\xBF\"");
+    TEST_UTF8(YJSON_PARSE_INVALID_UTF8, "\"\xE0\x9F\xBF\"");         /* overlong */
+    TEST_UTF8(YJSON_PARSE_INVALID_UTF8, "\"\xED\xA0\x80\"");         /* surrogate */
+    TEST_UTF8(YJSON_PARSE_INVALID_UTF8, "\"\xF0\x8F\xBF\xBF\"");     /* overlong */
+    TEST_UTF8(YJSON_PARSE_INVALID_UTF8, "\"\xF4\x90\x80\x80\"");     /* above U+10FFFF */
+    TEST_UTF8(YJSON_PARSE_INVALID_UTF8, "\"\xF5\x80\x80\x80\"");
+    TEST_UTF8(YJSON_PARSE_INVALID_UTF8, "\"\xFF\"");
+    TEST_UTF8(YJSON_PARSE_INVALID_UTF8, "\"\xE4\xBD\"");             /* cut short by the quote */
+    TEST_UTF8(YJSON_PARSE_INVALID_UTF8, "\"\xE4\\n\xBD\xA0\"");     /* cut short by an escape */
+    TEST_UTF8(YJSON_PARSE_INVALID_UTF8, "[\"ok\",{\"0123456789abcdef0123456789abcdef\xC3\":1}]");
+}
+
+static void test_parse_array() {
+    size_t i, j;
+    yjson_value v;
+
+    yjson_init(&v);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, "[ ]"));
+    EXPECT_EQ_INT(YJSON_ARRAY, yjson_get_type(&v));
+    EXPECT_EQ_SIZE_T(0, yjson_get_array_size(&v));
+    yjson_free(&v);
+
+    yjson_init(&v);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, "[ null , false , true , 123 , \"abc\" ]"));
+    EXPECT_EQ_INT(YJSON_ARRAY, yjson_get_type(&v));
+    EXPECT_EQ_SIZE_T(5, yjson_get_array_size(&v));
+    EXPECT_EQ_INT(YJSON_NULL,   yjson_get_type(yjson_get_array_element(&v, 0)));
+    EXPECT_EQ_INT(YJSON_FALSE,  yjson_get_type(yjson_get_array_element(&v, 1)));
+    EXPECT_EQ_INT(YJSON_TRUE,   yjson_get_type(yjson_get_array_element(&v, 2)));
+    EXPECT_EQ_INT(YJSON_NUMBER, yjson_get_type(yjson_get_array_element(&v, 3)));
+    EXPECT_EQ_INT(YJSON_STRING, yjson_get_type(yjson_get_array_element(&v, 4)));
+    EXPECT_EQ_DOUBLE(123.0, yjson_get_number(yjson_get_array_element(&v, 3)));
+    EXPECT_EQ_STRING("abc", yjson_get_string(yjson_get_array_element(&v, 4)), yjson_get_string_length(yjson_get_array_element(&v, 4)));
+    /* children live in one contiguous block */
+    EXPECT_TRUE(yjson_get_array_element(&v, 4) == yjson_get_array_element(&v, 0) + 4);
+    yjson_free(&v);
+
+    yjson_init(&v);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, "[ [ ] , [ 0 ] , [ 0 , 1 ] , [ 0 , 1 , 2 ] ]"));
+    EXPECT_EQ_INT(YJSON_ARRAY, yjson_get_type(&v));
+    EXPECT_EQ_SIZE_T(4, yjson_get_array_size(&v));
+    for (i = 0; i < 4; i++) {
+        yjson_value* a = yjson_get_array_element(&v, i);
+        EXPECT_EQ_INT(YJSON_ARRAY, yjson_get_type(a));
+        EXPECT_EQ_SIZE_T(i, yjson_get_array_size(a));
+        for (j = 0; j < i; j++) {
+            yjson_value* e = yjson_get_array_element(a, j);
+            EXPECT_EQ_INT(YJSON_NUMBER, yjson_get_type(e));
+            EXPECT_EQ_DOUBLE((double)j, yjson_get_number(e));
+        }
+    }
+    yjson_free(&v);
+}
+
+static void test_parse_object() {
+    yjson_value v;
+    size_t i;
+
+    yjson_init(&v);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, " { } "));
+    EXPECT_EQ_INT(YJSON_OBJECT, yjson_get_type(&v));
+    EXPECT_EQ_SIZE_T(0, yjson_get_object_size(&v));
+    yjson_free(&v);
+
+    yjson_init(&v);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v,
+        " { "
+        "\"n\" : null , "
+        "\"f\" : false , "
+        "\"t\" : true , "
+        "\"i\" : 123 , "
+        "\"s\" : \"abc\", "
+        "\"a\" : [ 1, 2, 3 ],"
+        "\"o\" : { \"1\" : 1, \"2\" : 2, \"3\" : 3 }"
+        " } "
+    ));
+    EXPECT_EQ_INT(YJSON_OBJECT, yjson_get_type(&v));
+    EXPECT_EQ_SIZE_T(7, yjson_get_object_size(&v));
+    EXPECT_EQ_STRING("n", yjson_get_object_key(&v, 0), yjson_get_object_key_length(&v, 0));
+    EXPECT_EQ_INT(YJSON_NULL,   yjson_get_type(yjson_get_object_value(&v, 0)));
+    EXPECT_EQ_STRING("f", yjson_get_object_key(&v, 1), yjson_get_object_key_length(&v, 1));
+    EXPECT_EQ_INT(YJSON_FALSE,  yjson_get_type(yjson_get_object_value(&v, 1)));
+    EXPECT_EQ_STRING("t", yjson_get_object_key(&v, 2), yjson_get_object_key_length(&v, 2));
+    EXPECT_EQ_INT(YJSON_TRUE,   yjson_get_type(yjson_get_object_value(&v, 2)));
+    EXPECT_EQ_STRING("i", yjson_get_object_key(&v, 3), yjson_get_object_key_length(&v, 3));
+    EXPECT_EQ_INT(YJSON_NUMBER, yjson_get_type(yjson_get_object_value(&v, 3)));
+    EXPECT_EQ_DOUBLE(123.0, yjson_get_number(yjson_get_object_value(&v, 3)));
+    EXPECT_EQ_STRING("s", yjson_get_object_key(&v, 4), yjson_get_object_key_length(&v, 4));
+    EXPECT_EQ_INT(YJSON_STRING, yjson_get_type(yjson_get_object_value(&v, 4)));
+    EXPECT_EQ_STRING("abc", yjson_get_string(yjson_get_object_value(&v, 4)), yjson_get_string_length(yjson_get_object_value(&v, 4)));
+    EXPECT_EQ_STRING("a", yjson_get_object_key(&v, 5), yjson_get_object_key_length(&v, 5));
+    EXPECT_EQ_INT(YJSON_ARRAY, yjson_get_type(yjson_get_object_value(&v, 5)));
+    EXPECT_EQ_SIZE_T(3, yjson_get_array_size(yjson_get_object_value(&v, 5)));
+    for (i = 0; i < 3; i++) {
+        yjson_value* e = yjson_get_array_element(yjson_get_object_value(&v, 5), i);
+        EXPECT_EQ_INT(YJSON_NUMBER, yjson_get_type(e));
+        EXPECT_EQ_DOUBLE(i + 1.0, yjson_get_number(e));
+    }
+    EXPECT_EQ_STRING("o", yjson_get_object_key(&v, 6), yjson_get_object_key_length(&v, 6));
+    {
+        yjson_value* o = yjson_get_object_value(&v, 6);
+        EXPECT_EQ_INT(YJSON_OBJECT, yjson_get_type(o));
+        for (i = 0; i < 3; i++) {
+            yjson_value* ov = yjson_get_object_value(o, i);
+            EXPECT_TRUE('1' + i == yjson_get_object_key(o, i)[0]);
+            EXPECT_EQ_SIZE_T(1, yjson_get_object_key_length(o, i));
+            EXPECT_EQ_INT(YJSON_NUMBER, yjson_get_type(ov));
+            EXPECT_EQ_DOUBLE(i + 1.0, yjson_get_number(ov));
+        }
+    }
+    yjson_free(&v);
+}
+
+static void test_parse_miss_comma_or_square_bracket() {
+    TEST_ERROR(YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1");
+    TEST_ERROR(YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1}");
+    TEST_ERROR(YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1 2");
+    TEST_ERROR(YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[[]");
+}
+
+static void test_parse_miss_key() {
+    TEST_ERROR(YJSON_PARSE_MISS_KEY, "{:1,");
+    TEST_ERROR(YJSON_PARSE_MISS_KEY, "{1:1,");
+    TEST_ERROR(YJSON_PARSE_MISS_KEY, "{true:1,");
+    TEST_ERROR(YJSON_PARSE_MISS_KEY, "{false:1,");
+    TEST_ERROR(YJSON_PARSE_MISS_KEY, "{null:1,");
+    TEST_ERROR(YJSON_PARSE_MISS_KEY, "{[]:1,");
+    TEST_ERROR(YJSON_PARSE_MISS_KEY, "{{}:1,");
+    TEST_ERROR(YJSON_PARSE_MISS_KEY, "{\"a\":1,");
+}
+
+static void test_parse_miss_colon() {
+    TEST_ERROR(YJSON_PARSE_MISS_COLON, "{\"a\"}");
+    TEST_ERROR(YJSON_PARSE_MISS_COLON, "{\"a\",\"b\"}");
+}
+
+static void test_parse_miss_comma_or_curly_bracket() {
+    TEST_ERROR(YJSON_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":1");
+    TEST_ERROR(YJSON_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":1]");
+    TEST_ERROR(YJSON_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":1 \"b\"");
+    TEST_ERROR(YJSON_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":{}");
+}
+
+/* depth copies of open, then inner, then depth copies of close */
+static char* nested_json(size_t depth, const char* open, const char* inner, const char* close) {
+    size_t no = strlen(open), ni = strlen(inner), nc = strlen(close), i;
+    char* json = (char*)malloc(depth * (no + nc) + ni + 1);
+    char* p = json;
+    for (i = 0; i < depth; i++, p += no)
+        memcpy(p, open, no);
+    memcpy(p, inner, ni);
+    p += ni;
+    for (i = 0; i < depth; i++, p += nc)
+        memcpy(p, close, nc);
+    *p = '\0';
+    return json;
+}
+
+/* arrays and objects nest at most 1024 deep, the default YJSON_PARSE_MAX_DEPTH */
+static void test_parse_too_deep() {
+    yjson_value v;
+    char* json;
+
+    json = nested_json(1024, "[", "1", "]");
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, json));
+    yjson_free(&v);
+    free(json);
+    json = nested_json(1025, "[", "1", "]");
+    TEST_ERROR(YJSON_PARSE_TOO_DEEP, json);
+    free(json);
+    json = nested_json(512, "{\"a\":[", "", "]}");
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, json));
+    yjson_free(&v);
+    free(json);
+    json = nested_json(513, "{\"a\":[", "", "]}");
+    TEST_ERROR(YJSON_PARSE_TOO_DEEP, json);
+    free(json);
+    /* deep enough to overflow the C stack without the limit */
+    json = nested_json(1000000, "[", "", "]");
+    TEST_ERROR(YJSON_PARSE_TOO_DEEP, json);
+    EXPECT_EQ_INT(YJSON_PARSE_TOO_DEEP, yjson_parse_n(&v, json, 2000000));
+    free(json);
+}
+
+static void test_find_object_value() {
+    yjson_value v;
+    yjson_arena a;
+    char json[2048];
+    size_t i, n, sizes[2];
+    int k;
+
+    yjson_init(&v);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, "{\"a\":1,\"\":2,\"a\\\"b\":3,\"a\":4}"));
+    EXPECT_EQ_INT(1, (int)yjson_get_int64(yjson_find_object_value(&v, "a", 1)));
+    EXPECT_EQ_INT(2, (int)yjson_get_int64(yjson_find_object_value(&v, "", 0)));
+    EXPECT_EQ_INT(3, (int)yjson_get_int64(yjson_find_object_value(&v, "a\"b", 3)));
+    EXPECT_TRUE(yjson_find_object_value(&v, "ab", 2) == NULL);
+    yjson_free(&v);
+
+    /* one object under the index threshold, one well over it */
+    sizes[0] = 5;
+    sizes[1] = 100;
+    yjson_arena_init(&a, NULL, 0);
+    for (k = 0; k < 2; k++) {
+        n = sprintf(json, "{");
+        for (i = 0; i < sizes[k]; i++)
+            n += sprintf(json + n, "%s\"key%lu\":%lu", i ? "," : "", (unsigned long)i, (unsigned long)i);
+        n += sprintf(json + n, ",\"key0\":-1}");
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, json));
+        EXPECT_EQ_INT(k ? YJSON_FLAG_INDEXED : 0, v.flags & YJSON_FLAG_INDEXED);
+        for (i = 0; i < sizes[k]; i++) {
+            char key[32];
+            sprintf(key, "key%lu", (unsigned long)i);
+            EXPECT_EQ_INT((int)i, (int)yjson_get_int64(yjson_find_object_value(&v, key, strlen(key))));
+        }
+        EXPECT_TRUE(yjson_find_object_value(&v, "key", 3) == NULL);
+        EXPECT_TRUE(yjson_find_object_value(&v, "key100", 6) == NULL);
+        yjson_free(&v);
+
+        /* the index lives in the same block as the members, arena included */
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_arena(&v, json, &a));
+        EXPECT_EQ_INT(-1, (int)yjson_get_int64(yjson_get_object_value(&v, sizes[k])));
+        EXPECT_EQ_INT(3, (int)yjson_get_int64(yjson_find_object_value(&v, "key3", 4)));
+        yjson_arena_reset(&a);
+    }
+    yjson_arena_free(&a);
+}
+
+static void test_parse_arena() {
+    static const char json[] = "{\"name\":\"yjson\",\"tags\":[\"a\",\"b\",\"c\"],\"n\":1.5}";
+    char buf[1024];
+    yjson_arena a;
+    char* block;
+    yjson_value v, *e;
+    int i;
+
+    /* caller-supplied buffer: nothing is malloc'd for the document */
+    yjson_arena_init(&a, buf, sizeof(buf));
+    for (i = 0; i < 3; i++) {
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_arena(&v, json, &a));
+        EXPECT_EQ_INT(YJSON_OBJECT, yjson_get_type(&v));
+        EXPECT_EQ_SIZE_T(3, yjson_get_object_size(&v));
+        EXPECT_EQ_STRING("yjson", yjson_get_string(yjson_get_object_value(&v, 0)), yjson_get_string_length(yjson_get_object_value(&v, 0)));
+        e = yjson_get_array_element(yjson_get_object_value(&v, 1), 2);
+        EXPECT_EQ_STRING("c", yjson_get_string(e), yjson_get_string_length(e));
+        EXPECT_TRUE(yjson_get_object_key(&v, 0) >= buf && yjson_get_object_key(&v, 0) < buf + sizeof(buf));
+        EXPECT_TRUE(a.head == NULL);
+        yjson_arena_reset(&a);
+    }
+    yjson_arena_free(&a);
+
+    /* library-owned blocks are coalesced on reset and reused afterwards */
+    yjson_arena_init(&a, NULL, 0);
+    a.block_size = 16;
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_arena(&v, json, &a));
+    yjson_arena_reset(&a);
+    block = a.buf;
+    EXPECT_TRUE(block != NULL);
+    for (i = 0; i < 3; i++) {
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_arena(&v, json, &a));
+        EXPECT_EQ_DOUBLE(1.5, yjson_get_number(yjson_get_object_value(&v, 2)));
+        EXPECT_TRUE(a.buf == block);
+        yjson_arena_reset(&a);
+    }
+
+    /* arena values can still be modified and freed like any other value */
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_arena(&v, json, &a));
+    yjson_set_string(yjson_get_object_value(&v, 0), "heap", 4);
+    yjson_free(&v);
+    EXPECT_EQ_INT(YJSON_NULL, yjson_get_type(&v));
+
+    EXPECT_EQ_INT(YJSON_PARSE_ROOT_NOT_SINGULAR, yjson_parse_arena(&v, "[\"x\"] x", &a));
+    EXPECT_EQ_INT(YJSON_PARSE_MISS_COMMA_OR_CURLY_BRACKET, yjson_parse_arena(&v, "{\"a\":[1],\"b\":\"c\"", &a));
+    yjson_arena_free(&a);
+}
+
+static void test_parse_with() {
+    static const char json[] = "{\"id\":7,\"tags\":[\"a\",\"b\"],\"s\":\"x\\ty\"}";
+    yjson_parser* p = yjson_parser_create();
+    yjson_value v;
+    char big[1024];
+    int i;
+#ifdef YJSON_STATS
+    yjson_stats s;
+#endif
+
+    for (i = 0; i < 3; i++) {
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_with(p, &v, json));
+        EXPECT_EQ_INT(YJSON_OBJECT, yjson_get_type(&v));
+        EXPECT_EQ_SIZE_T(3, yjson_get_object_size(&v));
+        EXPECT_EQ_STRING("x\ty", yjson_get_string(yjson_get_object_value(&v, 2)), yjson_get_string_length(yjson_get_object_value(&v, 2)));
+#ifdef YJSON_STATS
+        /* the stack is only grown by the first call */
+        yjson_get_stats(&s);
+        EXPECT_EQ_SIZE_T(i == 0 ? 1 : 0, s.stack_grows);
+#endif
+        yjson_free(&v);
+    }
+    EXPECT_EQ_INT(YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, yjson_parse_with(p, &v, "[1 2]"));
+
+    /* a stack beyond the limit is shrunk, and grown again when needed */
+    yjson_parser_set_max_stack(p, 16);
+    memset(big, 'a', sizeof(big));
+    big[0] = big[sizeof(big) - 2] = '\"';
+    big[1] = '\\';
+    big[2] = 'n';
+    big[sizeof(big) - 1] = '\0';
+    for (i = 0; i < 2; i++) {
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_with(p, &v, big));
+        EXPECT_EQ_SIZE_T(sizeof(big) - 4, yjson_get_string_length(&v));
+        yjson_free(&v);
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_with(p, &v, json));
+        yjson_free(&v);
+    }
+    yjson_parser_set_max_stack(p, 0);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_with(p, &v, json));
+    yjson_free(&v);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_with(p, &v, json));
+    yjson_free(&v);
+    yjson_parser_destroy(p);
+
+    /* with an arena the values, and the kept stack, are the arena's */
+    {
+        yjson_arena a;
+        yjson_arena_init(&a, NULL, 0);
+        p = yjson_parser_create();
+        yjson_parser_set_arena(p, &a);
+        for (i = 0; i < 3; i++) {
+            EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_with(p, &v, json));
+            EXPECT_TRUE(v.flags & YJSON_FLAG_EXTERNAL);
+            EXPECT_EQ_STRING("x\ty", yjson_get_string(yjson_get_object_value(&v, 2)), yjson_get_string_length(yjson_get_object_value(&v, 2)));
+            EXPECT_TRUE(a.stack != NULL);
+            yjson_arena_reset(&a);
+        }
+        yjson_parser_set_arena(p, NULL);
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_with(p, &v, json));
+        EXPECT_FALSE(v.flags & YJSON_FLAG_EXTERNAL);
+        yjson_free(&v);
+        yjson_parser_destroy(p);
+        yjson_arena_free(&a);
+    }
+}
+
+static void test_parse_insitu() {
+    char json[] = "{\"plain\":\"Hello\",\"esc\":\"a\\tb\\\"c\\\\\",\"list\":[\"\",\"x\\ny\"]}";
+    yjson_value v, *e;
+
+    yjson_init(&v);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_insitu(&v, json));
+    EXPECT_EQ_INT(YJSON_OBJECT, yjson_get_type(&v));
+    EXPECT_EQ_SIZE_T(3, yjson_get_object_size(&v));
+    EXPECT_EQ_STRING("plain", yjson_get_object_key(&v, 0), yjson_get_object_key_length(&v, 0));
+    EXPECT_EQ_STRING("esc", yjson_get_object_key(&v, 1), yjson_get_object_key_length(&v, 1));
+    e = yjson_get_object_value(&v, 0);
+    EXPECT_EQ_STRING("Hello", yjson_get_string(e), yjson_get_string_length(e));
+    EXPECT_TRUE(yjson_get_string(e) == json + 10);
+    EXPECT_TRUE(yjson_get_string(e)[5] == '\0');
+    e = yjson_get_object_value(&v, 1);
+    EXPECT_EQ_STRING("a\tb\"c\\", yjson_get_string(e), yjson_get_string_length(e));
+    EXPECT_TRUE(yjson_get_string(e) > json && yjson_get_string(e) < json + sizeof(json));
+    e = yjson_get_array_element(yjson_get_object_value(&v, 2), 0);
+    EXPECT_EQ_STRING("", yjson_get_string(e), yjson_get_string_length(e));
+    e = yjson_get_array_element(yjson_get_object_value(&v, 2), 1);
+    EXPECT_EQ_STRING("x\ny", yjson_get_string(e), yjson_get_string_length(e));
+    yjson_free(&v);
+
+    {
+        char unicode[] = "\"\\u20AC\\uD834\\uDD1E\"";
+        char bad[] = "[\"ok\", \"bad\\x\"]";
+        char trailing[] = "\"abc\" x";
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_insitu(&v, unicode));
+        EXPECT_EQ_STRING("\xE2\x82\xAC\xF0\x9D\x84\x9E", yjson_get_string(&v), yjson_get_string_length(&v));
+        EXPECT_TRUE(yjson_get_string(&v) == unicode + 1);
+        yjson_free(&v);
+        EXPECT_EQ_INT(YJSON_PARSE_INVALID_STRING_ESCAPE, yjson_parse_insitu(&v, bad));
+        EXPECT_EQ_INT(YJSON_NULL, yjson_get_type(&v));
+        EXPECT_EQ_INT(YJSON_PARSE_ROOT_NOT_SINGULAR, yjson_parse_insitu(&v, trailing));
+        EXPECT_EQ_INT(YJSON_NULL, yjson_get_type(&v));
+    }
+}
+
+/* parses json[0, len) from an exact-size copy so that reads past it are caught */
+static int parse_n_exact(yjson_value* v, const char* json, size_t len) {
+    char* buf = (char*)malloc(len ? len : 1);
+    int ret;
+    memcpy(buf, json, len);
+    ret = yjson_parse_n(v, buf, len);
+    free(buf);
+    return ret;
+}
+
+#define TEST_PARSE_N(expect, json, len)\
+    do {\
+        yjson_value v;\
+        yjson_init(&v);\
+        EXPECT_EQ_INT(expect, parse_n_exact(&v, json, len));\
+        yjson_free(&v);\
+    } while(0)
+
+/* every prefix fails or succeeds exactly as the same text terminated */
+static void test_parse_n_prefixes(const char* json) {
+    size_t len = strlen(json), i;
+    yjson_value v;
+    for (i = 0; i <= len; i++) {
+        char* prefix = (char*)malloc(i + 1);
+        int expect;
+        memcpy(prefix, json, i);
+        prefix[i] = '\0';
+        yjson_init(&v);
+        expect = yjson_parse(&v, prefix);
+        yjson_free(&v);
+        TEST_PARSE_N(expect, json, i);
+        free(prefix);
+    }
+}
+
+static void test_parse_n() {
+    yjson_value v;
+
+    test_parse_n_prefixes("{\"a\":[1,true,null,\"x\\ty\"],\"b\":-1.5e3} ");
+    /* runs long enough for the vector scanners, cut off at every byte */
+    test_parse_n_prefixes("[\"0123456789abcdef0123456789abcdef\\uD834\\uDD1E\",\n"
+        "                                        -12.5e-1, false]");
+
+    /* an embedded '\0' is not the end of the input */
+    TEST_PARSE_N(YJSON_PARSE_EXPECT_VALUE, "", 0);
+    TEST_PARSE_N(YJSON_PARSE_INVALID_VALUE, "\0", 1);
+    TEST_PARSE_N(YJSON_PARSE_INVALID_VALUE, "[\0]", 3);
+    TEST_PARSE_N(YJSON_PARSE_ROOT_NOT_SINGULAR, "null\0", 5);
+    TEST_PARSE_N(YJSON_PARSE_ROOT_NOT_SINGULAR, "1 \0", 3);
+    TEST_PARSE_N(YJSON_PARSE_INVALID_STRING_CHAR, "\"a\0b\"", 5);
+    TEST_PARSE_N(YJSON_PARSE_MISS_QUOTATION_MARK, "\"ab\"", 3);
+    TEST_PARSE_N(YJSON_PARSE_OK, "truex", 4);
+
+    /* bytes after len are never looked at */
+    yjson_init(&v);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_n(&v, "[1,2]345", 5));
+    EXPECT_EQ_SIZE_T(2, yjson_get_array_size(&v));
+    yjson_free(&v);
+
+    /* a padded buffer is parsed in place */
+    {
+        char buf[] = "{\"k\":\"v\"}\0\0\0";
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_ex(&v, buf, 9, YJSON_PARSE_PADDED));
+        EXPECT_EQ_STRING("v", yjson_get_string(yjson_get_object_value(&v, 0)), 1);
+        yjson_free(&v);
+        EXPECT_EQ_INT(YJSON_PARSE_INVALID_STRING_CHAR, yjson_parse_ex(&v, "[\"\0\"]", 5, YJSON_PARSE_PADDED));
+    }
+}
+
+/* records SAX events as text, e.g. "{ k:a [ 1 null ]2 }1" */
+typedef struct {
+    char buf[256];
+    size_t len;
+    const char* stop_key;
+} sax_recorder;
+
+static void sax_append(sax_recorder* r, const char* s, size_t len) {
+    if (r->len > 0)
+        r->buf[r->len++] = ' ';
+    memcpy(r->buf + r->len, s, len);
+    r->buf[r->len += len] = '\0';
+}
+
+static int sax_null(void* user) { sax_append((sax_recorder*)user, "null", 4); return 0; }
+static int sax_boolean(void* user, int b) { sax_append((sax_recorder*)user, b ? "true" : "false", b ? 4 : 5); return 0; }
+static int sax_start_object(void* user) { sax_append((sax_recorder*)user, "{", 1); return 0; }
+static int sax_start_array(void* user) { sax_append((sax_recorder*)user, "[", 1); return 0; }
+
+static int sax_number(void* user, const yjson_value* n) {
+    char s[32];
+    if (yjson_is_int64(n))
+        sprintf(s, "%ld", (long)yjson_get_int64(n));
+    else
+        sprintf(s, "%g", yjson_get_number(n));
+    sax_append((sax_recorder*)user, s, strlen(s));
+    return 0;
+}
+
+static int sax_string(void* user, const char* s, size_t len) {
+    sax_append((sax_recorder*)user, s, len);
+    return 0;
+}
+
+static int sax_key(void* user, const char* k, size_t len) {
+    sax_recorder* r = (sax_recorder*)user;
+    sax_append(r, k, len);
+    r->buf[r->len++] = ':';
+    r->buf[r->len] = '\0';
+    return r->stop_key != NULL && strlen(r->stop_key) == len && memcmp(r->stop_key, k, len) == 0;
+}
+
+static int sax_end_object(void* user, size_t size) {
+    char s[32];
+    sprintf(s, "}%lu", (unsigned long)size);
+    sax_append((sax_recorder*)user, s, strlen(s));
+    return 0;
+}
+
+static int sax_end_array(void* user, size_t size) {
+    char s[32];
+    sprintf(s, "]%lu", (unsigned long)size);
+    sax_append((sax_recorder*)user, s, strlen(s));
+    return 0;
+}
+
+#define TEST_SAX(expect, events, json)\
+    do {\
+        sax_recorder r;\
+        r.len = 0;\
+        r.buf[0] = '\0';\
+        r.stop_key = NULL;\
+        EXPECT_EQ_INT(expect, yjson_parse_sax(json, &handler, &r));\
+        EXPECT_EQ_STRING(events, r.buf, r.len);\
+    } while(0)
+
+static void test_parse_sax() {
+    yjson_handler handler;
+    char* deep;
+    handler.null_value = sax_null;
+    handler.boolean = sax_boolean;
+    handler.number = sax_number;
+    handler.string = sax_string;
+    handler.start_object = sax_start_object;
+    handler.key = sax_key;
+    handler.end_object = sax_end_object;
+    handler.start_array = sax_start_array;
+    handler.end_array = sax_end_array;
+
+    TEST_SAX(YJSON_PARSE_OK, "null", " null ");
+    TEST_SAX(YJSON_PARSE_OK, "-12", "-12");
+    TEST_SAX(YJSON_PARSE_OK, "1.5", "1.5");
+    TEST_SAX(YJSON_PARSE_OK, "a\tb", "\"a\\tb\"");
+    TEST_SAX(YJSON_PARSE_OK, "[ ]0", "[ ]");
+    TEST_SAX(YJSON_PARSE_OK, "{ }0", "{ }");
+    TEST_SAX(YJSON_PARSE_OK, "[ true false [ [ ]0 ]1 ]3", "[true, false, [[]]]");
+    TEST_SAX(YJSON_PARSE_OK, "{ n: null s: abc o: { x\"y: 1 }1 a: [ 1 2 ]2 }4",
+        "{\"n\":null,\"s\":\"abc\",\"o\":{\"x\\\"y\":1},\"a\":[1,2]}");
+
+    /* errors match yjson_parse(); events up to the error are delivered */
+    TEST_SAX(YJSON_PARSE_EXPECT_VALUE, "", " ");
+    TEST_SAX(YJSON_PARSE_ROOT_NOT_SINGULAR, "null", "null x");
+    TEST_SAX(YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[ 1", "[1}");
+    TEST_SAX(YJSON_PARSE_MISS_KEY, "{", "{1:1}");
+    TEST_SAX(YJSON_PARSE_MISS_COLON, "{ a:", "{\"a\" 1}");
+    TEST_SAX(YJSON_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{ a: 1", "{\"a\":1 ]");
+    TEST_SAX(YJSON_PARSE_INVALID_STRING_ESCAPE, "[", "[\"\\v\"]");
+
+    /* a callback stops the parse early */
+    {
+        sax_recorder r;
+        r.len = 0;
+        r.stop_key = "id";
+        EXPECT_EQ_INT(YJSON_PARSE_CANCELED, yjson_parse_sax("{\"name\":\"x\",\"id\":7,\"junk\":[", &handler, &r));
+        EXPECT_EQ_STRING("{ name: x id:", r.buf, r.len);
+    }
+
+    /* callbacks may be left out */
+    memset(&handler, 0, sizeof(handler));
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_sax("{\"a\":[1,\"b\",null]}", &handler, NULL));
+
+    /* nesting is bounded as in yjson_parse() */
+    deep = nested_json(1024, "[", "", "]");
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_sax(deep, &handler, NULL));
+    free(deep);
+    deep = nested_json(513, "{\"a\":[", "", "]}");
+    EXPECT_EQ_INT(YJSON_PARSE_TOO_DEEP, yjson_parse_sax(deep, &handler, NULL));
+    free(deep);
+    deep = nested_json(1000000, "[", "", "]");
+    EXPECT_EQ_INT(YJSON_PARSE_TOO_DEEP, yjson_parse_sax(deep, &handler, NULL));
+    free(deep);
+}
+
+static void test_parse_intern() {
+    yjson_intern* t = yjson_intern_create(4);
+    yjson_value v1, v2;
+    const char* name;
+
+    yjson_init(&v1);
+    yjson_init(&v2);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_intern(&v1, "[{\"name\":\"ok\",\"id\":1},{\"name\":\"long value\",\"id\":2}]", t));
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_intern(&v2, "{\"id\":3,\"name\":\"ok\"}", t));
+
+    /* equal keys, and short values, are one pointer across documents */
+    name = yjson_intern_string(t, "name", 4);
+    EXPECT_TRUE(yjson_get_object_key(yjson_get_array_element(&v1, 0), 0) == name);
+    EXPECT_TRUE(yjson_get_object_key(yjson_get_array_element(&v1, 1), 0) == name);
+    EXPECT_TRUE(yjson_get_object_key(&v2, 1) == name);
+    EXPECT_TRUE(yjson_get_object_key(&v2, 0) == yjson_get_object_key(yjson_get_array_element(&v1, 0), 1));
+    EXPECT_TRUE(yjson_get_string(yjson_get_object_value(&v2, 1)) ==
+        yjson_get_string(yjson_get_object_value(yjson_get_array_element(&v1, 0), 0)));
+    EXPECT_EQ_STRING("ok", yjson_intern_string(t, "ok", 2), 2);
+
+    /* longer values are still copied per document */
+    EXPECT_EQ_STRING("long value", yjson_get_string(yjson_get_object_value(yjson_get_array_element(&v1, 1), 0)), 10);
+    EXPECT_FALSE(yjson_get_string(yjson_get_object_value(yjson_get_array_element(&v1, 1), 0)) ==
+        yjson_intern_string(t, "long value", 10));
+
+    /* errors leave nothing behind but table entries */
+    yjson_free(&v1);
+    EXPECT_EQ_INT(YJSON_PARSE_MISS_COLON, yjson_parse_intern(&v1, "{\"a\":\"b\",\"c\" 1}", t));
+    EXPECT_TRUE(yjson_intern_string(t, "", 0) != NULL);
+
+    /* pointers stay put while the table grows */
+    {
+        const char* first[300];
+        char key[32];
+        int i, same = 1;
+        for (i = 0; i < 300; i++) {
+            sprintf(key, "k%d", i);
+            first[i] = yjson_intern_string(t, key, strlen(key));
+        }
+        for (i = 0; i < 300; i++) {
+            sprintf(key, "k%d", i);
+            same &= first[i] == yjson_intern_string(t, key, strlen(key));
+        }
+        EXPECT_TRUE(same);
+        EXPECT_TRUE(yjson_get_object_key(&v2, 1) == name);
+    }
+
+    /* the documents may outlive each other, not the table */
+    yjson_free(&v2);
+    yjson_intern_destroy(t);
+}
+
+/* feeds json to a stream in the given pieces; returns the finish result */
+static int stream_parse(yjson_stream* s, yjson_value* v, const char* json, size_t step, size_t split) {
+    size_t len = strlen(json), i = 0, n;
+    int ret = YJSON_PARSE_NEED_MORE, first = 1;
+    while ((first || i < len) && (ret == YJSON_PARSE_NEED_MORE || ret == YJSON_PARSE_OK)) {
+        char* chunk;
+        n = step ? step : (first ? split : len - i);
+        first = 0;
+        if (n > len - i)
+            n = len - i;
+        /* an exact-size copy so that reads past a chunk are caught */
+        chunk = (char*)malloc(n + 1);
+        memcpy(chunk, json + i, n);
+        ret = yjson_stream_feed(s, chunk, n);
+        free(chunk);
+        i += n;
+    }
+    return yjson_stream_finish(s, v);
+}
+
+/* counts the ways of splitting json that disagree with yjson_parse() */
+static int stream_mismatches(yjson_stream* s, const char* json) {
+    size_t len = strlen(json), split;
+    int expect, mismatches = 0;
+    char* json1 = NULL;
+    yjson_value v;
+
+    yjson_init(&v);
+    if ((expect = yjson_parse(&v, json)) == YJSON_PARSE_OK)
+        json1 = yjson_stringify(&v, NULL);
+    yjson_free(&v);
+    for (split = 0; split <= len + 1; split++) {
+        /* split == len + 1 feeds one byte at a time */
+        int ret = split <= len ? stream_parse(s, &v, json, 0, split) : stream_parse(s, &v, json, 1, 0);
+        if (ret != expect)
+            mismatches++;
+        else if (ret == YJSON_PARSE_OK) {
+            char* json2 = yjson_stringify(&v, NULL);
+            if (strcmp(json1, json2) != 0)
+                mismatches++;
+            free(json2);
+        }
+        else if (yjson_get_type(&v) != YJSON_NULL)
+            mismatches++;
+        yjson_free(&v);
+    }
+    free(json1);
+    return mismatches;
+}
+
+static void test_parse_stream() {
+    static const char* const corpus[] = {
+        "null", " true ", "false", "0", "-0", "123", "-1.5e-10", "1E400", "18446744073709551616",
+        "\"\"", "\"Hello\\nWorld\"", "\"\\u00e9\\uD834\\uDD1E\"", "\"a\\\\\\\"b\"",
+        "[ ]", "[1,2,3]", "[ null , false , true , 123 , \"abc\" ]",
+        "[[],[0],[0,1],[0,1,2]]",
+        " { "
+        "\"n\" : null , \"f\" : false , \"t\" : true , \"i\" : 123 , \"s\" : \"abc\", "
+        "\"a\" : [ 1, 2, 3 ],"
+        "\"o\" : { \"1\" : 1, \"2\" : 2, \"3\" : 3 }"
+        " } ",
+        "{\"key with \\\"escapes\\\"\":[{\"x\":-0.000001}, 1e21, {}]}",
+        /* errors */
+        "", " ", "nul", "?", "+0", ".123", "1.", "INF", "nan", "0x0", "0123", "1 2", "null x",
+        "1e309", "\"abc", "\"\\v\"", "\"\\u12\"", "\"\\uD800\\uE000\"", "\"\x01\"",
+        "[", "[1", "[1,", "[1}", "[\"a\", nul]", "[1 2]",
+        "{", "{\"a\"", "{\"a\":", "{\"a\":1", "{\"a\":1,", "{1:1}", "{\"a\" 1}", "{\"a\":1 \"b\":2}",
+        "{\"a\":{\"b\":[", "[[[[]]]]]"
+    };
+    size_t i;
+    yjson_stream* s = yjson_stream_create();
+    yjson_value v;
+
+    for (i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++)
+        EXPECT_EQ_INT(0, stream_mismatches(s, corpus[i]));
+
+    /* nesting is bounded as in yjson_parse() */
+    for (i = 1024; i <= 1025; i++) {
+        char* deep = nested_json(i, "[", "", "]");
+        EXPECT_EQ_INT(0, stream_mismatches(s, deep));
+        free(deep);
+    }
+
+    /* a root array or object is complete before the input ends */
+    yjson_init(&v);
+    EXPECT_EQ_INT(YJSON_PARSE_NEED_MORE, yjson_stream_feed(s, "{\"a\":[1,", 8));
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_stream_feed(s, "2]} ", 4));
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_stream_finish(s, &v));
+    EXPECT_EQ_SIZE_T(2, yjson_get_array_size(yjson_get_object_value(&v, 0)));
+    yjson_free(&v);
+
+    /* errors are sticky until the stream is finished or reset */
+    EXPECT_EQ_INT(YJSON_PARSE_MISS_COLON, yjson_stream_feed(s, "{\"a\" 1", 6));
+    EXPECT_EQ_INT(YJSON_PARSE_MISS_COLON, yjson_stream_feed(s, "}", 1));
+    yjson_stream_reset(s);
+    EXPECT_EQ_INT(YJSON_PARSE_NEED_MORE, yjson_stream_feed(s, "[\"unfinished", 12));
+    yjson_stream_destroy(s);
+}
+
+typedef struct {
+    size_t count, errors, sum, next_offset;
+    long last_id;
+    int in_order;
+    size_t stop_after;
+} ndjson_state;
+
+static int ndjson_record(void* user, size_t offset, int status, const yjson_value* v) {
+    ndjson_state* st = (ndjson_state*)user;
+    if (status != YJSON_PARSE_OK)
+        st->errors++;
+    else {
+        long id = (long)yjson_get_int64(yjson_get_object_value(v, 0));
+        if (id <= st->last_id || offset < st->next_offset)
+            st->in_order = 0;
+        st->last_id = id;
+        st->sum += (size_t)id;
+        if (yjson_get_string_length(yjson_get_object_value(v, 1)) != 3)
+            st->errors += 100;
+    }
+    st->next_offset = offset + 1;
+    return ++st->count == st->stop_after;
+}
+
+static char* ndjson_make(size_t records, size_t* len) {
+    char* json = (char*)malloc(records * 40 + 16);
+    size_t i, n = 0;
+    for (i = 0; i < records; i++) {
+        n += sprintf(json + n, "{\"id\":%lu,\"s\":\"a\\tb\"}\n", (unsigned long)(i + 1));
+        if (i % 100 == 0)
+            n += sprintf(json + n, "\n  \r\n");
+    }
+    n += sprintf(json + n, "{\"id\": [}\n{\"id\":0,\"s\":\"end\"}");
+    *len = n;
+    return json;
+}
+
+#ifdef TEST_THREADS
+/* independent parses on several threads share no state (run under TSan) */
+static void* test_parse_thread(void* arg) {
+    static const char json[] = "{\"a\":[1,2,3],\"s\":\"a string that is scanned wide   \"}";
+    int* ok = (int*)arg;
+    int i;
+    for (i = 0; i < 1000; i++) {
+        yjson_value v;
+        yjson_init(&v);
+        if (yjson_parse(&v, json) == YJSON_PARSE_OK && yjson_get_object_size(&v) == 2)
+            ++*ok;
+        yjson_free(&v);
+    }
+    return NULL;
+}
+
+static void test_parse_threads() {
+    pthread_t t[4];
+    int ok[4] = { 0, 0, 0, 0 };
+    int i;
+    for (i = 0; i < 4; i++)
+        pthread_create(&t[i], NULL, test_parse_thread, &ok[i]);
+    for (i = 0; i < 4; i++) {
+        pthread_join(t[i], NULL);
+        EXPECT_EQ_INT(1000, ok[i]);
+    }
+}
+#endif
+
+#ifdef TEST_THREADS
+/*
+ * Unordered callbacks run concurrently. The first four wait for each other,
+ * so every worker is inside a batch when the fourth one stops the run; the
+ * other three then give it a moment to record the stop before they return.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t all_in;
+    size_t count;
+} ndjson_stop_state;
+
+static int ndjson_stop_record(void* user, size_t offset, int status, const yjson_value* v) {
+    ndjson_stop_state* st = (ndjson_stop_state*)user;
+    size_t n;
+    (void)offset;
+    (void)status;
+    (void)v;
+    pthread_mutex_lock(&st->lock);
+    n = ++st->count;
+    if (n == 4)
+        pthread_cond_broadcast(&st->all_in);
+    while (st->count < 4)
+        pthread_cond_wait(&st->all_in, &st->lock);
+    pthread_mutex_unlock(&st->lock);
+    if (n < 4) {
+        struct timespec ts;
+        ts.tv_sec = 0;
+        ts.tv_nsec = 50000000;
+        nanosleep(&ts, NULL);
+    }
+    return n == 4;
+}
+
+static void test_parse_ndjson_stop(const char* json, size_t len) {
+    yjson_ndjson_options opt;
+    ndjson_stop_state st;
+    opt.threads = 4;
+    opt.ordered = 0;
+    opt.batch_size = len / 4;
+    pthread_mutex_init(&st.lock, NULL);
+    pthread_cond_init(&st.all_in, NULL);
+    st.count = 0;
+    EXPECT_EQ_INT(YJSON_PARSE_CANCELED, yjson_parse_ndjson(json, len, &opt, ndjson_stop_record, &st));
+    /* the other workers drop the rest of their batches of some 250 records */
+    EXPECT_TRUE(st.count < 20);
+    pthread_cond_destroy(&st.all_in);
+    pthread_mutex_destroy(&st.lock);
+}
+#endif
+
+static void test_parse_ndjson() {
+    size_t len;
+    char* json = ndjson_make(1000, &len);
+    yjson_ndjson_options opt;
+    ndjson_state st;
+    FILE* fp;
+
+    opt.threads = 4;
+    opt.ordered = 1;
+    opt.batch_size = 100;
+    memset(&st, 0, sizeof(st));
+    st.in_order = 1;
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_ndjson(json, len, &opt, ndjson_record, &st));
+    EXPECT_EQ_SIZE_T(1002, st.count);
+    EXPECT_EQ_SIZE_T(1, st.errors);
+    EXPECT_EQ_SIZE_T(500500, st.sum);
+    /* the last record, id 0, is the only one out of order */
+    EXPECT_FALSE(st.in_order);
+    EXPECT_EQ_INT(0, (int)st.last_id);
+
+    /* one worker, unordered: the callback runs on this thread only */
+    opt.threads = 1;
+    opt.ordered = 0;
+    memset(&st, 0, sizeof(st));
+    st.stop_after = 10;
+    EXPECT_EQ_INT(YJSON_PARSE_CANCELED, yjson_parse_ndjson(json, len, &opt, ndjson_record, &st));
+    EXPECT_EQ_SIZE_T(10, st.count);
+
+    /* ordered delivery also stops early across threads */
+    opt.threads = 3;
+    opt.ordered = 1;
+    memset(&st, 0, sizeof(st));
+    st.in_order = 1;
+    st.stop_after = 500;
+    EXPECT_EQ_INT(YJSON_PARSE_CANCELED, yjson_parse_ndjson(json, len, &opt, ndjson_record, &st));
+    EXPECT_EQ_SIZE_T(500, st.count);
+    EXPECT_TRUE(st.in_order);
+
+#ifdef TEST_THREADS
+    /* unordered, the other workers stop delivering too */
+    test_parse_ndjson_stop(json, len);
+#endif
+
+    /* records are parsed straight out of the input, bounded by their
+     * newline: it is neither written to nor read past its end */
+    {
+        static const char text[] = "{\"id\":1,\"s\":\"abc\"}\n{\"id\":2,\"s\":\"def\"}\n{\"id\":3";
+        char* exact = (char*)malloc(sizeof(text) - 1);
+        memcpy(exact, text, sizeof(text) - 1);
+        opt.threads = 1;
+        opt.ordered = 1;
+        opt.batch_size = 0;
+        memset(&st, 0, sizeof(st));
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_ndjson(exact, sizeof(text) - 1, &opt, ndjson_record, &st));
+        EXPECT_EQ_SIZE_T(3, st.count);
+        EXPECT_EQ_SIZE_T(1, st.errors);
+        EXPECT_EQ_SIZE_T(3, st.sum);
+        EXPECT_TRUE(memcmp(exact, text, sizeof(text) - 1) == 0);
+        free(exact);
+    }
+
+    /* the file entry point maps the file; defaults for everything else */
+    if ((fp = fopen("yjson_test.ndjson", "wb")) != NULL) {
+        fwrite(json, 1, len, fp);
+        fclose(fp);
+        memset(&st, 0, sizeof(st));
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_ndjson_file("yjson_test.ndjson", NULL, ndjson_record, &st));
+        EXPECT_EQ_SIZE_T(1002, st.count);
+        EXPECT_EQ_SIZE_T(500500, st.sum);
+        remove("yjson_test.ndjson");
+    }
+    EXPECT_EQ_INT(YJSON_PARSE_IO_ERROR, yjson_parse_ndjson_file("no/such/file.ndjson", NULL, ndjson_record, &st));
+    free(json);
+}
+
+#define TEST_DOC_ERROR(error, json)\
+    do {\
+        yjson_value v;\
+        yjson_init(&v);\
+        EXPECT_EQ_INT(error, yjson_parse(&v, json));\
+        EXPECT_EQ_INT(error, yjson_doc_parse(d, json));\
+        yjson_free(&v);\
+    } while(0)
+
+static void test_parse_doc() {
+    static const char json[] =
+        "{\"a\":{\"b\":[0,1.5,-2,\"x\\ty\",[],{}],\"c\":true},\"a.b\":null,"
+        "\"big\":18446744073709551615,\"\":\"empty\",\"s\":\"plain\"}";
+    yjson_doc* d = yjson_doc_create();
+    yjson_node n;
+    yjson_value v;
+    const char* s;
+    char* deep;
+    size_t len;
+
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_doc_parse(d, json));
+    EXPECT_EQ_INT(YJSON_OBJECT, yjson_doc_get_type(d, yjson_doc_get_path(d, "")));
+    EXPECT_EQ_SIZE_T(5, yjson_doc_get_size(d, yjson_doc_get_path(d, "")));
+    EXPECT_EQ_SIZE_T(6, yjson_doc_get_size(d, yjson_doc_get_path(d, "a.b")));
+    EXPECT_EQ_DOUBLE(0.0, yjson_doc_get_number(d, yjson_doc_get_path(d, "a.b[0]")));
+    EXPECT_EQ_DOUBLE(1.5, yjson_doc_get_number(d, yjson_doc_get_path(d, "a.b[1]")));
+    EXPECT_EQ_DOUBLE(-2.0, yjson_doc_get_number(d, yjson_doc_get_path(d, "a.b[2]")));
+    EXPECT_EQ_INT(YJSON_ARRAY, yjson_doc_get_type(d, yjson_doc_get_path(d, "a.b[4]")));
+    EXPECT_EQ_INT(YJSON_OBJECT, yjson_doc_get_type(d, yjson_doc_get_path(d, "a.b[5]")));
+    EXPECT_EQ_INT(1, yjson_doc_get_boolean(d, yjson_doc_get_path(d, "a.c")));
+
+    /* strings are views into the input unless they hold escapes */
+    s = yjson_doc_get_string(d, yjson_doc_get_path(d, "s"), &len);
+    EXPECT_EQ_STRING("plain", s, len);
+    EXPECT_TRUE(s > json && s < json + sizeof(json));
+    s = yjson_doc_get_string(d, yjson_doc_get_path(d, "a.b[3]"), &len);
+    EXPECT_EQ_STRING("x\ty", s, len);
+    n = yjson_doc_find(d, yjson_doc_get_path(d, ""), "", 0);
+    s = yjson_doc_get_string(d, n, &len);
+    EXPECT_EQ_STRING("empty", s, len);
+    n = yjson_doc_find(d, yjson_doc_get_path(d, ""), "a.b", 3);
+    EXPECT_EQ_INT(YJSON_NULL, yjson_doc_get_type(d, n));
+
+    /* exact integers come out through an ordinary value */
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_doc_get_value(d, yjson_doc_get_path(d, "big"), &v));
+    EXPECT_TRUE(yjson_is_uint64(&v));
+    EXPECT_TRUE(yjson_get_uint64(&v) == UINT64_MAX);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_doc_get_value(d, yjson_doc_get_path(d, "a"), &v));
+    EXPECT_EQ_SIZE_T(2, yjson_get_object_size(&v));
+    yjson_free(&v);
 
+    /* anything that does not resolve */
+    EXPECT_TRUE(yjson_doc_get_path(d, "a.x") == YJSON_NODE_NONE);
+    EXPECT_TRUE(yjson_doc_get_path(d, "a.b[6]") == YJSON_NODE_NONE);
+    EXPECT_TRUE(yjson_doc_get_path(d, "a.b[0].c") == YJSON_NODE_NONE);
+    EXPECT_TRUE(yjson_doc_get_path(d, "a[0]") == YJSON_NODE_NONE);
+    EXPECT_TRUE(yjson_doc_get_path(d, "a.b[x]") == YJSON_NODE_NONE);
+    EXPECT_TRUE(yjson_doc_get_element(d, yjson_doc_get_path(d, "a.b"), 100) == YJSON_NODE_NONE);
+
+    /* the grammar is checked exactly as yjson_parse() does */
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_doc_parse(d, " [ 1e308 , 123456789012345678901234567890 ] "));
+    EXPECT_EQ_INT(YJSON_NUMBER, yjson_doc_get_type(d, yjson_doc_get_path(d, "[1]")));
+    EXPECT_EQ_DOUBLE(1.2345678901234568e29, yjson_doc_get_number(d, yjson_doc_get_path(d, "[1]")));
+    TEST_DOC_ERROR(YJSON_PARSE_EXPECT_VALUE, " ");
+    TEST_DOC_ERROR(YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[01]");
+    TEST_DOC_ERROR(YJSON_PARSE_INVALID_VALUE, "1.");
+    TEST_DOC_ERROR(YJSON_PARSE_INVALID_VALUE, "-");
+    TEST_DOC_ERROR(YJSON_PARSE_INVALID_VALUE, "1e+");
+    TEST_DOC_ERROR(YJSON_PARSE_NUMBER_TOO_BIG, "1e309");
+    TEST_DOC_ERROR(YJSON_PARSE_NUMBER_TOO_BIG, "[-1E+400]");
+    TEST_DOC_ERROR(YJSON_PARSE_ROOT_NOT_SINGULAR, "null x");
+    TEST_DOC_ERROR(YJSON_PARSE_INVALID_STRING_ESCAPE, "[\"\\v\"]");
+    TEST_DOC_ERROR(YJSON_PARSE_MISS_QUOTATION_MARK, "\"abc");
+    TEST_DOC_ERROR(YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1 2]");
+    TEST_DOC_ERROR(YJSON_PARSE_MISS_KEY, "{1:2}");
+    TEST_DOC_ERROR(YJSON_PARSE_MISS_COLON, "{\"a\" 2}");
+    TEST_DOC_ERROR(YJSON_PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":2 \"b\"}");
+    EXPECT_TRUE(yjson_doc_get_path(d, "") == YJSON_NODE_NONE);
+
+    /* nesting is bounded as in yjson_parse() */
+    deep = nested_json(1024, "[", "", "]");
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_doc_parse(d, deep));
+    EXPECT_EQ_INT(YJSON_ARRAY, yjson_doc_get_type(d, yjson_doc_get_path(d, "[0][0]")));
+    free(deep);
+    deep = nested_json(513, "{\"a\":[", "", "]}");
+    TEST_DOC_ERROR(YJSON_PARSE_TOO_DEEP, deep);
+    free(deep);
+    deep = nested_json(1000000, "[", "", "]");
+    TEST_DOC_ERROR(YJSON_PARSE_TOO_DEEP, deep);
+    free(deep);
+    yjson_doc_destroy(d);
+}
+
+#ifdef YJSON_STATS
+static void test_parse_stats() {
+    static const char json[] = "{\"a\":[1,2,\"x\\ny\"],\"b\":null,\"c\":true}";
+    yjson_value v;
+    yjson_stats s, t;
+    yjson_handler h;
+    size_t allocs;
+
+    yjson_reset_thread_stats();
+    yjson_init(&v);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, json));
+    yjson_free(&v);
+    yjson_get_stats(&s);
+    EXPECT_EQ_SIZE_T(1, s.calls);
+    EXPECT_EQ_SIZE_T(sizeof(json) - 1, s.bytes);
+    EXPECT_EQ_SIZE_T(1, s.values[YJSON_OBJECT]);
+    EXPECT_EQ_SIZE_T(1, s.values[YJSON_ARRAY]);
+    EXPECT_EQ_SIZE_T(2, s.values[YJSON_NUMBER]);
+    EXPECT_EQ_SIZE_T(1, s.values[YJSON_STRING]);
+    EXPECT_EQ_SIZE_T(1, s.values[YJSON_NULL]);
+    EXPECT_EQ_SIZE_T(1, s.values[YJSON_TRUE]);
+    EXPECT_EQ_SIZE_T(0, s.values[YJSON_FALSE]);
+    EXPECT_EQ_SIZE_T(4, s.strings);
+    EXPECT_EQ_SIZE_T(1, s.escapes);
+    EXPECT_TRUE(s.stack_peak > 0);
+    EXPECT_TRUE(s.allocs > 0);
+    EXPECT_TRUE(s.parse_seconds >= 0.0);
+    allocs = s.allocs;
+
+    /* an unpadded input is parsed where it is, without a copy */
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_n(&v, json, sizeof(json) - 1));
+    yjson_free(&v);
+    yjson_get_stats(&s);
+    EXPECT_EQ_SIZE_T(allocs, s.allocs);
+
+    /* a failed parse reports how far it got */
+    EXPECT_EQ_INT(YJSON_PARSE_INVALID_VALUE, yjson_parse(&v, "[1,?]"));
+    yjson_get_stats(&s);
+    EXPECT_EQ_SIZE_T(3, s.bytes);
+    EXPECT_EQ_SIZE_T(1, s.values[YJSON_NUMBER]);
+
+    /* other parsers leave the counters alone */
+    memset(&h, 0, sizeof(h));
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse_sax(json, &h, NULL));
+
+    yjson_get_thread_stats(&t);
+    EXPECT_EQ_SIZE_T(3, t.calls);
+    EXPECT_EQ_SIZE_T(5, t.values[YJSON_NUMBER]);
+    EXPECT_EQ_SIZE_T(8, t.strings);
+    EXPECT_EQ_SIZE_T(allocs * 2, t.allocs);
+    yjson_reset_thread_stats();
+    yjson_get_thread_stats(&t);
+    EXPECT_EQ_SIZE_T(0, t.calls);
+}
+#endif
+
+#define TEST_ROUNDTRIP(json)\
+    do {\
+        yjson_value v;\
+        char* json2;\
+        size_t length;\
+        yjson_init(&v);\
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, json));\
+        json2 = yjson_stringify(&v, &length);\
+        EXPECT_EQ_STRING(json, json2, length);\
+        yjson_free(&v);\
+        free(json2);\
+    } while(0)
+
+static void test_stringify_number() {
+    TEST_ROUNDTRIP("0");
+    TEST_ROUNDTRIP("-0.0");
+    TEST_ROUNDTRIP("1");
+    TEST_ROUNDTRIP("-1");
+    TEST_ROUNDTRIP("1.5");
+    TEST_ROUNDTRIP("-1.5");
+    TEST_ROUNDTRIP("3.25");
+    TEST_ROUNDTRIP("1.0");
+    TEST_ROUNDTRIP("0.1");
+    TEST_ROUNDTRIP("0.000001");
+    TEST_ROUNDTRIP("1e-7");
+    TEST_ROUNDTRIP("1e21");
+    TEST_ROUNDTRIP("1.234e-20");
+    TEST_ROUNDTRIP("100000000000000000000.0");
+    TEST_ROUNDTRIP("9223372036854775807");
+    TEST_ROUNDTRIP("-9223372036854775808");
+    TEST_ROUNDTRIP("18446744073709551615");
+
+    TEST_ROUNDTRIP("1.0000000000000002"); /* the smallest number > 1 */
+    TEST_ROUNDTRIP("5e-324"); /* minimum denormal */
+    TEST_ROUNDTRIP("-5e-324");
+    TEST_ROUNDTRIP("2.225073858507201e-308");  /* Max subnormal double */
+    TEST_ROUNDTRIP("-2.225073858507201e-308");
+    TEST_ROUNDTRIP("2.2250738585072014e-308");  /* Min normal positive double */
+    TEST_ROUNDTRIP("-2.2250738585072014e-308");
+    TEST_ROUNDTRIP("1.7976931348623157e308");  /* Max double */
+    TEST_ROUNDTRIP("-1.7976931348623157e308");
+}
+
+static void test_stringify_number_roundtrip() {
+    uint64_t x = UINT64_C(88172645463325252);
+    double d, r;
+    int i, bad = 0;
+    for (i = 0; i < 100000; i++) {
+        yjson_value v;
+        char* json;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        memcpy(&d, &x, sizeof(d));
+        if (d != d || d - d != 0)
+            continue;
+        yjson_init(&v);
+        yjson_set_number(&v, d);
+        json = yjson_stringify(&v, NULL);
+        if (yjson_parse(&v, json) != YJSON_PARSE_OK)
+            bad++;
+        else {
+            r = yjson_get_number(&v);
+            bad += memcmp(&d, &r, sizeof(d)) != 0;
+        }
+        free(json);
+    }
+    EXPECT_EQ_INT(0, bad);
+}
+
+static void test_stringify_string() {
+    TEST_ROUNDTRIP("\"\"");
+    TEST_ROUNDTRIP("\"Hello\"");
+    TEST_ROUNDTRIP("\"Hello\\nWorld\"");
+    TEST_ROUNDTRIP("\"\\\" \\\\ / \\b \\f \\n \\r \\t\"");
+    TEST_ROUNDTRIP("\"0123456789abcdef0123456789abcdef\\t0123456789abcdef0123456789abcdef\"");
+}
+
+static void test_stringify_control_char() {
+    yjson_value v;
+    char* json;
+    size_t length;
+    yjson_init(&v);
+    yjson_set_string(&v, "a\x01\x1F\0b", 5);
+    json = yjson_stringify(&v, &length);
+    EXPECT_EQ_STRING("\"a\\u0001\\u001F\\u0000b\"", json, length);
+    free(json);
+    yjson_free(&v);
+}
+
+static void test_stringify_array() {
+    TEST_ROUNDTRIP("[]");
+    TEST_ROUNDTRIP("[null,false,true,123,\"abc\",[1,2,3]]");
+}
+
+static void test_stringify_object() {
+    TEST_ROUNDTRIP("{}");
+    TEST_ROUNDTRIP("{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\",\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":2,\"3\":3}}");
+}
+
+#define TEST_BINARY_ROUNDTRIP(json)\
+    do {\
+        yjson_value v, v2;\
+        char *bin, *json2;\
+        size_t blen, length;\
+        yjson_init(&v);\
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, json));\
+        bin = yjson_encode_binary(&v, &blen);\
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_binary_check(bin, blen));\
+        EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_decode_binary(&v2, bin, blen));\
+        json2 = yjson_stringify(&v2, &length);\
+        EXPECT_EQ_STRING(json, json2, length);\
+        yjson_free(&v);\
+        yjson_free(&v2);\
+        free(bin);\
+        free(json2);\
+    } while(0)
+
+static void test_binary() {
+    static const char json[] =
+        "{\"n\":null,\"f\":false,\"t\":true,\"d\":1.5,\"i\":-9223372036854775808,\"u\":18446744073709551615,"
+        "\"s\":\"a long string that is not inline\",\"e\":\"\",\"a\":[1,[],{}],\"\\u0000\":0}";
+    char big[1024], *bin;
+    size_t blen, len, i;
+    yjson_value v, v2;
+    yjson_node n, a;
+    const char* s;
+
+    TEST_BINARY_ROUNDTRIP("null");
+    TEST_BINARY_ROUNDTRIP("false");
+    TEST_BINARY_ROUNDTRIP("-0.0");
+    TEST_BINARY_ROUNDTRIP("\"\"");
+    TEST_BINARY_ROUNDTRIP("[]");
+    TEST_BINARY_ROUNDTRIP("{}");
+    TEST_BINARY_ROUNDTRIP(json);
+    /* keys seen before are stored once */
+    TEST_BINARY_ROUNDTRIP("[{\"id\":1,\"name\":\"a\"},{\"id\":-2147483648,\"name\":\"b\"},{\"x\":{\"id\":2147483648},\"id\":3,\"id\":4}]");
+
+    /* in place */
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, json));
+    bin = yjson_encode_binary(&v, &blen);
+    yjson_free(&v);
+    n = YJSON_BINARY_ROOT;
+    EXPECT_EQ_INT(YJSON_OBJECT, yjson_binary_get_type(bin, n));
+    EXPECT_EQ_SIZE_T(10, yjson_binary_get_size(bin, n));
+    s = yjson_binary_get_key(bin, n, 9, &len);
+    EXPECT_EQ_STRING("\0", s, len);
+    EXPECT_EQ_INT(YJSON_NULL, yjson_binary_get_type(bin, yjson_binary_get_member(bin, n, 0)));
+    EXPECT_FALSE(yjson_binary_get_boolean(bin, yjson_binary_find(bin, n, "f", 1)));
+    EXPECT_TRUE(yjson_binary_get_boolean(bin, yjson_binary_find(bin, n, "t", 1)));
+    EXPECT_EQ_DOUBLE(1.5, yjson_binary_get_number(bin, yjson_binary_find(bin, n, "d", 1)));
+    EXPECT_EQ_DOUBLE(-9223372036854775808.0, yjson_binary_get_number(bin, yjson_binary_find(bin, n, "i", 1)));
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_binary_get_value(bin, yjson_binary_find(bin, n, "u", 1), &v));
+    EXPECT_TRUE(yjson_is_uint64(&v));
+    EXPECT_TRUE(yjson_get_uint64(&v) == UINT64_MAX);
+    s = yjson_binary_get_string(bin, yjson_binary_find(bin, n, "s", 1), &len);
+    EXPECT_EQ_STRING("a long string that is not inline", s, len);
+    EXPECT_EQ_INT('\0', s[len]);
+    s = yjson_binary_get_string(bin, yjson_binary_find(bin, n, "e", 1), &len);
+    EXPECT_EQ_STRING("", s, len);
+    a = yjson_binary_find(bin, n, "a", 1);
+    EXPECT_EQ_SIZE_T(3, yjson_binary_get_size(bin, a));
+    EXPECT_EQ_DOUBLE(1.0, yjson_binary_get_number(bin, yjson_binary_get_element(bin, a, 0)));
+    EXPECT_EQ_SIZE_T(0, yjson_binary_get_size(bin, yjson_binary_get_element(bin, a, 1)));
+    EXPECT_EQ_INT(YJSON_OBJECT, yjson_binary_get_type(bin, yjson_binary_get_element(bin, a, 2)));
+    EXPECT_TRUE(yjson_binary_get_element(bin, a, 3) == YJSON_NODE_NONE);
+    EXPECT_TRUE(yjson_binary_find(bin, n, "x", 1) == YJSON_NODE_NONE);
+    EXPECT_TRUE(yjson_binary_find(bin, n, "", 0) == YJSON_NODE_NONE);
+
+    /* every truncation and every flipped byte is caught or still decodes */
+    for (i = 0; i < blen; i++)
+        EXPECT_EQ_INT(YJSON_PARSE_INVALID_BINARY, yjson_binary_check(bin, i));
+    for (i = 0; i < blen; i++) {
+        bin[i] ^= 0x5a;
+        if (yjson_decode_binary(&v, bin, blen) == YJSON_PARSE_OK)
+            yjson_free(&v);
+        bin[i] ^= 0x5a;
+    }
+    EXPECT_EQ_INT(YJSON_PARSE_INVALID_BINARY, yjson_binary_check(NULL, 0));
+    bin[0] = 'X';
+    EXPECT_EQ_INT(YJSON_PARSE_INVALID_BINARY, yjson_decode_binary(&v, bin, blen));
+    EXPECT_EQ_INT(YJSON_NULL, yjson_get_type(&v));
+    free(bin);
+
+    /* large objects carry their hash index */
+    len = 1;
+    big[0] = '{';
+    for (i = 0; i < 40; i++)
+        len += sprintf(big + len, "%s\"key%lu\":%lu", i ? "," : "", (unsigned long)i, (unsigned long)i);
+    strcpy(big + len, "}");
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, big));
+    bin = yjson_encode_binary(&v, &blen);
+    for (i = 0; i < 40; i++) {
+        char key[32];
+        sprintf(key, "key%lu", (unsigned long)i);
+        EXPECT_EQ_DOUBLE((double)i, yjson_binary_get_number(bin, yjson_binary_find(bin, YJSON_BINARY_ROOT, key, strlen(key))));
+    }
+    EXPECT_TRUE(yjson_binary_find(bin, YJSON_BINARY_ROOT, "key40", 5) == YJSON_NODE_NONE);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_decode_binary(&v2, bin, blen));
+    EXPECT_EQ_DOUBLE(39.0, yjson_get_number(yjson_find_object_value(&v2, "key39", 5)));
+    s = yjson_stringify(&v2, &len);
+    EXPECT_TRUE(len == strlen(big) && memcmp(s, big, len) == 0);
+    free((char*)s);
+    yjson_free(&v);
+    yjson_free(&v2);
+    free(bin);
+}
+
+/* containers nest at most 1024 deep, the default YJSON_PARSE_MAX_DEPTH */
+static void test_binary_depth() {
+    size_t depth, i, blen;
+    char *json, *bin;
+    yjson_value v, outer;
+
+    /* whatever parses also encodes, checks and stringifies */
+    json = nested_json(1024, "[", "", "]");
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, json));
+    free(json);
+    bin = yjson_encode_binary(&v, &blen);
+    EXPECT_TRUE(bin != NULL);
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_binary_check(bin, blen));
+    free(bin);
+    bin = yjson_stringify(&v, &blen);
+    EXPECT_TRUE(bin != NULL);
+    EXPECT_EQ_SIZE_T(2048, blen);
+    free(bin);
+
+    /* one more level, built by hand, is refused */
+    outer.type = YJSON_ARRAY;
+    outer.flags = 0;
+    outer.u.a.size = 1;
+    outer.u.a.e = (yjson_value*)malloc(sizeof(yjson_value));
+    memcpy(outer.u.a.e, &v, sizeof(yjson_value));
+    EXPECT_TRUE(yjson_encode_binary(&outer, &blen) == NULL);
+    EXPECT_TRUE(yjson_stringify(&outer, &blen) == NULL);
+    yjson_free(&outer);
+
+    /* a forged chain of a million one-element arrays is refused, not followed */
+    depth = 1000000;
+    blen = 12 + depth * 9 + 1;
+    bin = (char*)malloc(blen);
+    memcpy(bin, "YJB1", 4);
+    {
+        uint32_t u = 0x01020304;
+        memcpy(bin + 4, &u, 4);
+        u = (uint32_t)blen;
+        memcpy(bin + 8, &u, 4);
+        for (i = 0; i < depth; i++) {
+            bin[12 + i * 9] = YJSON_ARRAY;
+            u = 1;
+            memcpy(bin + 12 + i * 9 + 1, &u, 4);
+            u = (uint32_t)(12 + (i + 1) * 9);
+            memcpy(bin + 12 + i * 9 + 5, &u, 4);
+        }
+    }
+    bin[blen - 1] = YJSON_NULL;
+    EXPECT_EQ_INT(YJSON_PARSE_INVALID_BINARY, yjson_binary_check(bin, blen));
+    EXPECT_EQ_INT(YJSON_PARSE_INVALID_BINARY, yjson_decode_binary(&v, bin, blen));
+    free(bin);
+}
+
+static void test_stringify() {
+    TEST_ROUNDTRIP("null");
+    TEST_ROUNDTRIP("false");
+    TEST_ROUNDTRIP("true");
+    test_stringify_number();
+    test_stringify_number_roundtrip();
+    test_stringify_string();
+    test_stringify_control_char();
+    test_stringify_array();
+    test_stringify_object();
+    test_binary();
+    test_binary_depth();
 }
 
 static void test_access_string() {
@@ -185,6 +1699,39 @@ static void test_access_string() {
     yjson_free(&v);
 }
 
+static void test_access_inline_string() {
+    yjson_value v, *e;
+    char buf[YJSON_INLINE_MAX + 2];
+
+    /* strings up to YJSON_INLINE_MAX bytes need no allocation of their own */
+    yjson_init(&v);
+    memset(buf, 'x', sizeof(buf));
+    yjson_set_string(&v, buf, YJSON_INLINE_MAX);
+    EXPECT_TRUE(v.flags & YJSON_FLAG_INLINE);
+    EXPECT_EQ_STRING("xxxxxxxxxxxxxx", yjson_get_string(&v), yjson_get_string_length(&v));
+    EXPECT_TRUE(yjson_get_string(&v)[YJSON_INLINE_MAX] == '\0');
+    yjson_set_string(&v, buf, YJSON_INLINE_MAX + 1);
+    EXPECT_FALSE(v.flags & YJSON_FLAG_INLINE);
+    EXPECT_EQ_STRING("xxxxxxxxxxxxxxx", yjson_get_string(&v), yjson_get_string_length(&v));
+    yjson_set_string(&v, "ok", 2);
+    EXPECT_TRUE(v.flags & YJSON_FLAG_INLINE);
+    EXPECT_EQ_STRING("ok", yjson_get_string(&v), yjson_get_string_length(&v));
+    yjson_free(&v);
+
+    /* parsed strings too, after being moved into their array */
+    EXPECT_EQ_INT(YJSON_PARSE_OK, yjson_parse(&v, "[\"\",\"fourteen bytes\",\"fifteen bytes!!\"]"));
+    e = yjson_get_array_element(&v, 0);
+    EXPECT_TRUE(e->flags & YJSON_FLAG_INLINE);
+    EXPECT_EQ_STRING("", yjson_get_string(e), yjson_get_string_length(e));
+    e = yjson_get_array_element(&v, 1);
+    EXPECT_TRUE(e->flags & YJSON_FLAG_INLINE);
+    EXPECT_EQ_STRING("fourteen bytes", yjson_get_string(e), yjson_get_string_length(e));
+    e = yjson_get_array_element(&v, 2);
+    EXPECT_FALSE(e->flags & YJSON_FLAG_INLINE);
+    EXPECT_EQ_STRING("fifteen bytes!!", yjson_get_string(e), yjson_get_string_length(e));
+    yjson_free(&v);
+}
+
 
 static void test_access_boolean() {
     yjson_value v;
@@ -197,30 +1744,90 @@ static void test_access_boolean() {
 }
 
 static void test_access_number() {
-    /* \TODO */
+    yjson_value v;
+    yjson_init(&v);
+    yjson_set_string(&v, "a", 1);
+    yjson_set_number(&v, 1234.5);
+    EXPECT_EQ_DOUBLE(1234.5, yjson_get_number(&v));
+    EXPECT_FALSE(yjson_is_int64(&v));
+    yjson_set_int64(&v, INT64_MIN);
+    EXPECT_TRUE(yjson_is_int64(&v));
+    EXPECT_TRUE(yjson_get_int64(&v) == INT64_MIN);
+    yjson_set_uint64(&v, UINT64_MAX);
+    EXPECT_TRUE(yjson_is_uint64(&v));
+    EXPECT_FALSE(yjson_is_int64(&v));
+    EXPECT_TRUE(yjson_get_uint64(&v) == UINT64_MAX);
+    EXPECT_TRUE(yjson_get_int64(&v) == INT64_MAX);
+    yjson_set_int64(&v, -1);
+    EXPECT_TRUE(yjson_get_uint64(&v) == 0);
+
+    /* other numbers truncate and saturate */
+    yjson_set_number(&v, -2.75);
+    EXPECT_TRUE(yjson_get_int64(&v) == -2);
+    EXPECT_TRUE(yjson_get_uint64(&v) == 0);
+    yjson_set_number(&v, 1e300);
+    EXPECT_TRUE(yjson_get_int64(&v) == INT64_MAX);
+    EXPECT_TRUE(yjson_get_uint64(&v) == UINT64_MAX);
+    yjson_set_number(&v, -1e300);
+    EXPECT_TRUE(yjson_get_int64(&v) == INT64_MIN);
+    yjson_set_number(&v, 18446744073709549568.0);
+    EXPECT_TRUE(yjson_get_uint64(&v) == UINT64_C(18446744073709549568));
+    yjson_free(&v);
 }
 
 static void test_parse()
 {
+#ifdef TEST_THREADS
+    test_parse_threads(); /* first, before anything has touched the library */
+#endif
     test_parse_null();
     test_parse_true();
     test_parse_false();
     test_parse_expect_value();
     test_parse_number();
+    test_parse_number_roundtrip();
+    test_parse_integer();
     test_parse_invalid_value();
     test_parse_root_not_sigular();
-    test_parse_number_too_big;
-    // test_parse_missing_quotation_mark();
+    test_parse_number_too_big();
+    test_parse_missing_quotation_mark();
+    test_parse_invalid_string_char();
+    test_parse_invalid_unicode_hex();
+    test_parse_invalid_unicode_surrogate();
+    test_parse_validate_utf8();
+    test_parse_whitespace();
         test_access_null();
     test_access_boolean();
     test_access_number();
     test_access_string();
+    test_access_inline_string();
     test_parse_string();
+    test_parse_array();
+    test_parse_object();
+    test_parse_too_deep();
+    test_find_object_value();
+    test_parse_arena();
+    test_parse_insitu();
+    test_parse_with();
+    test_parse_intern();
+    test_parse_stream();
+    test_parse_sax();
+    test_parse_n();
+    test_parse_ndjson();
+    test_parse_doc();
+#ifdef YJSON_STATS
+    test_parse_stats();
+#endif
+    test_parse_miss_comma_or_square_bracket();
+    test_parse_miss_key();
+    test_parse_miss_colon();
+    test_parse_miss_comma_or_curly_bracket();
 }
 
 int main()
 {
     test_parse();
+    test_stringify();
     printf("%d/%d (%3.2f%%)passed \n", test_pass, test_count, test_pass * 100.0 / test_count);
     return main_ret;
 }
\ No newline at end of file
@@ -1,40 +1,492 @@
+#if defined(__unix__) || defined(__APPLE__)
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* pthreads, mmap() under -ansi */
+#endif
+#endif
 #include "yjson.h"
 #include <assert.h>  /* assert() */
-#include <stdlib.h>  /* NULL, malloc(), realloc(), free(), strtod() */
+#include <stdlib.h>  /* NULL, malloc(), realloc(), free() */
 #include <string.h>  /* memcpy() */
-#include <errno.h>
 #include <stddef.h> /* size_t */
-#include <math.h>
+#include <stdint.h> /* uint64_t */
+#include <math.h>   /* HUGE_VAL */
+#include <stdio.h>  /* FILE */
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(YJSON_NO_THREADS)
+#define YJSON_THREADS
+#include <pthread.h>
+#include <unistd.h> /* sysconf() */
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#define YJSON_MMAP
+#include <fcntl.h>    /* open() */
+#include <sys/mman.h> /* mmap() */
+#include <sys/stat.h> /* fstat() */
+#include <unistd.h>   /* close() */
+#endif
+#if defined(__GNUC__) && defined(__SSE2__) && !defined(YJSON_NO_SIMD)
+#define YJSON_SIMD_X86
+#include <emmintrin.h> /* SSE2 */
+#include <immintrin.h> /* AVX2 */
+#endif
 #ifndef YJSON_PARSE_STACK_INIT_SIZE
 #define YJSON_PARSE_STACK_INIT_SIZE 256
 #endif
+#ifndef YJSON_ARENA_BLOCK_SIZE
+#define YJSON_ARENA_BLOCK_SIZE 4096
+#endif
+/* arrays and objects nest at most this deep, which bounds the recursion */
+#ifndef YJSON_PARSE_MAX_DEPTH
+#define YJSON_PARSE_MAX_DEPTH 1024
+#endif
+/* the allocator can be replaced at compile time, e.g. to count allocations */
+#ifndef YJSON_MALLOC
+#define YJSON_MALLOC malloc
+#endif
+#ifndef YJSON_REALLOC
+#define YJSON_REALLOC realloc
+#endif
+#ifndef YJSON_FREE
+#define YJSON_FREE free
+#endif
+/* parse statistics; without YJSON_STATS, YJSON_STAT does nothing */
+#ifdef YJSON_STATS
+#include <time.h> /* clock_gettime() */
+#if defined(__GNUC__)
+#define YJSON_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define YJSON_THREAD_LOCAL __declspec(thread)
+#else
+#define YJSON_THREAD_LOCAL /* no thread-local storage: all threads share one copy */
+#endif
+static YJSON_THREAD_LOCAL yjson_stats yjson_stats_call, yjson_stats_thread;
+static YJSON_THREAD_LOCAL int yjson_stats_active;
+#define YJSON_STAT(field, n) (yjson_stats_active ? (void)(yjson_stats_call.field += (n)) : (void)0)
+
+static double yjson_stats_now(void) {
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+#else
+#define YJSON_STAT(field, n) ((void)0)
+#endif
+#define YJSON_ARENA_ALIGN 8
 #define ISDIGIT(ch) ((ch) >='0' && (ch) <='9')
 #define ISDIGIT1T09(ch)  ((ch) >= '1' && (ch) <= '9')
 #define EXPECT(c,ch) do {assert(*c->json == (ch)) ; c->json++;} while(0)
 #define PUTC(c, ch) do { *(char*)yjson_context_push(c, sizeof(char)) = (ch); } while(0)
+#define ISWHITESPACE(ch) ((ch) == ' ' || (ch) == '\t' || (ch) == '\n' || (ch) == '\r')
+#define YJSON_STRING_FLAGS(c) ((c)->arena || (c)->insitu || (c)->intern ? YJSON_FLAG_EXTERNAL : 0)
+/* only meaningful at a '\0'; anything before c->end is an embedded NUL */
+#define YJSON_AT_END(c, p) ((c)->end == NULL || (p) == (c)->end)
+/* the byte at p, or '\0' at the end of an input that may not be read past it */
+#define YJSON_PEEK(c, p) ((p) == (c)->limit ? '\0' : *(p))
 
 
 typedef struct {
     const char* json;
+    const char* end; /* the terminating '\0', or NULL if it is the first one */
+    const char* limit; /* end when nothing may be read there, otherwise NULL */
     char* stack;
     size_t size,top;
+    yjson_arena* arena;
+    int insitu;
+    yjson_intern* intern; /* keys, and short strings, are interned here */
+    int utf8;             /* reject strings that are not well-formed UTF-8 */
+    size_t depth;         /* arrays and objects open around c->json */
 }yjson_context;
 
+static void yjson_context_init(yjson_context* c, const char* json) {
+    c->json = json;
+    c->end = NULL;
+    c->limit = NULL;
+    c->stack = NULL;
+    c->size = c->top = 0;
+    c->arena = NULL;
+    c->insitu = 0;
+    c->intern = NULL;
+    c->utf8 = 0;
+    c->depth = 0;
+}
+
+struct yjson_arena_block {
+    yjson_arena_block* next;
+    size_t size;
+};
+
+
+
+static void* yjson_arena_alloc(yjson_arena* a, size_t size, size_t align) {
+    void* ret;
+    size_t top = a->top + ((align - ((size_t)(a->buf + a->top) & (align - 1))) & (align - 1));
+    if (top + size > a->size) {
+        yjson_arena_block* b = a->head;
+        /* after a reset the coalesced block is waiting behind the user buffer */
+        if (b == NULL || a->buf == (char*)(b + 1) || b->size < size) {
+            size_t n = a->block_size;
+            while (n < size)
+                n <<= 1;
+            b = (yjson_arena_block*)YJSON_MALLOC(sizeof(yjson_arena_block) + n);
+            b->size = n;
+            b->next = a->head;
+            a->head = b;
+            a->block_size = n << 1;
+        }
+        a->buf = (char*)(b + 1);
+        a->size = b->size;
+        top = 0;
+    }
+    ret = a->buf + top;
+    a->top = top + size;
+    return ret;
+}
+
+void yjson_arena_init(yjson_arena* a, void* buf, size_t size) {
+    assert(a != NULL && (buf != NULL || size == 0));
+    a->user = a->buf = (char*)buf;
+    a->user_size = a->size = size;
+    a->top = 0;
+    a->head = NULL;
+    a->block_size = YJSON_ARENA_BLOCK_SIZE;
+    a->stack = NULL;
+    a->stack_size = 0;
+}
+
+void yjson_arena_reset(yjson_arena* a) {
+    yjson_arena_block* b = a->head;
+    assert(a != NULL);
+    if (b != NULL && b->next != NULL) {
+        /* coalesce so that the next document of this size fits in one block */
+        size_t total = 0;
+        while (b != NULL) {
+            yjson_arena_block* next = b->next;
+            total += b->size;
+            YJSON_FREE(b);
+            b = next;
+        }
+        b = a->head = (yjson_arena_block*)YJSON_MALLOC(sizeof(yjson_arena_block) + total);
+        b->size = total;
+        b->next = NULL;
+    }
+    if (a->user != NULL || b == NULL) {
+        a->buf = (char*)a->user;
+        a->size = a->user_size;
+    }
+    else {
+        a->buf = (char*)(b + 1);
+        a->size = b->size;
+    }
+    a->top = 0;
+}
+
+void yjson_arena_free(yjson_arena* a) {
+    yjson_arena_block* b;
+    assert(a != NULL);
+    for (b = a->head; b != NULL; ) {
+        yjson_arena_block* next = b->next;
+        YJSON_FREE(b);
+        b = next;
+    }
+    YJSON_FREE(a->stack);
+    yjson_arena_init(a, a->user, a->user_size);
+}
+
+static uint32_t yjson_hash(const char* s, size_t len) {
+    uint32_t h = 2166136261u; /* FNV-1a */
+    while (len-- > 0)
+        h = (h ^ (unsigned char)*s++) * 16777619u;
+    return h;
+}
+
+/*
+ * Intern table: an open-addressing set of strings whose bytes live in an
+ * arena of their own, so a pointer handed out stays valid and unique for the
+ * life of the table.
+ */
+typedef struct {
+    const char* s;
+    size_t len;
+    uint32_t hash;
+} yjson_intern_entry;
+
+struct yjson_intern {
+    yjson_arena strings;
+    yjson_intern_entry* slots;
+    size_t cap, count;  /* cap is a power of two, at most half used */
+    size_t max_value;
+};
+
+yjson_intern* yjson_intern_create(size_t max_value) {
+    yjson_intern* t = (yjson_intern*)YJSON_MALLOC(sizeof(yjson_intern));
+    yjson_arena_init(&t->strings, NULL, 0);
+    t->cap = 64;
+    t->count = 0;
+    t->slots = (yjson_intern_entry*)YJSON_MALLOC(t->cap * sizeof(yjson_intern_entry));
+    memset(t->slots, 0, t->cap * sizeof(yjson_intern_entry));
+    t->max_value = max_value;
+    return t;
+}
+
+void yjson_intern_destroy(yjson_intern* t) {
+    if (t == NULL)
+        return;
+    yjson_arena_free(&t->strings);
+    YJSON_FREE(t->slots);
+    YJSON_FREE(t);
+}
+
+static void yjson_intern_grow(yjson_intern* t) {
+    yjson_intern_entry* old = t->slots;
+    size_t i, j, mask = (t->cap << 1) - 1;
+    t->slots = (yjson_intern_entry*)YJSON_MALLOC((mask + 1) * sizeof(yjson_intern_entry));
+    memset(t->slots, 0, (mask + 1) * sizeof(yjson_intern_entry));
+    for (i = 0; i < t->cap; i++) {
+        if (old[i].s == NULL)
+            continue;
+        for (j = old[i].hash & mask; t->slots[j].s != NULL; j = (j + 1) & mask)
+            ;
+        t->slots[j] = old[i];
+    }
+    t->cap = mask + 1;
+    YJSON_FREE(old);
+}
+
+const char* yjson_intern_string(yjson_intern* t, const char* s, size_t len) {
+    uint32_t h;
+    size_t i, mask;
+    char* p;
+    assert(t != NULL && (s != NULL || len == 0));
+    h = yjson_hash(s, len);
+    mask = t->cap - 1;
+    for (i = h & mask; t->slots[i].s != NULL; i = (i + 1) & mask)
+        if (t->slots[i].hash == h && t->slots[i].len == len && (len == 0 || memcmp(t->slots[i].s, s, len) == 0))
+            return t->slots[i].s;
+    p = (char*)yjson_arena_alloc(&t->strings, len + 1, 1);
+    if (len > 0)
+        memcpy(p, s, len);
+    p[len] = '\0';
+    if (++t->count * 2 > t->cap) {
+        yjson_intern_grow(t);
+        for (mask = t->cap - 1, i = h & mask; t->slots[i].s != NULL; i = (i + 1) & mask)
+            ;
+    }
+    t->slots[i].s = p;
+    t->slots[i].len = len;
+    t->slots[i].hash = h;
+    return p;
+}
+
+static void* yjson_context_alloc(yjson_context* c, size_t size) {
+    YJSON_STAT(allocs, 1);
+    YJSON_STAT(alloc_bytes, size);
+    return c->arena ? yjson_arena_alloc(c->arena, size, YJSON_ARENA_ALIGN) : YJSON_MALLOC(size);
+}
+
+static char* yjson_context_strdup(yjson_context* c, const char* s, size_t len) {
+    char* p = c->arena ? (char*)yjson_arena_alloc(c->arena, len + 1, 1) : (char*)YJSON_MALLOC(len + 1);
+    YJSON_STAT(allocs, 1);
+    YJSON_STAT(alloc_bytes, len + 1);
+    if (len > 0)
+        memcpy(p, s, len);
+    p[len] = '\0';
+    return p;
+}
+
+/*
+ * Scanners behind the string and whitespace loops. yjson_scan_string returns
+ * the first '"', '\\' or control byte (which includes the terminating NUL)
+ * at or after p; yjson_skip_whitespace returns the first non-whitespace byte.
+ *
+ * The vector versions only issue aligned loads. An aligned block never
+ * crosses a page, so reading the rest of the block that holds the NUL is
+ * safe even though it lies past the end of the string; bytes before p in the
+ * first block are shifted out of the mask.
+ */
+#ifndef YJSON_SIMD_X86
+static const char* yjson_scan_string_scalar(const char* p) {
+    while ((unsigned char)*p >= 0x20 && *p != '"' && *p != '\\')
+        p++;
+    return p;
+}
+
+static const char* yjson_skip_whitespace_scalar(const char* p) {
+    while (ISWHITESPACE(*p))
+        p++;
+    return p;
+}
+#else
+#define YJSON_NO_ASAN __attribute__((no_sanitize_address, no_sanitize_thread))
+
+YJSON_NO_ASAN
+static const char* yjson_scan_string_sse2(const char* p) {
+    const __m128i quote = _mm_set1_epi8('"'), bslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+    const char* a = (const char*)((size_t)p & ~(size_t)15);
+    unsigned mask;
+    __m128i x = _mm_load_si128((const __m128i*)a);
+    mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(
+        _mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, bslash)),
+        _mm_cmpeq_epi8(_mm_min_epu8(x, ctrl), x))) >> (p - a);
+    while (mask == 0) {
+        a += 16;
+        x = _mm_load_si128((const __m128i*)a);
+        mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(
+            _mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, bslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(x, ctrl), x)));
+        p = a;
+    }
+    return p + __builtin_ctz(mask);
+}
+
+YJSON_NO_ASAN
+static const char* yjson_skip_whitespace_sse2(const char* p) {
+    const __m128i sp = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+    const __m128i lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+    const char* a = (const char*)((size_t)p & ~(size_t)15);
+    unsigned mask;
+    __m128i x = _mm_load_si128((const __m128i*)a);
+    mask = ((unsigned)_mm_movemask_epi8(_mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(x, sp), _mm_cmpeq_epi8(x, tab)),
+        _mm_or_si128(_mm_cmpeq_epi8(x, lf), _mm_cmpeq_epi8(x, cr)))) ^ 0xFFFFu) >> (p - a);
+    while (mask == 0) {
+        a += 16;
+        x = _mm_load_si128((const __m128i*)a);
+        mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(x, sp), _mm_cmpeq_epi8(x, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(x, lf), _mm_cmpeq_epi8(x, cr)))) ^ 0xFFFFu;
+        p = a;
+    }
+    return p + __builtin_ctz(mask);
+}
+
+YJSON_NO_ASAN __attribute__((target("avx2")))
+static const char* yjson_scan_string_avx2(const char* p) {
+    const __m256i quote = _mm256_set1_epi8('"'), bslash = _mm256_set1_epi8('\\');
+    const __m256i ctrl = _mm256_set1_epi8(0x1F);
+    const char* a = (const char*)((size_t)p & ~(size_t)31);
+    unsigned mask;
+    __m256i x = _mm256_load_si256((const __m256i*)a);
+    mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(
+        _mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, bslash)),
+        _mm256_cmpeq_epi8(_mm256_min_epu8(x, ctrl), x))) >> (p - a);
+    while (mask == 0) {
+        a += 32;
+        x = _mm256_load_si256((const __m256i*)a);
+        mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(
+            _mm256_cmpeq_epi8(x, quote), _mm256_cmpeq_epi8(x, bslash)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(x, ctrl), x)));
+        p = a;
+    }
+    return p + __builtin_ctz(mask);
+}
+
+YJSON_NO_ASAN __attribute__((target("avx2")))
+static const char* yjson_skip_whitespace_avx2(const char* p) {
+    const __m256i sp = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t');
+    const __m256i lf = _mm256_set1_epi8('\n'), cr = _mm256_set1_epi8('\r');
+    const char* a = (const char*)((size_t)p & ~(size_t)31);
+    unsigned mask;
+    __m256i x = _mm256_load_si256((const __m256i*)a);
+    mask = ~(unsigned)_mm256_movemask_epi8(_mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, sp), _mm256_cmpeq_epi8(x, tab)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, lf), _mm256_cmpeq_epi8(x, cr)))) >> (p - a);
+    while (mask == 0) {
+        a += 32;
+        x = _mm256_load_si256((const __m256i*)a);
+        mask = ~(unsigned)_mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, sp), _mm256_cmpeq_epi8(x, tab)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(x, lf), _mm256_cmpeq_epi8(x, cr))));
+        p = a;
+    }
+    return p + __builtin_ctz(mask);
+}
+#endif
+
+/*
+ * The widest scanner the CPU supports is picked once, by a constructor that
+ * runs before main() (or before dlopen() returns), so parses on different
+ * threads never write shared state. Until then the SSE2 versions, which every
+ * x86-64 CPU has, are used.
+ */
+#ifdef YJSON_SIMD_X86
+static const char* (*yjson_scan_string)(const char*) = yjson_scan_string_sse2;
+static const char* (*yjson_skip_whitespace)(const char*) = yjson_skip_whitespace_sse2;
 
+__attribute__((constructor))
+static void yjson_simd_init(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        yjson_scan_string = yjson_scan_string_avx2;
+        yjson_skip_whitespace = yjson_skip_whitespace_avx2;
+    }
+}
+#else
+#define yjson_scan_string yjson_scan_string_scalar
+#define yjson_skip_whitespace yjson_skip_whitespace_scalar
+#endif
 
+/*
+ * The same scans for an input that ends at end rather than at a '\0'; they
+ * return end when they run out. Vector loads are only made while a whole
+ * block is left, the tail goes byte by byte.
+ */
+static const char* yjson_scan_string_n(const char* p, const char* end) {
+#ifdef YJSON_SIMD_X86
+    const __m128i quote = _mm_set1_epi8('"'), bslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+    for (; end - p >= 16; p += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)p);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(
+            _mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, bslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(x, ctrl), x)));
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+#endif
+    while (p != end && (unsigned char)*p >= 0x20 && *p != '"' && *p != '\\')
+        p++;
+    return p;
+}
 
+static const char* yjson_skip_whitespace_n(const char* p, const char* end) {
+#ifdef YJSON_SIMD_X86
+    const __m128i sp = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+    const __m128i lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+    for (; end - p >= 16; p += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)p);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(x, sp), _mm_cmpeq_epi8(x, tab)),
+            _mm_or_si128(_mm_cmpeq_epi8(x, lf), _mm_cmpeq_epi8(x, cr)))) ^ 0xFFFFu;
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+    }
+#endif
+    while (p != end && ISWHITESPACE(*p))
+        p++;
+    return p;
+}
 
 static void yjson_parse_whitespace(yjson_context* c){
     const char *p = c->json;
-    while(*p == ' '|| *p == '\t' || *p == '\n' || *p =='\r')
+    char ch = YJSON_PEEK(c, p);
+    /* most gaps are zero or one byte wide; only longer runs go wide */
+    if(ISWHITESPACE(ch)){
         p++;
+        ch = YJSON_PEEK(c, p);
+        if(ISWHITESPACE(ch))
+            p = c->limit ? yjson_skip_whitespace_n(p, c->limit) : yjson_skip_whitespace(p);
+    }
     c->json = p;
 }
 static int yjson_parse_literal(yjson_context*c,yjson_value* v,const char* literal,yjson_type type){
     size_t i;
     EXPECT(c,literal[0]);
     for(i=0; literal[i+1]; i++){
-        if(c->json[i] !=literal[i+1])
+        if(YJSON_PEEK(c, c->json + i) !=literal[i+1])
             return YJSON_PARSE_INVALID_VALUE;
     }
     c->json +=i;
@@ -43,36 +495,1115 @@ static int yjson_parse_literal(yjson_context*c,yjson_value* v,const char* litera
     return YJSON_PARSE_OK;
 }
 
+/*
+ * Decimal to double conversion. yjson_parse_number() folds up to 19
+ * significant digits into an integer mantissa while it checks the grammar,
+ * so the digits are read once. yjson_decimal_to_double() then tries exact
+ * floating-point arithmetic (Clinger's fast path), the Eisel-Lemire
+ * algorithm, and only for the rare leftovers (halfway cases, subnormals,
+ * overflow, truncated mantissas it cannot settle) an exact big-decimal
+ * conversion. The last two follow the Go strconv package.
+ */
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 yjson_uint128;
+#endif
+
+static uint64_t yjson_mul64(uint64_t a, uint64_t b, uint64_t* lo) {
+#if defined(__SIZEOF_INT128__)
+    yjson_uint128 r = (yjson_uint128)a * b;
+    *lo = (uint64_t)r;
+    return (uint64_t)(r >> 64);
+#else
+    uint64_t a0 = a & 0xFFFFFFFF, a1 = a >> 32, b0 = b & 0xFFFFFFFF, b1 = b >> 32;
+    uint64_t p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    uint64_t mid = (p00 >> 32) + (p01 & 0xFFFFFFFF) + (p10 & 0xFFFFFFFF);
+    *lo = (mid << 32) | (p00 & 0xFFFFFFFF);
+    return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+}
+
+static int yjson_clz64(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while (!(x & (UINT64_C(1) << 63))) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static double yjson_bits_to_double(uint64_t bits) {
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+static const double yjson_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* 128-bit mantissas of 10^q rounded down, {lo, hi}, q in [-348, 347] */
+#define YJSON_POW10_MIN_EXP (-348)
+#define YJSON_POW10_MAX_EXP 347
+static const uint64_t yjson_pow10_128[][2] = {
+    {UINT64_C(0x1732C869CD60E453), UINT64_C(0xFA8FD5A0081C0288)}, /* 1e-348 */
+    {UINT64_C(0x0E7FBD42205C8EB4), UINT64_C(0x9C99E58405118195)}, /* 1e-347 */
+    {UINT64_C(0x521FAC92A873B261), UINT64_C(0xC3C05EE50655E1FA)}, /* 1e-346 */
+    {UINT64_C(0xE6A797B752909EF9), UINT64_C(0xF4B0769E47EB5A78)}, /* 1e-345 */
+    {UINT64_C(0x9028BED2939A635C), UINT64_C(0x98EE4A22ECF3188B)}, /* 1e-344 */
+    {UINT64_C(0x7432EE873880FC33), UINT64_C(0xBF29DCABA82FDEAE)}, /* 1e-343 */
+    {UINT64_C(0x113FAA2906A13B3F), UINT64_C(0xEEF453D6923BD65A)}, /* 1e-342 */
+    {UINT64_C(0x4AC7CA59A424C507), UINT64_C(0x9558B4661B6565F8)}, /* 1e-341 */
+    {UINT64_C(0x5D79BCF00D2DF649), UINT64_C(0xBAAEE17FA23EBF76)}, /* 1e-340 */
+    {UINT64_C(0xF4D82C2C107973DC), UINT64_C(0xE95A99DF8ACE6F53)}, /* 1e-339 */
+    {UINT64_C(0x79071B9B8A4BE869), UINT64_C(0x91D8A02BB6C10594)}, /* 1e-338 */
+    {UINT64_C(0x9748E2826CDEE284), UINT64_C(0xB64EC836A47146F9)}, /* 1e-337 */
+    {UINT64_C(0xFD1B1B2308169B25), UINT64_C(0xE3E27A444D8D98B7)}, /* 1e-336 */
+    {UINT64_C(0xFE30F0F5E50E20F7), UINT64_C(0x8E6D8C6AB0787F72)}, /* 1e-335 */
+    {UINT64_C(0xBDBD2D335E51A935), UINT64_C(0xB208EF855C969F4F)}, /* 1e-334 */
+    {UINT64_C(0xAD2C788035E61382), UINT64_C(0xDE8B2B66B3BC4723)}, /* 1e-333 */
+    {UINT64_C(0x4C3BCB5021AFCC31), UINT64_C(0x8B16FB203055AC76)}, /* 1e-332 */
+    {UINT64_C(0xDF4ABE242A1BBF3D), UINT64_C(0xADDCB9E83C6B1793)}, /* 1e-331 */
+    {UINT64_C(0xD71D6DAD34A2AF0D), UINT64_C(0xD953E8624B85DD78)}, /* 1e-330 */
+    {UINT64_C(0x8672648C40E5AD68), UINT64_C(0x87D4713D6F33AA6B)}, /* 1e-329 */
+    {UINT64_C(0x680EFDAF511F18C2), UINT64_C(0xA9C98D8CCB009506)}, /* 1e-328 */
+    {UINT64_C(0x0212BD1B2566DEF2), UINT64_C(0xD43BF0EFFDC0BA48)}, /* 1e-327 */
+    {UINT64_C(0x014BB630F7604B57), UINT64_C(0x84A57695FE98746D)}, /* 1e-326 */
+    {UINT64_C(0x419EA3BD35385E2D), UINT64_C(0xA5CED43B7E3E9188)}, /* 1e-325 */
+    {UINT64_C(0x52064CAC828675B9), UINT64_C(0xCF42894A5DCE35EA)}, /* 1e-324 */
+    {UINT64_C(0x7343EFEBD1940993), UINT64_C(0x818995CE7AA0E1B2)}, /* 1e-323 */
+    {UINT64_C(0x1014EBE6C5F90BF8), UINT64_C(0xA1EBFB4219491A1F)}, /* 1e-322 */
+    {UINT64_C(0xD41A26E077774EF6), UINT64_C(0xCA66FA129F9B60A6)}, /* 1e-321 */
+    {UINT64_C(0x8920B098955522B4), UINT64_C(0xFD00B897478238D0)}, /* 1e-320 */
+    {UINT64_C(0x55B46E5F5D5535B0), UINT64_C(0x9E20735E8CB16382)}, /* 1e-319 */
+    {UINT64_C(0xEB2189F734AA831D), UINT64_C(0xC5A890362FDDBC62)}, /* 1e-318 */
+    {UINT64_C(0xA5E9EC7501D523E4), UINT64_C(0xF712B443BBD52B7B)}, /* 1e-317 */
+    {UINT64_C(0x47B233C92125366E), UINT64_C(0x9A6BB0AA55653B2D)}, /* 1e-316 */
+    {UINT64_C(0x999EC0BB696E840A), UINT64_C(0xC1069CD4EABE89F8)}, /* 1e-315 */
+    {UINT64_C(0xC00670EA43CA250D), UINT64_C(0xF148440A256E2C76)}, /* 1e-314 */
+    {UINT64_C(0x380406926A5E5728), UINT64_C(0x96CD2A865764DBCA)}, /* 1e-313 */
+    {UINT64_C(0xC605083704F5ECF2), UINT64_C(0xBC807527ED3E12BC)}, /* 1e-312 */
+    {UINT64_C(0xF7864A44C633682E), UINT64_C(0xEBA09271E88D976B)}, /* 1e-311 */
+    {UINT64_C(0x7AB3EE6AFBE0211D), UINT64_C(0x93445B8731587EA3)}, /* 1e-310 */
+    {UINT64_C(0x5960EA05BAD82964), UINT64_C(0xB8157268FDAE9E4C)}, /* 1e-309 */
+    {UINT64_C(0x6FB92487298E33BD), UINT64_C(0xE61ACF033D1A45DF)}, /* 1e-308 */
+    {UINT64_C(0xA5D3B6D479F8E056), UINT64_C(0x8FD0C16206306BAB)}, /* 1e-307 */
+    {UINT64_C(0x8F48A4899877186C), UINT64_C(0xB3C4F1BA87BC8696)}, /* 1e-306 */
+    {UINT64_C(0x331ACDABFE94DE87), UINT64_C(0xE0B62E2929ABA83C)}, /* 1e-305 */
+    {UINT64_C(0x9FF0C08B7F1D0B14), UINT64_C(0x8C71DCD9BA0B4925)}, /* 1e-304 */
+    {UINT64_C(0x07ECF0AE5EE44DD9), UINT64_C(0xAF8E5410288E1B6F)}, /* 1e-303 */
+    {UINT64_C(0xC9E82CD9F69D6150), UINT64_C(0xDB71E91432B1A24A)}, /* 1e-302 */
+    {UINT64_C(0xBE311C083A225CD2), UINT64_C(0x892731AC9FAF056E)}, /* 1e-301 */
+    {UINT64_C(0x6DBD630A48AAF406), UINT64_C(0xAB70FE17C79AC6CA)}, /* 1e-300 */
+    {UINT64_C(0x092CBBCCDAD5B108), UINT64_C(0xD64D3D9DB981787D)}, /* 1e-299 */
+    {UINT64_C(0x25BBF56008C58EA5), UINT64_C(0x85F0468293F0EB4E)}, /* 1e-298 */
+    {UINT64_C(0xAF2AF2B80AF6F24E), UINT64_C(0xA76C582338ED2621)}, /* 1e-297 */
+    {UINT64_C(0x1AF5AF660DB4AEE1), UINT64_C(0xD1476E2C07286FAA)}, /* 1e-296 */
+    {UINT64_C(0x50D98D9FC890ED4D), UINT64_C(0x82CCA4DB847945CA)}, /* 1e-295 */
+    {UINT64_C(0xE50FF107BAB528A0), UINT64_C(0xA37FCE126597973C)}, /* 1e-294 */
+    {UINT64_C(0x1E53ED49A96272C8), UINT64_C(0xCC5FC196FEFD7D0C)}, /* 1e-293 */
+    {UINT64_C(0x25E8E89C13BB0F7A), UINT64_C(0xFF77B1FCBEBCDC4F)}, /* 1e-292 */
+    {UINT64_C(0x77B191618C54E9AC), UINT64_C(0x9FAACF3DF73609B1)}, /* 1e-291 */
+    {UINT64_C(0xD59DF5B9EF6A2417), UINT64_C(0xC795830D75038C1D)}, /* 1e-290 */
+    {UINT64_C(0x4B0573286B44AD1D), UINT64_C(0xF97AE3D0D2446F25)}, /* 1e-289 */
+    {UINT64_C(0x4EE367F9430AEC32), UINT64_C(0x9BECCE62836AC577)}, /* 1e-288 */
+    {UINT64_C(0x229C41F793CDA73F), UINT64_C(0xC2E801FB244576D5)}, /* 1e-287 */
+    {UINT64_C(0x6B43527578C1110F), UINT64_C(0xF3A20279ED56D48A)}, /* 1e-286 */
+    {UINT64_C(0x830A13896B78AAA9), UINT64_C(0x9845418C345644D6)}, /* 1e-285 */
+    {UINT64_C(0x23CC986BC656D553), UINT64_C(0xBE5691EF416BD60C)}, /* 1e-284 */
+    {UINT64_C(0x2CBFBE86B7EC8AA8), UINT64_C(0xEDEC366B11C6CB8F)}, /* 1e-283 */
+    {UINT64_C(0x7BF7D71432F3D6A9), UINT64_C(0x94B3A202EB1C3F39)}, /* 1e-282 */
+    {UINT64_C(0xDAF5CCD93FB0CC53), UINT64_C(0xB9E08A83A5E34F07)}, /* 1e-281 */
+    {UINT64_C(0xD1B3400F8F9CFF68), UINT64_C(0xE858AD248F5C22C9)}, /* 1e-280 */
+    {UINT64_C(0x23100809B9C21FA1), UINT64_C(0x91376C36D99995BE)}, /* 1e-279 */
+    {UINT64_C(0xABD40A0C2832A78A), UINT64_C(0xB58547448FFFFB2D)}, /* 1e-278 */
+    {UINT64_C(0x16C90C8F323F516C), UINT64_C(0xE2E69915B3FFF9F9)}, /* 1e-277 */
+    {UINT64_C(0xAE3DA7D97F6792E3), UINT64_C(0x8DD01FAD907FFC3B)}, /* 1e-276 */
+    {UINT64_C(0x99CD11CFDF41779C), UINT64_C(0xB1442798F49FFB4A)}, /* 1e-275 */
+    {UINT64_C(0x40405643D711D583), UINT64_C(0xDD95317F31C7FA1D)}, /* 1e-274 */
+    {UINT64_C(0x482835EA666B2572), UINT64_C(0x8A7D3EEF7F1CFC52)}, /* 1e-273 */
+    {UINT64_C(0xDA3243650005EECF), UINT64_C(0xAD1C8EAB5EE43B66)}, /* 1e-272 */
+    {UINT64_C(0x90BED43E40076A82), UINT64_C(0xD863B256369D4A40)}, /* 1e-271 */
+    {UINT64_C(0x5A7744A6E804A291), UINT64_C(0x873E4F75E2224E68)}, /* 1e-270 */
+    {UINT64_C(0x711515D0A205CB36), UINT64_C(0xA90DE3535AAAE202)}, /* 1e-269 */
+    {UINT64_C(0x0D5A5B44CA873E03), UINT64_C(0xD3515C2831559A83)}, /* 1e-268 */
+    {UINT64_C(0xE858790AFE9486C2), UINT64_C(0x8412D9991ED58091)}, /* 1e-267 */
+    {UINT64_C(0x626E974DBE39A872), UINT64_C(0xA5178FFF668AE0B6)}, /* 1e-266 */
+    {UINT64_C(0xFB0A3D212DC8128F), UINT64_C(0xCE5D73FF402D98E3)}, /* 1e-265 */
+    {UINT64_C(0x7CE66634BC9D0B99), UINT64_C(0x80FA687F881C7F8E)}, /* 1e-264 */
+    {UINT64_C(0x1C1FFFC1EBC44E80), UINT64_C(0xA139029F6A239F72)}, /* 1e-263 */
+    {UINT64_C(0xA327FFB266B56220), UINT64_C(0xC987434744AC874E)}, /* 1e-262 */
+    {UINT64_C(0x4BF1FF9F0062BAA8), UINT64_C(0xFBE9141915D7A922)}, /* 1e-261 */
+    {UINT64_C(0x6F773FC3603DB4A9), UINT64_C(0x9D71AC8FADA6C9B5)}, /* 1e-260 */
+    {UINT64_C(0xCB550FB4384D21D3), UINT64_C(0xC4CE17B399107C22)}, /* 1e-259 */
+    {UINT64_C(0x7E2A53A146606A48), UINT64_C(0xF6019DA07F549B2B)}, /* 1e-258 */
+    {UINT64_C(0x2EDA7444CBFC426D), UINT64_C(0x99C102844F94E0FB)}, /* 1e-257 */
+    {UINT64_C(0xFA911155FEFB5308), UINT64_C(0xC0314325637A1939)}, /* 1e-256 */
+    {UINT64_C(0x793555AB7EBA27CA), UINT64_C(0xF03D93EEBC589F88)}, /* 1e-255 */
+    {UINT64_C(0x4BC1558B2F3458DE), UINT64_C(0x96267C7535B763B5)}, /* 1e-254 */
+    {UINT64_C(0x9EB1AAEDFB016F16), UINT64_C(0xBBB01B9283253CA2)}, /* 1e-253 */
+    {UINT64_C(0x465E15A979C1CADC), UINT64_C(0xEA9C227723EE8BCB)}, /* 1e-252 */
+    {UINT64_C(0x0BFACD89EC191EC9), UINT64_C(0x92A1958A7675175F)}, /* 1e-251 */
+    {UINT64_C(0xCEF980EC671F667B), UINT64_C(0xB749FAED14125D36)}, /* 1e-250 */
+    {UINT64_C(0x82B7E12780E7401A), UINT64_C(0xE51C79A85916F484)}, /* 1e-249 */
+    {UINT64_C(0xD1B2ECB8B0908810), UINT64_C(0x8F31CC0937AE58D2)}, /* 1e-248 */
+    {UINT64_C(0x861FA7E6DCB4AA15), UINT64_C(0xB2FE3F0B8599EF07)}, /* 1e-247 */
+    {UINT64_C(0x67A791E093E1D49A), UINT64_C(0xDFBDCECE67006AC9)}, /* 1e-246 */
+    {UINT64_C(0xE0C8BB2C5C6D24E0), UINT64_C(0x8BD6A141006042BD)}, /* 1e-245 */
+    {UINT64_C(0x58FAE9F773886E18), UINT64_C(0xAECC49914078536D)}, /* 1e-244 */
+    {UINT64_C(0xAF39A475506A899E), UINT64_C(0xDA7F5BF590966848)}, /* 1e-243 */
+    {UINT64_C(0x6D8406C952429603), UINT64_C(0x888F99797A5E012D)}, /* 1e-242 */
+    {UINT64_C(0xC8E5087BA6D33B83), UINT64_C(0xAAB37FD7D8F58178)}, /* 1e-241 */
+    {UINT64_C(0xFB1E4A9A90880A64), UINT64_C(0xD5605FCDCF32E1D6)}, /* 1e-240 */
+    {UINT64_C(0x5CF2EEA09A55067F), UINT64_C(0x855C3BE0A17FCD26)}, /* 1e-239 */
+    {UINT64_C(0xF42FAA48C0EA481E), UINT64_C(0xA6B34AD8C9DFC06F)}, /* 1e-238 */
+    {UINT64_C(0xF13B94DAF124DA26), UINT64_C(0xD0601D8EFC57B08B)}, /* 1e-237 */
+    {UINT64_C(0x76C53D08D6B70858), UINT64_C(0x823C12795DB6CE57)}, /* 1e-236 */
+    {UINT64_C(0x54768C4B0C64CA6E), UINT64_C(0xA2CB1717B52481ED)}, /* 1e-235 */
+    {UINT64_C(0xA9942F5DCF7DFD09), UINT64_C(0xCB7DDCDDA26DA268)}, /* 1e-234 */
+    {UINT64_C(0xD3F93B35435D7C4C), UINT64_C(0xFE5D54150B090B02)}, /* 1e-233 */
+    {UINT64_C(0xC47BC5014A1A6DAF), UINT64_C(0x9EFA548D26E5A6E1)}, /* 1e-232 */
+    {UINT64_C(0x359AB6419CA1091B), UINT64_C(0xC6B8E9B0709F109A)}, /* 1e-231 */
+    {UINT64_C(0xC30163D203C94B62), UINT64_C(0xF867241C8CC6D4C0)}, /* 1e-230 */
+    {UINT64_C(0x79E0DE63425DCF1D), UINT64_C(0x9B407691D7FC44F8)}, /* 1e-229 */
+    {UINT64_C(0x985915FC12F542E4), UINT64_C(0xC21094364DFB5636)}, /* 1e-228 */
+    {UINT64_C(0x3E6F5B7B17B2939D), UINT64_C(0xF294B943E17A2BC4)}, /* 1e-227 */
+    {UINT64_C(0xA705992CEECF9C42), UINT64_C(0x979CF3CA6CEC5B5A)}, /* 1e-226 */
+    {UINT64_C(0x50C6FF782A838353), UINT64_C(0xBD8430BD08277231)}, /* 1e-225 */
+    {UINT64_C(0xA4F8BF5635246428), UINT64_C(0xECE53CEC4A314EBD)}, /* 1e-224 */
+    {UINT64_C(0x871B7795E136BE99), UINT64_C(0x940F4613AE5ED136)}, /* 1e-223 */
+    {UINT64_C(0x28E2557B59846E3F), UINT64_C(0xB913179899F68584)}, /* 1e-222 */
+    {UINT64_C(0x331AEADA2FE589CF), UINT64_C(0xE757DD7EC07426E5)}, /* 1e-221 */
+    {UINT64_C(0x3FF0D2C85DEF7621), UINT64_C(0x9096EA6F3848984F)}, /* 1e-220 */
+    {UINT64_C(0x0FED077A756B53A9), UINT64_C(0xB4BCA50B065ABE63)}, /* 1e-219 */
+    {UINT64_C(0xD3E8495912C62894), UINT64_C(0xE1EBCE4DC7F16DFB)}, /* 1e-218 */
+    {UINT64_C(0x64712DD7ABBBD95C), UINT64_C(0x8D3360F09CF6E4BD)}, /* 1e-217 */
+    {UINT64_C(0xBD8D794D96AACFB3), UINT64_C(0xB080392CC4349DEC)}, /* 1e-216 */
+    {UINT64_C(0xECF0D7A0FC5583A0), UINT64_C(0xDCA04777F541C567)}, /* 1e-215 */
+    {UINT64_C(0xF41686C49DB57244), UINT64_C(0x89E42CAAF9491B60)}, /* 1e-214 */
+    {UINT64_C(0x311C2875C522CED5), UINT64_C(0xAC5D37D5B79B6239)}, /* 1e-213 */
+    {UINT64_C(0x7D633293366B828B), UINT64_C(0xD77485CB25823AC7)}, /* 1e-212 */
+    {UINT64_C(0xAE5DFF9C02033197), UINT64_C(0x86A8D39EF77164BC)}, /* 1e-211 */
+    {UINT64_C(0xD9F57F830283FDFC), UINT64_C(0xA8530886B54DBDEB)}, /* 1e-210 */
+    {UINT64_C(0xD072DF63C324FD7B), UINT64_C(0xD267CAA862A12D66)}, /* 1e-209 */
+    {UINT64_C(0x4247CB9E59F71E6D), UINT64_C(0x8380DEA93DA4BC60)}, /* 1e-208 */
+    {UINT64_C(0x52D9BE85F074E608), UINT64_C(0xA46116538D0DEB78)}, /* 1e-207 */
+    {UINT64_C(0x67902E276C921F8B), UINT64_C(0xCD795BE870516656)}, /* 1e-206 */
+    {UINT64_C(0x00BA1CD8A3DB53B6), UINT64_C(0x806BD9714632DFF6)}, /* 1e-205 */
+    {UINT64_C(0x80E8A40ECCD228A4), UINT64_C(0xA086CFCD97BF97F3)}, /* 1e-204 */
+    {UINT64_C(0x6122CD128006B2CD), UINT64_C(0xC8A883C0FDAF7DF0)}, /* 1e-203 */
+    {UINT64_C(0x796B805720085F81), UINT64_C(0xFAD2A4B13D1B5D6C)}, /* 1e-202 */
+    {UINT64_C(0xCBE3303674053BB0), UINT64_C(0x9CC3A6EEC6311A63)}, /* 1e-201 */
+    {UINT64_C(0xBEDBFC4411068A9C), UINT64_C(0xC3F490AA77BD60FC)}, /* 1e-200 */
+    {UINT64_C(0xEE92FB5515482D44), UINT64_C(0xF4F1B4D515ACB93B)}, /* 1e-199 */
+    {UINT64_C(0x751BDD152D4D1C4A), UINT64_C(0x991711052D8BF3C5)}, /* 1e-198 */
+    {UINT64_C(0xD262D45A78A0635D), UINT64_C(0xBF5CD54678EEF0B6)}, /* 1e-197 */
+    {UINT64_C(0x86FB897116C87C34), UINT64_C(0xEF340A98172AACE4)}, /* 1e-196 */
+    {UINT64_C(0xD45D35E6AE3D4DA0), UINT64_C(0x9580869F0E7AAC0E)}, /* 1e-195 */
+    {UINT64_C(0x8974836059CCA109), UINT64_C(0xBAE0A846D2195712)}, /* 1e-194 */
+    {UINT64_C(0x2BD1A438703FC94B), UINT64_C(0xE998D258869FACD7)}, /* 1e-193 */
+    {UINT64_C(0x7B6306A34627DDCF), UINT64_C(0x91FF83775423CC06)}, /* 1e-192 */
+    {UINT64_C(0x1A3BC84C17B1D542), UINT64_C(0xB67F6455292CBF08)}, /* 1e-191 */
+    {UINT64_C(0x20CABA5F1D9E4A93), UINT64_C(0xE41F3D6A7377EECA)}, /* 1e-190 */
+    {UINT64_C(0x547EB47B7282EE9C), UINT64_C(0x8E938662882AF53E)}, /* 1e-189 */
+    {UINT64_C(0xE99E619A4F23AA43), UINT64_C(0xB23867FB2A35B28D)}, /* 1e-188 */
+    {UINT64_C(0x6405FA00E2EC94D4), UINT64_C(0xDEC681F9F4C31F31)}, /* 1e-187 */
+    {UINT64_C(0xDE83BC408DD3DD04), UINT64_C(0x8B3C113C38F9F37E)}, /* 1e-186 */
+    {UINT64_C(0x9624AB50B148D445), UINT64_C(0xAE0B158B4738705E)}, /* 1e-185 */
+    {UINT64_C(0x3BADD624DD9B0957), UINT64_C(0xD98DDAEE19068C76)}, /* 1e-184 */
+    {UINT64_C(0xE54CA5D70A80E5D6), UINT64_C(0x87F8A8D4CFA417C9)}, /* 1e-183 */
+    {UINT64_C(0x5E9FCF4CCD211F4C), UINT64_C(0xA9F6D30A038D1DBC)}, /* 1e-182 */
+    {UINT64_C(0x7647C3200069671F), UINT64_C(0xD47487CC8470652B)}, /* 1e-181 */
+    {UINT64_C(0x29ECD9F40041E073), UINT64_C(0x84C8D4DFD2C63F3B)}, /* 1e-180 */
+    {UINT64_C(0xF468107100525890), UINT64_C(0xA5FB0A17C777CF09)}, /* 1e-179 */
+    {UINT64_C(0x7182148D4066EEB4), UINT64_C(0xCF79CC9DB955C2CC)}, /* 1e-178 */
+    {UINT64_C(0xC6F14CD848405530), UINT64_C(0x81AC1FE293D599BF)}, /* 1e-177 */
+    {UINT64_C(0xB8ADA00E5A506A7C), UINT64_C(0xA21727DB38CB002F)}, /* 1e-176 */
+    {UINT64_C(0xA6D90811F0E4851C), UINT64_C(0xCA9CF1D206FDC03B)}, /* 1e-175 */
+    {UINT64_C(0x908F4A166D1DA663), UINT64_C(0xFD442E4688BD304A)}, /* 1e-174 */
+    {UINT64_C(0x9A598E4E043287FE), UINT64_C(0x9E4A9CEC15763E2E)}, /* 1e-173 */
+    {UINT64_C(0x40EFF1E1853F29FD), UINT64_C(0xC5DD44271AD3CDBA)}, /* 1e-172 */
+    {UINT64_C(0xD12BEE59E68EF47C), UINT64_C(0xF7549530E188C128)}, /* 1e-171 */
+    {UINT64_C(0x82BB74F8301958CE), UINT64_C(0x9A94DD3E8CF578B9)}, /* 1e-170 */
+    {UINT64_C(0xE36A52363C1FAF01), UINT64_C(0xC13A148E3032D6E7)}, /* 1e-169 */
+    {UINT64_C(0xDC44E6C3CB279AC1), UINT64_C(0xF18899B1BC3F8CA1)}, /* 1e-168 */
+    {UINT64_C(0x29AB103A5EF8C0B9), UINT64_C(0x96F5600F15A7B7E5)}, /* 1e-167 */
+    {UINT64_C(0x7415D448F6B6F0E7), UINT64_C(0xBCB2B812DB11A5DE)}, /* 1e-166 */
+    {UINT64_C(0x111B495B3464AD21), UINT64_C(0xEBDF661791D60F56)}, /* 1e-165 */
+    {UINT64_C(0xCAB10DD900BEEC34), UINT64_C(0x936B9FCEBB25C995)}, /* 1e-164 */
+    {UINT64_C(0x3D5D514F40EEA742), UINT64_C(0xB84687C269EF3BFB)}, /* 1e-163 */
+    {UINT64_C(0x0CB4A5A3112A5112), UINT64_C(0xE65829B3046B0AFA)}, /* 1e-162 */
+    {UINT64_C(0x47F0E785EABA72AB), UINT64_C(0x8FF71A0FE2C2E6DC)}, /* 1e-161 */
+    {UINT64_C(0x59ED216765690F56), UINT64_C(0xB3F4E093DB73A093)}, /* 1e-160 */
+    {UINT64_C(0x306869C13EC3532C), UINT64_C(0xE0F218B8D25088B8)}, /* 1e-159 */
+    {UINT64_C(0x1E414218C73A13FB), UINT64_C(0x8C974F7383725573)}, /* 1e-158 */
+    {UINT64_C(0xE5D1929EF90898FA), UINT64_C(0xAFBD2350644EEACF)}, /* 1e-157 */
+    {UINT64_C(0xDF45F746B74ABF39), UINT64_C(0xDBAC6C247D62A583)}, /* 1e-156 */
+    {UINT64_C(0x6B8BBA8C328EB783), UINT64_C(0x894BC396CE5DA772)}, /* 1e-155 */
+    {UINT64_C(0x066EA92F3F326564), UINT64_C(0xAB9EB47C81F5114F)}, /* 1e-154 */
+    {UINT64_C(0xC80A537B0EFEFEBD), UINT64_C(0xD686619BA27255A2)}, /* 1e-153 */
+    {UINT64_C(0xBD06742CE95F5F36), UINT64_C(0x8613FD0145877585)}, /* 1e-152 */
+    {UINT64_C(0x2C48113823B73704), UINT64_C(0xA798FC4196E952E7)}, /* 1e-151 */
+    {UINT64_C(0xF75A15862CA504C5), UINT64_C(0xD17F3B51FCA3A7A0)}, /* 1e-150 */
+    {UINT64_C(0x9A984D73DBE722FB), UINT64_C(0x82EF85133DE648C4)}, /* 1e-149 */
+    {UINT64_C(0xC13E60D0D2E0EBBA), UINT64_C(0xA3AB66580D5FDAF5)}, /* 1e-148 */
+    {UINT64_C(0x318DF905079926A8), UINT64_C(0xCC963FEE10B7D1B3)}, /* 1e-147 */
+    {UINT64_C(0xFDF17746497F7052), UINT64_C(0xFFBBCFE994E5C61F)}, /* 1e-146 */
+    {UINT64_C(0xFEB6EA8BEDEFA633), UINT64_C(0x9FD561F1FD0F9BD3)}, /* 1e-145 */
+    {UINT64_C(0xFE64A52EE96B8FC0), UINT64_C(0xC7CABA6E7C5382C8)}, /* 1e-144 */
+    {UINT64_C(0x3DFDCE7AA3C673B0), UINT64_C(0xF9BD690A1B68637B)}, /* 1e-143 */
+    {UINT64_C(0x06BEA10CA65C084E), UINT64_C(0x9C1661A651213E2D)}, /* 1e-142 */
+    {UINT64_C(0x486E494FCFF30A62), UINT64_C(0xC31BFA0FE5698DB8)}, /* 1e-141 */
+    {UINT64_C(0x5A89DBA3C3EFCCFA), UINT64_C(0xF3E2F893DEC3F126)}, /* 1e-140 */
+    {UINT64_C(0xF89629465A75E01C), UINT64_C(0x986DDB5C6B3A76B7)}, /* 1e-139 */
+    {UINT64_C(0xF6BBB397F1135823), UINT64_C(0xBE89523386091465)}, /* 1e-138 */
+    {UINT64_C(0x746AA07DED582E2C), UINT64_C(0xEE2BA6C0678B597F)}, /* 1e-137 */
+    {UINT64_C(0xA8C2A44EB4571CDC), UINT64_C(0x94DB483840B717EF)}, /* 1e-136 */
+    {UINT64_C(0x92F34D62616CE413), UINT64_C(0xBA121A4650E4DDEB)}, /* 1e-135 */
+    {UINT64_C(0x77B020BAF9C81D17), UINT64_C(0xE896A0D7E51E1566)}, /* 1e-134 */
+    {UINT64_C(0x0ACE1474DC1D122E), UINT64_C(0x915E2486EF32CD60)}, /* 1e-133 */
+    {UINT64_C(0x0D819992132456BA), UINT64_C(0xB5B5ADA8AAFF80B8)}, /* 1e-132 */
+    {UINT64_C(0x10E1FFF697ED6C69), UINT64_C(0xE3231912D5BF60E6)}, /* 1e-131 */
+    {UINT64_C(0xCA8D3FFA1EF463C1), UINT64_C(0x8DF5EFABC5979C8F)}, /* 1e-130 */
+    {UINT64_C(0xBD308FF8A6B17CB2), UINT64_C(0xB1736B96B6FD83B3)}, /* 1e-129 */
+    {UINT64_C(0xAC7CB3F6D05DDBDE), UINT64_C(0xDDD0467C64BCE4A0)}, /* 1e-128 */
+    {UINT64_C(0x6BCDF07A423AA96B), UINT64_C(0x8AA22C0DBEF60EE4)}, /* 1e-127 */
+    {UINT64_C(0x86C16C98D2C953C6), UINT64_C(0xAD4AB7112EB3929D)}, /* 1e-126 */
+    {UINT64_C(0xE871C7BF077BA8B7), UINT64_C(0xD89D64D57A607744)}, /* 1e-125 */
+    {UINT64_C(0x11471CD764AD4972), UINT64_C(0x87625F056C7C4A8B)}, /* 1e-124 */
+    {UINT64_C(0xD598E40D3DD89BCF), UINT64_C(0xA93AF6C6C79B5D2D)}, /* 1e-123 */
+    {UINT64_C(0x4AFF1D108D4EC2C3), UINT64_C(0xD389B47879823479)}, /* 1e-122 */
+    {UINT64_C(0xCEDF722A585139BA), UINT64_C(0x843610CB4BF160CB)}, /* 1e-121 */
+    {UINT64_C(0xC2974EB4EE658828), UINT64_C(0xA54394FE1EEDB8FE)}, /* 1e-120 */
+    {UINT64_C(0x733D226229FEEA32), UINT64_C(0xCE947A3DA6A9273E)}, /* 1e-119 */
+    {UINT64_C(0x0806357D5A3F525F), UINT64_C(0x811CCC668829B887)}, /* 1e-118 */
+    {UINT64_C(0xCA07C2DCB0CF26F7), UINT64_C(0xA163FF802A3426A8)}, /* 1e-117 */
+    {UINT64_C(0xFC89B393DD02F0B5), UINT64_C(0xC9BCFF6034C13052)}, /* 1e-116 */
+    {UINT64_C(0xBBAC2078D443ACE2), UINT64_C(0xFC2C3F3841F17C67)}, /* 1e-115 */
+    {UINT64_C(0xD54B944B84AA4C0D), UINT64_C(0x9D9BA7832936EDC0)}, /* 1e-114 */
+    {UINT64_C(0x0A9E795E65D4DF11), UINT64_C(0xC5029163F384A931)}, /* 1e-113 */
+    {UINT64_C(0x4D4617B5FF4A16D5), UINT64_C(0xF64335BCF065D37D)}, /* 1e-112 */
+    {UINT64_C(0x504BCED1BF8E4E45), UINT64_C(0x99EA0196163FA42E)}, /* 1e-111 */
+    {UINT64_C(0xE45EC2862F71E1D6), UINT64_C(0xC06481FB9BCF8D39)}, /* 1e-110 */
+    {UINT64_C(0x5D767327BB4E5A4C), UINT64_C(0xF07DA27A82C37088)}, /* 1e-109 */
+    {UINT64_C(0x3A6A07F8D510F86F), UINT64_C(0x964E858C91BA2655)}, /* 1e-108 */
+    {UINT64_C(0x890489F70A55368B), UINT64_C(0xBBE226EFB628AFEA)}, /* 1e-107 */
+    {UINT64_C(0x2B45AC74CCEA842E), UINT64_C(0xEADAB0ABA3B2DBE5)}, /* 1e-106 */
+    {UINT64_C(0x3B0B8BC90012929D), UINT64_C(0x92C8AE6B464FC96F)}, /* 1e-105 */
+    {UINT64_C(0x09CE6EBB40173744), UINT64_C(0xB77ADA0617E3BBCB)}, /* 1e-104 */
+    {UINT64_C(0xCC420A6A101D0515), UINT64_C(0xE55990879DDCAABD)}, /* 1e-103 */
+    {UINT64_C(0x9FA946824A12232D), UINT64_C(0x8F57FA54C2A9EAB6)}, /* 1e-102 */
+    {UINT64_C(0x47939822DC96ABF9), UINT64_C(0xB32DF8E9F3546564)}, /* 1e-101 */
+    {UINT64_C(0x59787E2B93BC56F7), UINT64_C(0xDFF9772470297EBD)}, /* 1e-100 */
+    {UINT64_C(0x57EB4EDB3C55B65A), UINT64_C(0x8BFBEA76C619EF36)}, /* 1e-99 */
+    {UINT64_C(0xEDE622920B6B23F1), UINT64_C(0xAEFAE51477A06B03)}, /* 1e-98 */
+    {UINT64_C(0xE95FAB368E45ECED), UINT64_C(0xDAB99E59958885C4)}, /* 1e-97 */
+    {UINT64_C(0x11DBCB0218EBB414), UINT64_C(0x88B402F7FD75539B)}, /* 1e-96 */
+    {UINT64_C(0xD652BDC29F26A119), UINT64_C(0xAAE103B5FCD2A881)}, /* 1e-95 */
+    {UINT64_C(0x4BE76D3346F0495F), UINT64_C(0xD59944A37C0752A2)}, /* 1e-94 */
+    {UINT64_C(0x6F70A4400C562DDB), UINT64_C(0x857FCAE62D8493A5)}, /* 1e-93 */
+    {UINT64_C(0xCB4CCD500F6BB952), UINT64_C(0xA6DFBD9FB8E5B88E)}, /* 1e-92 */
+    {UINT64_C(0x7E2000A41346A7A7), UINT64_C(0xD097AD07A71F26B2)}, /* 1e-91 */
+    {UINT64_C(0x8ED400668C0C28C8), UINT64_C(0x825ECC24C873782F)}, /* 1e-90 */
+    {UINT64_C(0x728900802F0F32FA), UINT64_C(0xA2F67F2DFA90563B)}, /* 1e-89 */
+    {UINT64_C(0x4F2B40A03AD2FFB9), UINT64_C(0xCBB41EF979346BCA)}, /* 1e-88 */
+    {UINT64_C(0xE2F610C84987BFA8), UINT64_C(0xFEA126B7D78186BC)}, /* 1e-87 */
+    {UINT64_C(0x0DD9CA7D2DF4D7C9), UINT64_C(0x9F24B832E6B0F436)}, /* 1e-86 */
+    {UINT64_C(0x91503D1C79720DBB), UINT64_C(0xC6EDE63FA05D3143)}, /* 1e-85 */
+    {UINT64_C(0x75A44C6397CE912A), UINT64_C(0xF8A95FCF88747D94)}, /* 1e-84 */
+    {UINT64_C(0xC986AFBE3EE11ABA), UINT64_C(0x9B69DBE1B548CE7C)}, /* 1e-83 */
+    {UINT64_C(0xFBE85BADCE996168), UINT64_C(0xC24452DA229B021B)}, /* 1e-82 */
+    {UINT64_C(0xFAE27299423FB9C3), UINT64_C(0xF2D56790AB41C2A2)}, /* 1e-81 */
+    {UINT64_C(0xDCCD879FC967D41A), UINT64_C(0x97C560BA6B0919A5)}, /* 1e-80 */
+    {UINT64_C(0x5400E987BBC1C920), UINT64_C(0xBDB6B8E905CB600F)}, /* 1e-79 */
+    {UINT64_C(0x290123E9AAB23B68), UINT64_C(0xED246723473E3813)}, /* 1e-78 */
+    {UINT64_C(0xF9A0B6720AAF6521), UINT64_C(0x9436C0760C86E30B)}, /* 1e-77 */
+    {UINT64_C(0xF808E40E8D5B3E69), UINT64_C(0xB94470938FA89BCE)}, /* 1e-76 */
+    {UINT64_C(0xB60B1D1230B20E04), UINT64_C(0xE7958CB87392C2C2)}, /* 1e-75 */
+    {UINT64_C(0xB1C6F22B5E6F48C2), UINT64_C(0x90BD77F3483BB9B9)}, /* 1e-74 */
+    {UINT64_C(0x1E38AEB6360B1AF3), UINT64_C(0xB4ECD5F01A4AA828)}, /* 1e-73 */
+    {UINT64_C(0x25C6DA63C38DE1B0), UINT64_C(0xE2280B6C20DD5232)}, /* 1e-72 */
+    {UINT64_C(0x579C487E5A38AD0E), UINT64_C(0x8D590723948A535F)}, /* 1e-71 */
+    {UINT64_C(0x2D835A9DF0C6D851), UINT64_C(0xB0AF48EC79ACE837)}, /* 1e-70 */
+    {UINT64_C(0xF8E431456CF88E65), UINT64_C(0xDCDB1B2798182244)}, /* 1e-69 */
+    {UINT64_C(0x1B8E9ECB641B58FF), UINT64_C(0x8A08F0F8BF0F156B)}, /* 1e-68 */
+    {UINT64_C(0xE272467E3D222F3F), UINT64_C(0xAC8B2D36EED2DAC5)}, /* 1e-67 */
+    {UINT64_C(0x5B0ED81DCC6ABB0F), UINT64_C(0xD7ADF884AA879177)}, /* 1e-66 */
+    {UINT64_C(0x98E947129FC2B4E9), UINT64_C(0x86CCBB52EA94BAEA)}, /* 1e-65 */
+    {UINT64_C(0x3F2398D747B36224), UINT64_C(0xA87FEA27A539E9A5)}, /* 1e-64 */
+    {UINT64_C(0x8EEC7F0D19A03AAD), UINT64_C(0xD29FE4B18E88640E)}, /* 1e-63 */
+    {UINT64_C(0x1953CF68300424AC), UINT64_C(0x83A3EEEEF9153E89)}, /* 1e-62 */
+    {UINT64_C(0x5FA8C3423C052DD7), UINT64_C(0xA48CEAAAB75A8E2B)}, /* 1e-61 */
+    {UINT64_C(0x3792F412CB06794D), UINT64_C(0xCDB02555653131B6)}, /* 1e-60 */
+    {UINT64_C(0xE2BBD88BBEE40BD0), UINT64_C(0x808E17555F3EBF11)}, /* 1e-59 */
+    {UINT64_C(0x5B6ACEAEAE9D0EC4), UINT64_C(0xA0B19D2AB70E6ED6)}, /* 1e-58 */
+    {UINT64_C(0xF245825A5A445275), UINT64_C(0xC8DE047564D20A8B)}, /* 1e-57 */
+    {UINT64_C(0xEED6E2F0F0D56712), UINT64_C(0xFB158592BE068D2E)}, /* 1e-56 */
+    {UINT64_C(0x55464DD69685606B), UINT64_C(0x9CED737BB6C4183D)}, /* 1e-55 */
+    {UINT64_C(0xAA97E14C3C26B886), UINT64_C(0xC428D05AA4751E4C)}, /* 1e-54 */
+    {UINT64_C(0xD53DD99F4B3066A8), UINT64_C(0xF53304714D9265DF)}, /* 1e-53 */
+    {UINT64_C(0xE546A8038EFE4029), UINT64_C(0x993FE2C6D07B7FAB)}, /* 1e-52 */
+    {UINT64_C(0xDE98520472BDD033), UINT64_C(0xBF8FDB78849A5F96)}, /* 1e-51 */
+    {UINT64_C(0x963E66858F6D4440), UINT64_C(0xEF73D256A5C0F77C)}, /* 1e-50 */
+    {UINT64_C(0xDDE7001379A44AA8), UINT64_C(0x95A8637627989AAD)}, /* 1e-49 */
+    {UINT64_C(0x5560C018580D5D52), UINT64_C(0xBB127C53B17EC159)}, /* 1e-48 */
+    {UINT64_C(0xAAB8F01E6E10B4A6), UINT64_C(0xE9D71B689DDE71AF)}, /* 1e-47 */
+    {UINT64_C(0xCAB3961304CA70E8), UINT64_C(0x9226712162AB070D)}, /* 1e-46 */
+    {UINT64_C(0x3D607B97C5FD0D22), UINT64_C(0xB6B00D69BB55C8D1)}, /* 1e-45 */
+    {UINT64_C(0x8CB89A7DB77C506A), UINT64_C(0xE45C10C42A2B3B05)}, /* 1e-44 */
+    {UINT64_C(0x77F3608E92ADB242), UINT64_C(0x8EB98A7A9A5B04E3)}, /* 1e-43 */
+    {UINT64_C(0x55F038B237591ED3), UINT64_C(0xB267ED1940F1C61C)}, /* 1e-42 */
+    {UINT64_C(0x6B6C46DEC52F6688), UINT64_C(0xDF01E85F912E37A3)}, /* 1e-41 */
+    {UINT64_C(0x2323AC4B3B3DA015), UINT64_C(0x8B61313BBABCE2C6)}, /* 1e-40 */
+    {UINT64_C(0xABEC975E0A0D081A), UINT64_C(0xAE397D8AA96C1B77)}, /* 1e-39 */
+    {UINT64_C(0x96E7BD358C904A21), UINT64_C(0xD9C7DCED53C72255)}, /* 1e-38 */
+    {UINT64_C(0x7E50D64177DA2E54), UINT64_C(0x881CEA14545C7575)}, /* 1e-37 */
+    {UINT64_C(0xDDE50BD1D5D0B9E9), UINT64_C(0xAA242499697392D2)}, /* 1e-36 */
+    {UINT64_C(0x955E4EC64B44E864), UINT64_C(0xD4AD2DBFC3D07787)}, /* 1e-35 */
+    {UINT64_C(0xBD5AF13BEF0B113E), UINT64_C(0x84EC3C97DA624AB4)}, /* 1e-34 */
+    {UINT64_C(0xECB1AD8AEACDD58E), UINT64_C(0xA6274BBDD0FADD61)}, /* 1e-33 */
+    {UINT64_C(0x67DE18EDA5814AF2), UINT64_C(0xCFB11EAD453994BA)}, /* 1e-32 */
+    {UINT64_C(0x80EACF948770CED7), UINT64_C(0x81CEB32C4B43FCF4)}, /* 1e-31 */
+    {UINT64_C(0xA1258379A94D028D), UINT64_C(0xA2425FF75E14FC31)}, /* 1e-30 */
+    {UINT64_C(0x096EE45813A04330), UINT64_C(0xCAD2F7F5359A3B3E)}, /* 1e-29 */
+    {UINT64_C(0x8BCA9D6E188853FC), UINT64_C(0xFD87B5F28300CA0D)}, /* 1e-28 */
+    {UINT64_C(0x775EA264CF55347D), UINT64_C(0x9E74D1B791E07E48)}, /* 1e-27 */
+    {UINT64_C(0x95364AFE032A819D), UINT64_C(0xC612062576589DDA)}, /* 1e-26 */
+    {UINT64_C(0x3A83DDBD83F52204), UINT64_C(0xF79687AED3EEC551)}, /* 1e-25 */
+    {UINT64_C(0xC4926A9672793542), UINT64_C(0x9ABE14CD44753B52)}, /* 1e-24 */
+    {UINT64_C(0x75B7053C0F178293), UINT64_C(0xC16D9A0095928A27)}, /* 1e-23 */
+    {UINT64_C(0x5324C68B12DD6338), UINT64_C(0xF1C90080BAF72CB1)}, /* 1e-22 */
+    {UINT64_C(0xD3F6FC16EBCA5E03), UINT64_C(0x971DA05074DA7BEE)}, /* 1e-21 */
+    {UINT64_C(0x88F4BB1CA6BCF584), UINT64_C(0xBCE5086492111AEA)}, /* 1e-20 */
+    {UINT64_C(0x2B31E9E3D06C32E5), UINT64_C(0xEC1E4A7DB69561A5)}, /* 1e-19 */
+    {UINT64_C(0x3AFF322E62439FCF), UINT64_C(0x9392EE8E921D5D07)}, /* 1e-18 */
+    {UINT64_C(0x09BEFEB9FAD487C2), UINT64_C(0xB877AA3236A4B449)}, /* 1e-17 */
+    {UINT64_C(0x4C2EBE687989A9B3), UINT64_C(0xE69594BEC44DE15B)}, /* 1e-16 */
+    {UINT64_C(0x0F9D37014BF60A10), UINT64_C(0x901D7CF73AB0ACD9)}, /* 1e-15 */
+    {UINT64_C(0x538484C19EF38C94), UINT64_C(0xB424DC35095CD80F)}, /* 1e-14 */
+    {UINT64_C(0x2865A5F206B06FB9), UINT64_C(0xE12E13424BB40E13)}, /* 1e-13 */
+    {UINT64_C(0xF93F87B7442E45D3), UINT64_C(0x8CBCCC096F5088CB)}, /* 1e-12 */
+    {UINT64_C(0xF78F69A51539D748), UINT64_C(0xAFEBFF0BCB24AAFE)}, /* 1e-11 */
+    {UINT64_C(0xB573440E5A884D1B), UINT64_C(0xDBE6FECEBDEDD5BE)}, /* 1e-10 */
+    {UINT64_C(0x31680A88F8953030), UINT64_C(0x89705F4136B4A597)}, /* 1e-9 */
+    {UINT64_C(0xFDC20D2B36BA7C3D), UINT64_C(0xABCC77118461CEFC)}, /* 1e-8 */
+    {UINT64_C(0x3D32907604691B4C), UINT64_C(0xD6BF94D5E57A42BC)}, /* 1e-7 */
+    {UINT64_C(0xA63F9A49C2C1B10F), UINT64_C(0x8637BD05AF6C69B5)}, /* 1e-6 */
+    {UINT64_C(0x0FCF80DC33721D53), UINT64_C(0xA7C5AC471B478423)}, /* 1e-5 */
+    {UINT64_C(0xD3C36113404EA4A8), UINT64_C(0xD1B71758E219652B)}, /* 1e-4 */
+    {UINT64_C(0x645A1CAC083126E9), UINT64_C(0x83126E978D4FDF3B)}, /* 1e-3 */
+    {UINT64_C(0x3D70A3D70A3D70A3), UINT64_C(0xA3D70A3D70A3D70A)}, /* 1e-2 */
+    {UINT64_C(0xCCCCCCCCCCCCCCCC), UINT64_C(0xCCCCCCCCCCCCCCCC)}, /* 1e-1 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0x8000000000000000)}, /* 1e0 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xA000000000000000)}, /* 1e1 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xC800000000000000)}, /* 1e2 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xFA00000000000000)}, /* 1e3 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0x9C40000000000000)}, /* 1e4 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xC350000000000000)}, /* 1e5 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xF424000000000000)}, /* 1e6 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0x9896800000000000)}, /* 1e7 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xBEBC200000000000)}, /* 1e8 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xEE6B280000000000)}, /* 1e9 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0x9502F90000000000)}, /* 1e10 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xBA43B74000000000)}, /* 1e11 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xE8D4A51000000000)}, /* 1e12 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0x9184E72A00000000)}, /* 1e13 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xB5E620F480000000)}, /* 1e14 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xE35FA931A0000000)}, /* 1e15 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0x8E1BC9BF04000000)}, /* 1e16 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xB1A2BC2EC5000000)}, /* 1e17 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xDE0B6B3A76400000)}, /* 1e18 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0x8AC7230489E80000)}, /* 1e19 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xAD78EBC5AC620000)}, /* 1e20 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xD8D726B7177A8000)}, /* 1e21 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0x878678326EAC9000)}, /* 1e22 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xA968163F0A57B400)}, /* 1e23 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xD3C21BCECCEDA100)}, /* 1e24 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0x84595161401484A0)}, /* 1e25 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xA56FA5B99019A5C8)}, /* 1e26 */
+    {UINT64_C(0x0000000000000000), UINT64_C(0xCECB8F27F4200F3A)}, /* 1e27 */
+    {UINT64_C(0x4000000000000000), UINT64_C(0x813F3978F8940984)}, /* 1e28 */
+    {UINT64_C(0x5000000000000000), UINT64_C(0xA18F07D736B90BE5)}, /* 1e29 */
+    {UINT64_C(0xA400000000000000), UINT64_C(0xC9F2C9CD04674EDE)}, /* 1e30 */
+    {UINT64_C(0x4D00000000000000), UINT64_C(0xFC6F7C4045812296)}, /* 1e31 */
+    {UINT64_C(0xF020000000000000), UINT64_C(0x9DC5ADA82B70B59D)}, /* 1e32 */
+    {UINT64_C(0x6C28000000000000), UINT64_C(0xC5371912364CE305)}, /* 1e33 */
+    {UINT64_C(0xC732000000000000), UINT64_C(0xF684DF56C3E01BC6)}, /* 1e34 */
+    {UINT64_C(0x3C7F400000000000), UINT64_C(0x9A130B963A6C115C)}, /* 1e35 */
+    {UINT64_C(0x4B9F100000000000), UINT64_C(0xC097CE7BC90715B3)}, /* 1e36 */
+    {UINT64_C(0x1E86D40000000000), UINT64_C(0xF0BDC21ABB48DB20)}, /* 1e37 */
+    {UINT64_C(0x1314448000000000), UINT64_C(0x96769950B50D88F4)}, /* 1e38 */
+    {UINT64_C(0x17D955A000000000), UINT64_C(0xBC143FA4E250EB31)}, /* 1e39 */
+    {UINT64_C(0x5DCFAB0800000000), UINT64_C(0xEB194F8E1AE525FD)}, /* 1e40 */
+    {UINT64_C(0x5AA1CAE500000000), UINT64_C(0x92EFD1B8D0CF37BE)}, /* 1e41 */
+    {UINT64_C(0xF14A3D9E40000000), UINT64_C(0xB7ABC627050305AD)}, /* 1e42 */
+    {UINT64_C(0x6D9CCD05D0000000), UINT64_C(0xE596B7B0C643C719)}, /* 1e43 */
+    {UINT64_C(0xE4820023A2000000), UINT64_C(0x8F7E32CE7BEA5C6F)}, /* 1e44 */
+    {UINT64_C(0xDDA2802C8A800000), UINT64_C(0xB35DBF821AE4F38B)}, /* 1e45 */
+    {UINT64_C(0xD50B2037AD200000), UINT64_C(0xE0352F62A19E306E)}, /* 1e46 */
+    {UINT64_C(0x4526F422CC340000), UINT64_C(0x8C213D9DA502DE45)}, /* 1e47 */
+    {UINT64_C(0x9670B12B7F410000), UINT64_C(0xAF298D050E4395D6)}, /* 1e48 */
+    {UINT64_C(0x3C0CDD765F114000), UINT64_C(0xDAF3F04651D47B4C)}, /* 1e49 */
+    {UINT64_C(0xA5880A69FB6AC800), UINT64_C(0x88D8762BF324CD0F)}, /* 1e50 */
+    {UINT64_C(0x8EEA0D047A457A00), UINT64_C(0xAB0E93B6EFEE0053)}, /* 1e51 */
+    {UINT64_C(0x72A4904598D6D880), UINT64_C(0xD5D238A4ABE98068)}, /* 1e52 */
+    {UINT64_C(0x47A6DA2B7F864750), UINT64_C(0x85A36366EB71F041)}, /* 1e53 */
+    {UINT64_C(0x999090B65F67D924), UINT64_C(0xA70C3C40A64E6C51)}, /* 1e54 */
+    {UINT64_C(0xFFF4B4E3F741CF6D), UINT64_C(0xD0CF4B50CFE20765)}, /* 1e55 */
+    {UINT64_C(0xBFF8F10E7A8921A4), UINT64_C(0x82818F1281ED449F)}, /* 1e56 */
+    {UINT64_C(0xAFF72D52192B6A0D), UINT64_C(0xA321F2D7226895C7)}, /* 1e57 */
+    {UINT64_C(0x9BF4F8A69F764490), UINT64_C(0xCBEA6F8CEB02BB39)}, /* 1e58 */
+    {UINT64_C(0x02F236D04753D5B4), UINT64_C(0xFEE50B7025C36A08)}, /* 1e59 */
+    {UINT64_C(0x01D762422C946590), UINT64_C(0x9F4F2726179A2245)}, /* 1e60 */
+    {UINT64_C(0x424D3AD2B7B97EF5), UINT64_C(0xC722F0EF9D80AAD6)}, /* 1e61 */
+    {UINT64_C(0xD2E0898765A7DEB2), UINT64_C(0xF8EBAD2B84E0D58B)}, /* 1e62 */
+    {UINT64_C(0x63CC55F49F88EB2F), UINT64_C(0x9B934C3B330C8577)}, /* 1e63 */
+    {UINT64_C(0x3CBF6B71C76B25FB), UINT64_C(0xC2781F49FFCFA6D5)}, /* 1e64 */
+    {UINT64_C(0x8BEF464E3945EF7A), UINT64_C(0xF316271C7FC3908A)}, /* 1e65 */
+    {UINT64_C(0x97758BF0E3CBB5AC), UINT64_C(0x97EDD871CFDA3A56)}, /* 1e66 */
+    {UINT64_C(0x3D52EEED1CBEA317), UINT64_C(0xBDE94E8E43D0C8EC)}, /* 1e67 */
+    {UINT64_C(0x4CA7AAA863EE4BDD), UINT64_C(0xED63A231D4C4FB27)}, /* 1e68 */
+    {UINT64_C(0x8FE8CAA93E74EF6A), UINT64_C(0x945E455F24FB1CF8)}, /* 1e69 */
+    {UINT64_C(0xB3E2FD538E122B44), UINT64_C(0xB975D6B6EE39E436)}, /* 1e70 */
+    {UINT64_C(0x60DBBCA87196B616), UINT64_C(0xE7D34C64A9C85D44)}, /* 1e71 */
+    {UINT64_C(0xBC8955E946FE31CD), UINT64_C(0x90E40FBEEA1D3A4A)}, /* 1e72 */
+    {UINT64_C(0x6BABAB6398BDBE41), UINT64_C(0xB51D13AEA4A488DD)}, /* 1e73 */
+    {UINT64_C(0xC696963C7EED2DD1), UINT64_C(0xE264589A4DCDAB14)}, /* 1e74 */
+    {UINT64_C(0xFC1E1DE5CF543CA2), UINT64_C(0x8D7EB76070A08AEC)}, /* 1e75 */
+    {UINT64_C(0x3B25A55F43294BCB), UINT64_C(0xB0DE65388CC8ADA8)}, /* 1e76 */
+    {UINT64_C(0x49EF0EB713F39EBE), UINT64_C(0xDD15FE86AFFAD912)}, /* 1e77 */
+    {UINT64_C(0x6E3569326C784337), UINT64_C(0x8A2DBF142DFCC7AB)}, /* 1e78 */
+    {UINT64_C(0x49C2C37F07965404), UINT64_C(0xACB92ED9397BF996)}, /* 1e79 */
+    {UINT64_C(0xDC33745EC97BE906), UINT64_C(0xD7E77A8F87DAF7FB)}, /* 1e80 */
+    {UINT64_C(0x69A028BB3DED71A3), UINT64_C(0x86F0AC99B4E8DAFD)}, /* 1e81 */
+    {UINT64_C(0xC40832EA0D68CE0C), UINT64_C(0xA8ACD7C0222311BC)}, /* 1e82 */
+    {UINT64_C(0xF50A3FA490C30190), UINT64_C(0xD2D80DB02AABD62B)}, /* 1e83 */
+    {UINT64_C(0x792667C6DA79E0FA), UINT64_C(0x83C7088E1AAB65DB)}, /* 1e84 */
+    {UINT64_C(0x577001B891185938), UINT64_C(0xA4B8CAB1A1563F52)}, /* 1e85 */
+    {UINT64_C(0xED4C0226B55E6F86), UINT64_C(0xCDE6FD5E09ABCF26)}, /* 1e86 */
+    {UINT64_C(0x544F8158315B05B4), UINT64_C(0x80B05E5AC60B6178)}, /* 1e87 */
+    {UINT64_C(0x696361AE3DB1C721), UINT64_C(0xA0DC75F1778E39D6)}, /* 1e88 */
+    {UINT64_C(0x03BC3A19CD1E38E9), UINT64_C(0xC913936DD571C84C)}, /* 1e89 */
+    {UINT64_C(0x04AB48A04065C723), UINT64_C(0xFB5878494ACE3A5F)}, /* 1e90 */
+    {UINT64_C(0x62EB0D64283F9C76), UINT64_C(0x9D174B2DCEC0E47B)}, /* 1e91 */
+    {UINT64_C(0x3BA5D0BD324F8394), UINT64_C(0xC45D1DF942711D9A)}, /* 1e92 */
+    {UINT64_C(0xCA8F44EC7EE36479), UINT64_C(0xF5746577930D6500)}, /* 1e93 */
+    {UINT64_C(0x7E998B13CF4E1ECB), UINT64_C(0x9968BF6ABBE85F20)}, /* 1e94 */
+    {UINT64_C(0x9E3FEDD8C321A67E), UINT64_C(0xBFC2EF456AE276E8)}, /* 1e95 */
+    {UINT64_C(0xC5CFE94EF3EA101E), UINT64_C(0xEFB3AB16C59B14A2)}, /* 1e96 */
+    {UINT64_C(0xBBA1F1D158724A12), UINT64_C(0x95D04AEE3B80ECE5)}, /* 1e97 */
+    {UINT64_C(0x2A8A6E45AE8EDC97), UINT64_C(0xBB445DA9CA61281F)}, /* 1e98 */
+    {UINT64_C(0xF52D09D71A3293BD), UINT64_C(0xEA1575143CF97226)}, /* 1e99 */
+    {UINT64_C(0x593C2626705F9C56), UINT64_C(0x924D692CA61BE758)}, /* 1e100 */
+    {UINT64_C(0x6F8B2FB00C77836C), UINT64_C(0xB6E0C377CFA2E12E)}, /* 1e101 */
+    {UINT64_C(0x0B6DFB9C0F956447), UINT64_C(0xE498F455C38B997A)}, /* 1e102 */
+    {UINT64_C(0x4724BD4189BD5EAC), UINT64_C(0x8EDF98B59A373FEC)}, /* 1e103 */
+    {UINT64_C(0x58EDEC91EC2CB657), UINT64_C(0xB2977EE300C50FE7)}, /* 1e104 */
+    {UINT64_C(0x2F2967B66737E3ED), UINT64_C(0xDF3D5E9BC0F653E1)}, /* 1e105 */
+    {UINT64_C(0xBD79E0D20082EE74), UINT64_C(0x8B865B215899F46C)}, /* 1e106 */
+    {UINT64_C(0xECD8590680A3AA11), UINT64_C(0xAE67F1E9AEC07187)}, /* 1e107 */
+    {UINT64_C(0xE80E6F4820CC9495), UINT64_C(0xDA01EE641A708DE9)}, /* 1e108 */
+    {UINT64_C(0x3109058D147FDCDD), UINT64_C(0x884134FE908658B2)}, /* 1e109 */
+    {UINT64_C(0xBD4B46F0599FD415), UINT64_C(0xAA51823E34A7EEDE)}, /* 1e110 */
+    {UINT64_C(0x6C9E18AC7007C91A), UINT64_C(0xD4E5E2CDC1D1EA96)}, /* 1e111 */
+    {UINT64_C(0x03E2CF6BC604DDB0), UINT64_C(0x850FADC09923329E)}, /* 1e112 */
+    {UINT64_C(0x84DB8346B786151C), UINT64_C(0xA6539930BF6BFF45)}, /* 1e113 */
+    {UINT64_C(0xE612641865679A63), UINT64_C(0xCFE87F7CEF46FF16)}, /* 1e114 */
+    {UINT64_C(0x4FCB7E8F3F60C07E), UINT64_C(0x81F14FAE158C5F6E)}, /* 1e115 */
+    {UINT64_C(0xE3BE5E330F38F09D), UINT64_C(0xA26DA3999AEF7749)}, /* 1e116 */
+    {UINT64_C(0x5CADF5BFD3072CC5), UINT64_C(0xCB090C8001AB551C)}, /* 1e117 */
+    {UINT64_C(0x73D9732FC7C8F7F6), UINT64_C(0xFDCB4FA002162A63)}, /* 1e118 */
+    {UINT64_C(0x2867E7FDDCDD9AFA), UINT64_C(0x9E9F11C4014DDA7E)}, /* 1e119 */
+    {UINT64_C(0xB281E1FD541501B8), UINT64_C(0xC646D63501A1511D)}, /* 1e120 */
+    {UINT64_C(0x1F225A7CA91A4226), UINT64_C(0xF7D88BC24209A565)}, /* 1e121 */
+    {UINT64_C(0x3375788DE9B06958), UINT64_C(0x9AE757596946075F)}, /* 1e122 */
+    {UINT64_C(0x0052D6B1641C83AE), UINT64_C(0xC1A12D2FC3978937)}, /* 1e123 */
+    {UINT64_C(0xC0678C5DBD23A49A), UINT64_C(0xF209787BB47D6B84)}, /* 1e124 */
+    {UINT64_C(0xF840B7BA963646E0), UINT64_C(0x9745EB4D50CE6332)}, /* 1e125 */
+    {UINT64_C(0xB650E5A93BC3D898), UINT64_C(0xBD176620A501FBFF)}, /* 1e126 */
+    {UINT64_C(0xA3E51F138AB4CEBE), UINT64_C(0xEC5D3FA8CE427AFF)}, /* 1e127 */
+    {UINT64_C(0xC66F336C36B10137), UINT64_C(0x93BA47C980E98CDF)}, /* 1e128 */
+    {UINT64_C(0xB80B0047445D4184), UINT64_C(0xB8A8D9BBE123F017)}, /* 1e129 */
+    {UINT64_C(0xA60DC059157491E5), UINT64_C(0xE6D3102AD96CEC1D)}, /* 1e130 */
+    {UINT64_C(0x87C89837AD68DB2F), UINT64_C(0x9043EA1AC7E41392)}, /* 1e131 */
+    {UINT64_C(0x29BABE4598C311FB), UINT64_C(0xB454E4A179DD1877)}, /* 1e132 */
+    {UINT64_C(0xF4296DD6FEF3D67A), UINT64_C(0xE16A1DC9D8545E94)}, /* 1e133 */
+    {UINT64_C(0x1899E4A65F58660C), UINT64_C(0x8CE2529E2734BB1D)}, /* 1e134 */
+    {UINT64_C(0x5EC05DCFF72E7F8F), UINT64_C(0xB01AE745B101E9E4)}, /* 1e135 */
+    {UINT64_C(0x76707543F4FA1F73), UINT64_C(0xDC21A1171D42645D)}, /* 1e136 */
+    {UINT64_C(0x6A06494A791C53A8), UINT64_C(0x899504AE72497EBA)}, /* 1e137 */
+    {UINT64_C(0x0487DB9D17636892), UINT64_C(0xABFA45DA0EDBDE69)}, /* 1e138 */
+    {UINT64_C(0x45A9D2845D3C42B6), UINT64_C(0xD6F8D7509292D603)}, /* 1e139 */
+    {UINT64_C(0x0B8A2392BA45A9B2), UINT64_C(0x865B86925B9BC5C2)}, /* 1e140 */
+    {UINT64_C(0x8E6CAC7768D7141E), UINT64_C(0xA7F26836F282B732)}, /* 1e141 */
+    {UINT64_C(0x3207D795430CD926), UINT64_C(0xD1EF0244AF2364FF)}, /* 1e142 */
+    {UINT64_C(0x7F44E6BD49E807B8), UINT64_C(0x8335616AED761F1F)}, /* 1e143 */
+    {UINT64_C(0x5F16206C9C6209A6), UINT64_C(0xA402B9C5A8D3A6E7)}, /* 1e144 */
+    {UINT64_C(0x36DBA887C37A8C0F), UINT64_C(0xCD036837130890A1)}, /* 1e145 */
+    {UINT64_C(0xC2494954DA2C9789), UINT64_C(0x802221226BE55A64)}, /* 1e146 */
+    {UINT64_C(0xF2DB9BAA10B7BD6C), UINT64_C(0xA02AA96B06DEB0FD)}, /* 1e147 */
+    {UINT64_C(0x6F92829494E5ACC7), UINT64_C(0xC83553C5C8965D3D)}, /* 1e148 */
+    {UINT64_C(0xCB772339BA1F17F9), UINT64_C(0xFA42A8B73ABBF48C)}, /* 1e149 */
+    {UINT64_C(0xFF2A760414536EFB), UINT64_C(0x9C69A97284B578D7)}, /* 1e150 */
+    {UINT64_C(0xFEF5138519684ABA), UINT64_C(0xC38413CF25E2D70D)}, /* 1e151 */
+    {UINT64_C(0x7EB258665FC25D69), UINT64_C(0xF46518C2EF5B8CD1)}, /* 1e152 */
+    {UINT64_C(0xEF2F773FFBD97A61), UINT64_C(0x98BF2F79D5993802)}, /* 1e153 */
+    {UINT64_C(0xAAFB550FFACFD8FA), UINT64_C(0xBEEEFB584AFF8603)}, /* 1e154 */
+    {UINT64_C(0x95BA2A53F983CF38), UINT64_C(0xEEAABA2E5DBF6784)}, /* 1e155 */
+    {UINT64_C(0xDD945A747BF26183), UINT64_C(0x952AB45CFA97A0B2)}, /* 1e156 */
+    {UINT64_C(0x94F971119AEEF9E4), UINT64_C(0xBA756174393D88DF)}, /* 1e157 */
+    {UINT64_C(0x7A37CD5601AAB85D), UINT64_C(0xE912B9D1478CEB17)}, /* 1e158 */
+    {UINT64_C(0xAC62E055C10AB33A), UINT64_C(0x91ABB422CCB812EE)}, /* 1e159 */
+    {UINT64_C(0x577B986B314D6009), UINT64_C(0xB616A12B7FE617AA)}, /* 1e160 */
+    {UINT64_C(0xED5A7E85FDA0B80B), UINT64_C(0xE39C49765FDF9D94)}, /* 1e161 */
+    {UINT64_C(0x14588F13BE847307), UINT64_C(0x8E41ADE9FBEBC27D)}, /* 1e162 */
+    {UINT64_C(0x596EB2D8AE258FC8), UINT64_C(0xB1D219647AE6B31C)}, /* 1e163 */
+    {UINT64_C(0x6FCA5F8ED9AEF3BB), UINT64_C(0xDE469FBD99A05FE3)}, /* 1e164 */
+    {UINT64_C(0x25DE7BB9480D5854), UINT64_C(0x8AEC23D680043BEE)}, /* 1e165 */
+    {UINT64_C(0xAF561AA79A10AE6A), UINT64_C(0xADA72CCC20054AE9)}, /* 1e166 */
+    {UINT64_C(0x1B2BA1518094DA04), UINT64_C(0xD910F7FF28069DA4)}, /* 1e167 */
+    {UINT64_C(0x90FB44D2F05D0842), UINT64_C(0x87AA9AFF79042286)}, /* 1e168 */
+    {UINT64_C(0x353A1607AC744A53), UINT64_C(0xA99541BF57452B28)}, /* 1e169 */
+    {UINT64_C(0x42889B8997915CE8), UINT64_C(0xD3FA922F2D1675F2)}, /* 1e170 */
+    {UINT64_C(0x69956135FEBADA11), UINT64_C(0x847C9B5D7C2E09B7)}, /* 1e171 */
+    {UINT64_C(0x43FAB9837E699095), UINT64_C(0xA59BC234DB398C25)}, /* 1e172 */
+    {UINT64_C(0x94F967E45E03F4BB), UINT64_C(0xCF02B2C21207EF2E)}, /* 1e173 */
+    {UINT64_C(0x1D1BE0EEBAC278F5), UINT64_C(0x8161AFB94B44F57D)}, /* 1e174 */
+    {UINT64_C(0x6462D92A69731732), UINT64_C(0xA1BA1BA79E1632DC)}, /* 1e175 */
+    {UINT64_C(0x7D7B8F7503CFDCFE), UINT64_C(0xCA28A291859BBF93)}, /* 1e176 */
+    {UINT64_C(0x5CDA735244C3D43E), UINT64_C(0xFCB2CB35E702AF78)}, /* 1e177 */
+    {UINT64_C(0x3A0888136AFA64A7), UINT64_C(0x9DEFBF01B061ADAB)}, /* 1e178 */
+    {UINT64_C(0x088AAA1845B8FDD0), UINT64_C(0xC56BAEC21C7A1916)}, /* 1e179 */
+    {UINT64_C(0x8AAD549E57273D45), UINT64_C(0xF6C69A72A3989F5B)}, /* 1e180 */
+    {UINT64_C(0x36AC54E2F678864B), UINT64_C(0x9A3C2087A63F6399)}, /* 1e181 */
+    {UINT64_C(0x84576A1BB416A7DD), UINT64_C(0xC0CB28A98FCF3C7F)}, /* 1e182 */
+    {UINT64_C(0x656D44A2A11C51D5), UINT64_C(0xF0FDF2D3F3C30B9F)}, /* 1e183 */
+    {UINT64_C(0x9F644AE5A4B1B325), UINT64_C(0x969EB7C47859E743)}, /* 1e184 */
+    {UINT64_C(0x873D5D9F0DDE1FEE), UINT64_C(0xBC4665B596706114)}, /* 1e185 */
+    {UINT64_C(0xA90CB506D155A7EA), UINT64_C(0xEB57FF22FC0C7959)}, /* 1e186 */
+    {UINT64_C(0x09A7F12442D588F2), UINT64_C(0x9316FF75DD87CBD8)}, /* 1e187 */
+    {UINT64_C(0x0C11ED6D538AEB2F), UINT64_C(0xB7DCBF5354E9BECE)}, /* 1e188 */
+    {UINT64_C(0x8F1668C8A86DA5FA), UINT64_C(0xE5D3EF282A242E81)}, /* 1e189 */
+    {UINT64_C(0xF96E017D694487BC), UINT64_C(0x8FA475791A569D10)}, /* 1e190 */
+    {UINT64_C(0x37C981DCC395A9AC), UINT64_C(0xB38D92D760EC4455)}, /* 1e191 */
+    {UINT64_C(0x85BBE253F47B1417), UINT64_C(0xE070F78D3927556A)}, /* 1e192 */
+    {UINT64_C(0x93956D7478CCEC8E), UINT64_C(0x8C469AB843B89562)}, /* 1e193 */
+    {UINT64_C(0x387AC8D1970027B2), UINT64_C(0xAF58416654A6BABB)}, /* 1e194 */
+    {UINT64_C(0x06997B05FCC0319E), UINT64_C(0xDB2E51BFE9D0696A)}, /* 1e195 */
+    {UINT64_C(0x441FECE3BDF81F03), UINT64_C(0x88FCF317F22241E2)}, /* 1e196 */
+    {UINT64_C(0xD527E81CAD7626C3), UINT64_C(0xAB3C2FDDEEAAD25A)}, /* 1e197 */
+    {UINT64_C(0x8A71E223D8D3B074), UINT64_C(0xD60B3BD56A5586F1)}, /* 1e198 */
+    {UINT64_C(0xF6872D5667844E49), UINT64_C(0x85C7056562757456)}, /* 1e199 */
+    {UINT64_C(0xB428F8AC016561DB), UINT64_C(0xA738C6BEBB12D16C)}, /* 1e200 */
+    {UINT64_C(0xE13336D701BEBA52), UINT64_C(0xD106F86E69D785C7)}, /* 1e201 */
+    {UINT64_C(0xECC0024661173473), UINT64_C(0x82A45B450226B39C)}, /* 1e202 */
+    {UINT64_C(0x27F002D7F95D0190), UINT64_C(0xA34D721642B06084)}, /* 1e203 */
+    {UINT64_C(0x31EC038DF7B441F4), UINT64_C(0xCC20CE9BD35C78A5)}, /* 1e204 */
+    {UINT64_C(0x7E67047175A15271), UINT64_C(0xFF290242C83396CE)}, /* 1e205 */
+    {UINT64_C(0x0F0062C6E984D386), UINT64_C(0x9F79A169BD203E41)}, /* 1e206 */
+    {UINT64_C(0x52C07B78A3E60868), UINT64_C(0xC75809C42C684DD1)}, /* 1e207 */
+    {UINT64_C(0xA7709A56CCDF8A82), UINT64_C(0xF92E0C3537826145)}, /* 1e208 */
+    {UINT64_C(0x88A66076400BB691), UINT64_C(0x9BBCC7A142B17CCB)}, /* 1e209 */
+    {UINT64_C(0x6ACFF893D00EA435), UINT64_C(0xC2ABF989935DDBFE)}, /* 1e210 */
+    {UINT64_C(0x0583F6B8C4124D43), UINT64_C(0xF356F7EBF83552FE)}, /* 1e211 */
+    {UINT64_C(0xC3727A337A8B704A), UINT64_C(0x98165AF37B2153DE)}, /* 1e212 */
+    {UINT64_C(0x744F18C0592E4C5C), UINT64_C(0xBE1BF1B059E9A8D6)}, /* 1e213 */
+    {UINT64_C(0x1162DEF06F79DF73), UINT64_C(0xEDA2EE1C7064130C)}, /* 1e214 */
+    {UINT64_C(0x8ADDCB5645AC2BA8), UINT64_C(0x9485D4D1C63E8BE7)}, /* 1e215 */
+    {UINT64_C(0x6D953E2BD7173692), UINT64_C(0xB9A74A0637CE2EE1)}, /* 1e216 */
+    {UINT64_C(0xC8FA8DB6CCDD0437), UINT64_C(0xE8111C87C5C1BA99)}, /* 1e217 */
+    {UINT64_C(0x1D9C9892400A22A2), UINT64_C(0x910AB1D4DB9914A0)}, /* 1e218 */
+    {UINT64_C(0x2503BEB6D00CAB4B), UINT64_C(0xB54D5E4A127F59C8)}, /* 1e219 */
+    {UINT64_C(0x2E44AE64840FD61D), UINT64_C(0xE2A0B5DC971F303A)}, /* 1e220 */
+    {UINT64_C(0x5CEAECFED289E5D2), UINT64_C(0x8DA471A9DE737E24)}, /* 1e221 */
+    {UINT64_C(0x7425A83E872C5F47), UINT64_C(0xB10D8E1456105DAD)}, /* 1e222 */
+    {UINT64_C(0xD12F124E28F77719), UINT64_C(0xDD50F1996B947518)}, /* 1e223 */
+    {UINT64_C(0x82BD6B70D99AAA6F), UINT64_C(0x8A5296FFE33CC92F)}, /* 1e224 */
+    {UINT64_C(0x636CC64D1001550B), UINT64_C(0xACE73CBFDC0BFB7B)}, /* 1e225 */
+    {UINT64_C(0x3C47F7E05401AA4E), UINT64_C(0xD8210BEFD30EFA5A)}, /* 1e226 */
+    {UINT64_C(0x65ACFAEC34810A71), UINT64_C(0x8714A775E3E95C78)}, /* 1e227 */
+    {UINT64_C(0x7F1839A741A14D0D), UINT64_C(0xA8D9D1535CE3B396)}, /* 1e228 */
+    {UINT64_C(0x1EDE48111209A050), UINT64_C(0xD31045A8341CA07C)}, /* 1e229 */
+    {UINT64_C(0x934AED0AAB460432), UINT64_C(0x83EA2B892091E44D)}, /* 1e230 */
+    {UINT64_C(0xF81DA84D5617853F), UINT64_C(0xA4E4B66B68B65D60)}, /* 1e231 */
+    {UINT64_C(0x36251260AB9D668E), UINT64_C(0xCE1DE40642E3F4B9)}, /* 1e232 */
+    {UINT64_C(0xC1D72B7C6B426019), UINT64_C(0x80D2AE83E9CE78F3)}, /* 1e233 */
+    {UINT64_C(0xB24CF65B8612F81F), UINT64_C(0xA1075A24E4421730)}, /* 1e234 */
+    {UINT64_C(0xDEE033F26797B627), UINT64_C(0xC94930AE1D529CFC)}, /* 1e235 */
+    {UINT64_C(0x169840EF017DA3B1), UINT64_C(0xFB9B7CD9A4A7443C)}, /* 1e236 */
+    {UINT64_C(0x8E1F289560EE864E), UINT64_C(0x9D412E0806E88AA5)}, /* 1e237 */
+    {UINT64_C(0xF1A6F2BAB92A27E2), UINT64_C(0xC491798A08A2AD4E)}, /* 1e238 */
+    {UINT64_C(0xAE10AF696774B1DB), UINT64_C(0xF5B5D7EC8ACB58A2)}, /* 1e239 */
+    {UINT64_C(0xACCA6DA1E0A8EF29), UINT64_C(0x9991A6F3D6BF1765)}, /* 1e240 */
+    {UINT64_C(0x17FD090A58D32AF3), UINT64_C(0xBFF610B0CC6EDD3F)}, /* 1e241 */
+    {UINT64_C(0xDDFC4B4CEF07F5B0), UINT64_C(0xEFF394DCFF8A948E)}, /* 1e242 */
+    {UINT64_C(0x4ABDAF101564F98E), UINT64_C(0x95F83D0A1FB69CD9)}, /* 1e243 */
+    {UINT64_C(0x9D6D1AD41ABE37F1), UINT64_C(0xBB764C4CA7A4440F)}, /* 1e244 */
+    {UINT64_C(0x84C86189216DC5ED), UINT64_C(0xEA53DF5FD18D5513)}, /* 1e245 */
+    {UINT64_C(0x32FD3CF5B4E49BB4), UINT64_C(0x92746B9BE2F8552C)}, /* 1e246 */
+    {UINT64_C(0x3FBC8C33221DC2A1), UINT64_C(0xB7118682DBB66A77)}, /* 1e247 */
+    {UINT64_C(0x0FABAF3FEAA5334A), UINT64_C(0xE4D5E82392A40515)}, /* 1e248 */
+    {UINT64_C(0x29CB4D87F2A7400E), UINT64_C(0x8F05B1163BA6832D)}, /* 1e249 */
+    {UINT64_C(0x743E20E9EF511012), UINT64_C(0xB2C71D5BCA9023F8)}, /* 1e250 */
+    {UINT64_C(0x914DA9246B255416), UINT64_C(0xDF78E4B2BD342CF6)}, /* 1e251 */
+    {UINT64_C(0x1AD089B6C2F7548E), UINT64_C(0x8BAB8EEFB6409C1A)}, /* 1e252 */
+    {UINT64_C(0xA184AC2473B529B1), UINT64_C(0xAE9672ABA3D0C320)}, /* 1e253 */
+    {UINT64_C(0xC9E5D72D90A2741E), UINT64_C(0xDA3C0F568CC4F3E8)}, /* 1e254 */
+    {UINT64_C(0x7E2FA67C7A658892), UINT64_C(0x8865899617FB1871)}, /* 1e255 */
+    {UINT64_C(0xDDBB901B98FEEAB7), UINT64_C(0xAA7EEBFB9DF9DE8D)}, /* 1e256 */
+    {UINT64_C(0x552A74227F3EA565), UINT64_C(0xD51EA6FA85785631)}, /* 1e257 */
+    {UINT64_C(0xD53A88958F87275F), UINT64_C(0x8533285C936B35DE)}, /* 1e258 */
+    {UINT64_C(0x8A892ABAF368F137), UINT64_C(0xA67FF273B8460356)}, /* 1e259 */
+    {UINT64_C(0x2D2B7569B0432D85), UINT64_C(0xD01FEF10A657842C)}, /* 1e260 */
+    {UINT64_C(0x9C3B29620E29FC73), UINT64_C(0x8213F56A67F6B29B)}, /* 1e261 */
+    {UINT64_C(0x8349F3BA91B47B8F), UINT64_C(0xA298F2C501F45F42)}, /* 1e262 */
+    {UINT64_C(0x241C70A936219A73), UINT64_C(0xCB3F2F7642717713)}, /* 1e263 */
+    {UINT64_C(0xED238CD383AA0110), UINT64_C(0xFE0EFB53D30DD4D7)}, /* 1e264 */
+    {UINT64_C(0xF4363804324A40AA), UINT64_C(0x9EC95D1463E8A506)}, /* 1e265 */
+    {UINT64_C(0xB143C6053EDCD0D5), UINT64_C(0xC67BB4597CE2CE48)}, /* 1e266 */
+    {UINT64_C(0xDD94B7868E94050A), UINT64_C(0xF81AA16FDC1B81DA)}, /* 1e267 */
+    {UINT64_C(0xCA7CF2B4191C8326), UINT64_C(0x9B10A4E5E9913128)}, /* 1e268 */
+    {UINT64_C(0xFD1C2F611F63A3F0), UINT64_C(0xC1D4CE1F63F57D72)}, /* 1e269 */
+    {UINT64_C(0xBC633B39673C8CEC), UINT64_C(0xF24A01A73CF2DCCF)}, /* 1e270 */
+    {UINT64_C(0xD5BE0503E085D813), UINT64_C(0x976E41088617CA01)}, /* 1e271 */
+    {UINT64_C(0x4B2D8644D8A74E18), UINT64_C(0xBD49D14AA79DBC82)}, /* 1e272 */
+    {UINT64_C(0xDDF8E7D60ED1219E), UINT64_C(0xEC9C459D51852BA2)}, /* 1e273 */
+    {UINT64_C(0xCABB90E5C942B503), UINT64_C(0x93E1AB8252F33B45)}, /* 1e274 */
+    {UINT64_C(0x3D6A751F3B936243), UINT64_C(0xB8DA1662E7B00A17)}, /* 1e275 */
+    {UINT64_C(0x0CC512670A783AD4), UINT64_C(0xE7109BFBA19C0C9D)}, /* 1e276 */
+    {UINT64_C(0x27FB2B80668B24C5), UINT64_C(0x906A617D450187E2)}, /* 1e277 */
+    {UINT64_C(0xB1F9F660802DEDF6), UINT64_C(0xB484F9DC9641E9DA)}, /* 1e278 */
+    {UINT64_C(0x5E7873F8A0396973), UINT64_C(0xE1A63853BBD26451)}, /* 1e279 */
+    {UINT64_C(0xDB0B487B6423E1E8), UINT64_C(0x8D07E33455637EB2)}, /* 1e280 */
+    {UINT64_C(0x91CE1A9A3D2CDA62), UINT64_C(0xB049DC016ABC5E5F)}, /* 1e281 */
+    {UINT64_C(0x7641A140CC7810FB), UINT64_C(0xDC5C5301C56B75F7)}, /* 1e282 */
+    {UINT64_C(0xA9E904C87FCB0A9D), UINT64_C(0x89B9B3E11B6329BA)}, /* 1e283 */
+    {UINT64_C(0x546345FA9FBDCD44), UINT64_C(0xAC2820D9623BF429)}, /* 1e284 */
+    {UINT64_C(0xA97C177947AD4095), UINT64_C(0xD732290FBACAF133)}, /* 1e285 */
+    {UINT64_C(0x49ED8EABCCCC485D), UINT64_C(0x867F59A9D4BED6C0)}, /* 1e286 */
+    {UINT64_C(0x5C68F256BFFF5A74), UINT64_C(0xA81F301449EE8C70)}, /* 1e287 */
+    {UINT64_C(0x73832EEC6FFF3111), UINT64_C(0xD226FC195C6A2F8C)}, /* 1e288 */
+    {UINT64_C(0xC831FD53C5FF7EAB), UINT64_C(0x83585D8FD9C25DB7)}, /* 1e289 */
+    {UINT64_C(0xBA3E7CA8B77F5E55), UINT64_C(0xA42E74F3D032F525)}, /* 1e290 */
+    {UINT64_C(0x28CE1BD2E55F35EB), UINT64_C(0xCD3A1230C43FB26F)}, /* 1e291 */
+    {UINT64_C(0x7980D163CF5B81B3), UINT64_C(0x80444B5E7AA7CF85)}, /* 1e292 */
+    {UINT64_C(0xD7E105BCC332621F), UINT64_C(0xA0555E361951C366)}, /* 1e293 */
+    {UINT64_C(0x8DD9472BF3FEFAA7), UINT64_C(0xC86AB5C39FA63440)}, /* 1e294 */
+    {UINT64_C(0xB14F98F6F0FEB951), UINT64_C(0xFA856334878FC150)}, /* 1e295 */
+    {UINT64_C(0x6ED1BF9A569F33D3), UINT64_C(0x9C935E00D4B9D8D2)}, /* 1e296 */
+    {UINT64_C(0x0A862F80EC4700C8), UINT64_C(0xC3B8358109E84F07)}, /* 1e297 */
+    {UINT64_C(0xCD27BB612758C0FA), UINT64_C(0xF4A642E14C6262C8)}, /* 1e298 */
+    {UINT64_C(0x8038D51CB897789C), UINT64_C(0x98E7E9CCCFBD7DBD)}, /* 1e299 */
+    {UINT64_C(0xE0470A63E6BD56C3), UINT64_C(0xBF21E44003ACDD2C)}, /* 1e300 */
+    {UINT64_C(0x1858CCFCE06CAC74), UINT64_C(0xEEEA5D5004981478)}, /* 1e301 */
+    {UINT64_C(0x0F37801E0C43EBC8), UINT64_C(0x95527A5202DF0CCB)}, /* 1e302 */
+    {UINT64_C(0xD30560258F54E6BA), UINT64_C(0xBAA718E68396CFFD)}, /* 1e303 */
+    {UINT64_C(0x47C6B82EF32A2069), UINT64_C(0xE950DF20247C83FD)}, /* 1e304 */
+    {UINT64_C(0x4CDC331D57FA5441), UINT64_C(0x91D28B7416CDD27E)}, /* 1e305 */
+    {UINT64_C(0xE0133FE4ADF8E952), UINT64_C(0xB6472E511C81471D)}, /* 1e306 */
+    {UINT64_C(0x58180FDDD97723A6), UINT64_C(0xE3D8F9E563A198E5)}, /* 1e307 */
+    {UINT64_C(0x570F09EAA7EA7648), UINT64_C(0x8E679C2F5E44FF8F)}, /* 1e308 */
+    {UINT64_C(0x2CD2CC6551E513DA), UINT64_C(0xB201833B35D63F73)}, /* 1e309 */
+    {UINT64_C(0xF8077F7EA65E58D1), UINT64_C(0xDE81E40A034BCF4F)}, /* 1e310 */
+    {UINT64_C(0xFB04AFAF27FAF782), UINT64_C(0x8B112E86420F6191)}, /* 1e311 */
+    {UINT64_C(0x79C5DB9AF1F9B563), UINT64_C(0xADD57A27D29339F6)}, /* 1e312 */
+    {UINT64_C(0x18375281AE7822BC), UINT64_C(0xD94AD8B1C7380874)}, /* 1e313 */
+    {UINT64_C(0x8F2293910D0B15B5), UINT64_C(0x87CEC76F1C830548)}, /* 1e314 */
+    {UINT64_C(0xB2EB3875504DDB22), UINT64_C(0xA9C2794AE3A3C69A)}, /* 1e315 */
+    {UINT64_C(0x5FA60692A46151EB), UINT64_C(0xD433179D9C8CB841)}, /* 1e316 */
+    {UINT64_C(0xDBC7C41BA6BCD333), UINT64_C(0x849FEEC281D7F328)}, /* 1e317 */
+    {UINT64_C(0x12B9B522906C0800), UINT64_C(0xA5C7EA73224DEFF3)}, /* 1e318 */
+    {UINT64_C(0xD768226B34870A00), UINT64_C(0xCF39E50FEAE16BEF)}, /* 1e319 */
+    {UINT64_C(0xE6A1158300D46640), UINT64_C(0x81842F29F2CCE375)}, /* 1e320 */
+    {UINT64_C(0x60495AE3C1097FD0), UINT64_C(0xA1E53AF46F801C53)}, /* 1e321 */
+    {UINT64_C(0x385BB19CB14BDFC4), UINT64_C(0xCA5E89B18B602368)}, /* 1e322 */
+    {UINT64_C(0x46729E03DD9ED7B5), UINT64_C(0xFCF62C1DEE382C42)}, /* 1e323 */
+    {UINT64_C(0x6C07A2C26A8346D1), UINT64_C(0x9E19DB92B4E31BA9)}, /* 1e324 */
+    {UINT64_C(0xC7098B7305241885), UINT64_C(0xC5A05277621BE293)}, /* 1e325 */
+    {UINT64_C(0xB8CBEE4FC66D1EA7), UINT64_C(0xF70867153AA2DB38)}, /* 1e326 */
+    {UINT64_C(0x737F74F1DC043328), UINT64_C(0x9A65406D44A5C903)}, /* 1e327 */
+    {UINT64_C(0x505F522E53053FF2), UINT64_C(0xC0FE908895CF3B44)}, /* 1e328 */
+    {UINT64_C(0x647726B9E7C68FEF), UINT64_C(0xF13E34AABB430A15)}, /* 1e329 */
+    {UINT64_C(0x5ECA783430DC19F5), UINT64_C(0x96C6E0EAB509E64D)}, /* 1e330 */
+    {UINT64_C(0xB67D16413D132072), UINT64_C(0xBC789925624C5FE0)}, /* 1e331 */
+    {UINT64_C(0xE41C5BD18C57E88F), UINT64_C(0xEB96BF6EBADF77D8)}, /* 1e332 */
+    {UINT64_C(0x8E91B962F7B6F159), UINT64_C(0x933E37A534CBAAE7)}, /* 1e333 */
+    {UINT64_C(0x723627BBB5A4ADB0), UINT64_C(0xB80DC58E81FE95A1)}, /* 1e334 */
+    {UINT64_C(0xCEC3B1AAA30DD91C), UINT64_C(0xE61136F2227E3B09)}, /* 1e335 */
+    {UINT64_C(0x213A4F0AA5E8A7B1), UINT64_C(0x8FCAC257558EE4E6)}, /* 1e336 */
+    {UINT64_C(0xA988E2CD4F62D19D), UINT64_C(0xB3BD72ED2AF29E1F)}, /* 1e337 */
+    {UINT64_C(0x93EB1B80A33B8605), UINT64_C(0xE0ACCFA875AF45A7)}, /* 1e338 */
+    {UINT64_C(0xBC72F130660533C3), UINT64_C(0x8C6C01C9498D8B88)}, /* 1e339 */
+    {UINT64_C(0xEB8FAD7C7F8680B4), UINT64_C(0xAF87023B9BF0EE6A)}, /* 1e340 */
+    {UINT64_C(0xA67398DB9F6820E1), UINT64_C(0xDB68C2CA82ED2A05)}, /* 1e341 */
+    {UINT64_C(0x88083F8943A1148C), UINT64_C(0x892179BE91D43A43)}, /* 1e342 */
+    {UINT64_C(0x6A0A4F6B948959B0), UINT64_C(0xAB69D82E364948D4)}, /* 1e343 */
+    {UINT64_C(0x848CE34679ABB01C), UINT64_C(0xD6444E39C3DB9B09)}, /* 1e344 */
+    {UINT64_C(0xF2D80E0C0C0B4E11), UINT64_C(0x85EAB0E41A6940E5)}, /* 1e345 */
+    {UINT64_C(0x6F8E118F0F0E2195), UINT64_C(0xA7655D1D2103911F)}, /* 1e346 */
+    {UINT64_C(0x4B7195F2D2D1A9FB), UINT64_C(0xD13EB46469447567)}  /* 1e347 */
+};
+
+static int yjson_fast_path(uint64_t m, int e10, int neg, double* d) {
+    double f;
+    if (m >> 53)
+        return 0;
+    f = (double)m;
+    if (e10 < 0) {
+        if (e10 < -22)
+            return 0;
+        f /= yjson_pow10[-e10];
+    }
+    else if (e10 > 0) {
+        if (e10 > 22 + 15)
+            return 0;
+        /* a short mantissa can absorb a few of the zeros exactly */
+        if (e10 > 22) {
+            f *= yjson_pow10[e10 - 22];
+            e10 = 22;
+            if (f > 1e15)
+                return 0;
+        }
+        f *= yjson_pow10[e10];
+    }
+    *d = neg ? -f : f;
+    return 1;
+}
+
+static int yjson_eisel_lemire(uint64_t m, int e10, int neg, double* d) {
+    uint64_t x_hi, x_lo, mant, exp2;
+    const uint64_t* pow;
+    int clz, msb;
+    if (m == 0) {
+        *d = neg ? -0.0 : 0.0;
+        return 1;
+    }
+    if (e10 < YJSON_POW10_MIN_EXP || e10 > YJSON_POW10_MAX_EXP)
+        return 0;
+    pow = yjson_pow10_128[e10 - YJSON_POW10_MIN_EXP];
+    clz = yjson_clz64(m);
+    m <<= clz;
+    /* floor(log2(10) * e10) + 64 + bias */
+    exp2 = (uint64_t)((e10 >= 0 ? (217706 * e10) >> 16 : -((-217706 * e10 + 65535) >> 16)) + 64 + 1023) - clz;
+
+    x_hi = yjson_mul64(m, pow[1], &x_lo);
+    if ((x_hi & 0x1FF) == 0x1FF && x_lo + m < m) {
+        uint64_t y_hi, y_lo, merged_hi = x_hi, merged_lo;
+        y_hi = yjson_mul64(m, pow[0], &y_lo);
+        merged_lo = x_lo + y_hi;
+        if (merged_lo < x_lo)
+            merged_hi++;
+        if ((merged_hi & 0x1FF) == 0x1FF && merged_lo + 1 == 0 && y_lo + m < m)
+            return 0;
+        x_hi = merged_hi;
+        x_lo = merged_lo;
+    }
+
+    msb = (int)(x_hi >> 63);
+    mant = x_hi >> (msb + 9);
+    exp2 -= 1 ^ msb;
+    /* halfway between two doubles: let the exact path decide */
+    if (x_lo == 0 && (x_hi & 0x1FF) == 0 && (mant & 3) == 1)
+        return 0;
+
+    mant += mant & 1;
+    mant >>= 1;
+    if (mant >> 53) {
+        mant >>= 1;
+        exp2++;
+    }
+    /* subnormal, zero or infinite */
+    if (exp2 - 1 >= 0x7FF - 1)
+        return 0;
+    *d = yjson_bits_to_double(exp2 << 52 | (mant & ((UINT64_C(1) << 52) - 1)) | (uint64_t)neg << 63);
+    return 1;
+}
+
+#define YJSON_DECIMAL_DIGITS 800
+#define YJSON_DECIMAL_MAX_SHIFT 60
+
+typedef struct {
+    char d[YJSON_DECIMAL_DIGITS]; /* digits, most significant first */
+    int nd;    /* number of digits used */
+    int dp;    /* decimal point */
+    int trunc; /* nonzero digits were dropped beyond d[nd] */
+} yjson_decimal;
+
+static void yjson_decimal_trim(yjson_decimal* a) {
+    while (a->nd > 0 && a->d[a->nd - 1] == '0')
+        a->nd--;
+    if (a->nd == 0)
+        a->dp = 0;
+}
+
+/* p..end is a number that already passed the grammar check */
+static void yjson_decimal_set(yjson_decimal* a, const char* p, const char* end) {
+    int e = 0, eneg = 0;
+    a->nd = a->dp = a->trunc = 0;
+    if (*p == '-')
+        p++;
+    for (; p < end && ISDIGIT(*p); p++) {
+        if (*p == '0' && a->nd == 0)
+            continue;
+        if (a->nd < YJSON_DECIMAL_DIGITS)
+            a->d[a->nd++] = *p;
+        else if (*p != '0')
+            a->trunc = 1;
+        a->dp++;
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && ISDIGIT(*p); p++) {
+            if (*p == '0' && a->nd == 0) {
+                a->dp--;
+                continue;
+            }
+            if (a->nd < YJSON_DECIMAL_DIGITS)
+                a->d[a->nd++] = *p;
+            else if (*p != '0')
+                a->trunc = 1;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (*p == '+' || *p == '-')
+            eneg = *p++ == '-';
+        for (; p < end && ISDIGIT(*p); p++)
+            if (e < 10000)
+                e = e * 10 + (*p - '0');
+        a->dp += eneg ? -e : e;
+    }
+}
+
+static void yjson_decimal_right_shift(yjson_decimal* a, int k) {
+    int r = 0, w = 0;
+    uint64_t n = 0, mask = (UINT64_C(1) << k) - 1;
+    for (; (n >> k) == 0; r++) {
+        if (r >= a->nd) {
+            if (n == 0) {
+                a->nd = 0;
+                return;
+            }
+            while ((n >> k) == 0) {
+                n *= 10;
+                r++;
+            }
+            break;
+        }
+        n = n * 10 + (a->d[r] - '0');
+    }
+    a->dp -= r - 1;
+    for (; r < a->nd; r++) {
+        uint64_t dig = n >> k;
+        n &= mask;
+        a->d[w++] = (char)('0' + dig);
+        n = n * 10 + (a->d[r] - '0');
+    }
+    while (n > 0) {
+        uint64_t dig = n >> k;
+        n &= mask;
+        if (w < YJSON_DECIMAL_DIGITS)
+            a->d[w++] = (char)('0' + dig);
+        else if (dig > 0)
+            a->trunc = 1;
+        n *= 10;
+    }
+    a->nd = w;
+    yjson_decimal_trim(a);
+}
+
+static void yjson_decimal_left_shift(yjson_decimal* a, int k) {
+    /* 2^60 has 19 digits, so the product grows by at most that many */
+    char tmp[YJSON_DECIMAL_DIGITS + 19];
+    int r, w = a->nd + 19, i;
+    uint64_t n = 0;
+    for (r = a->nd - 1; r >= 0; r--) {
+        n += (uint64_t)(a->d[r] - '0') << k;
+        tmp[--w] = (char)('0' + n % 10);
+        n /= 10;
+    }
+    while (n > 0) {
+        tmp[--w] = (char)('0' + n % 10);
+        n /= 10;
+    }
+    n = a->nd + 19 - w;
+    a->dp += (int)n - a->nd;
+    for (i = 0; i < (int)n; i++) {
+        if (i < YJSON_DECIMAL_DIGITS)
+            a->d[i] = tmp[w + i];
+        else if (tmp[w + i] != '0')
+            a->trunc = 1;
+    }
+    a->nd = (int)n < YJSON_DECIMAL_DIGITS ? (int)n : YJSON_DECIMAL_DIGITS;
+    yjson_decimal_trim(a);
+}
+
+static void yjson_decimal_shift(yjson_decimal* a, int k) {
+    if (a->nd == 0)
+        return;
+    if (k > 0) {
+        for (; k > YJSON_DECIMAL_MAX_SHIFT; k -= YJSON_DECIMAL_MAX_SHIFT)
+            yjson_decimal_left_shift(a, YJSON_DECIMAL_MAX_SHIFT);
+        yjson_decimal_left_shift(a, k);
+    }
+    else if (k < 0) {
+        for (; k < -YJSON_DECIMAL_MAX_SHIFT; k += YJSON_DECIMAL_MAX_SHIFT)
+            yjson_decimal_right_shift(a, YJSON_DECIMAL_MAX_SHIFT);
+        yjson_decimal_right_shift(a, -k);
+    }
+}
+
+static uint64_t yjson_decimal_rounded_integer(const yjson_decimal* a) {
+    uint64_t n = 0;
+    int i, up;
+    for (i = 0; i < a->dp && i < a->nd; i++)
+        n = n * 10 + (a->d[i] - '0');
+    for (; i < a->dp; i++)
+        n *= 10;
+    if (a->dp < 0 || a->dp >= a->nd)
+        up = 0;
+    else if (a->d[a->dp] == '5' && a->dp + 1 == a->nd) /* exactly halfway: round to even */
+        up = a->trunc || (a->dp > 0 && (a->d[a->dp - 1] - '0') % 2 == 1);
+    else
+        up = a->d[a->dp] >= '5';
+    return n + up;
+}
+
+static double yjson_decimal_to_double_slow(const char* p, const char* end, int neg) {
+    static const int powtab[] = { 1, 3, 6, 9, 13, 16, 19, 23, 26 };
+    yjson_decimal a;
+    uint64_t mant;
+    int exp = 0, n;
+    yjson_decimal_set(&a, p, end);
+    yjson_decimal_trim(&a);
+    if (a.nd == 0 || a.dp < -330)
+        return neg ? -0.0 : 0.0;
+    if (a.dp > 310)
+        return neg ? -HUGE_VAL : HUGE_VAL;
+    /* scale by powers of two into [0.5, 1) */
+    while (a.dp > 0) {
+        n = a.dp >= 9 ? 27 : powtab[a.dp];
+        yjson_decimal_shift(&a, -n);
+        exp += n;
+    }
+    while (a.dp < 0 || (a.dp == 0 && a.d[0] < '5')) {
+        n = -a.dp >= 9 ? 27 : powtab[-a.dp];
+        yjson_decimal_shift(&a, n);
+        exp -= n;
+    }
+    /* [0.5, 1) to [1, 2); the smallest normal exponent is -1022 */
+    exp--;
+    if (exp < -1022) {
+        yjson_decimal_shift(&a, -(-1022 - exp));
+        exp = -1022;
+    }
+    if (exp + 1023 >= 0x7FF)
+        return neg ? -HUGE_VAL : HUGE_VAL;
+    yjson_decimal_shift(&a, 53);
+    mant = yjson_decimal_rounded_integer(&a);
+    if (mant == UINT64_C(1) << 53) {
+        mant >>= 1;
+        if (++exp + 1023 >= 0x7FF)
+            return neg ? -HUGE_VAL : HUGE_VAL;
+    }
+    /* subnormal */
+    if (!(mant & (UINT64_C(1) << 52)))
+        exp = -1023;
+    return yjson_bits_to_double((uint64_t)(exp + 1023) << 52 | (mant & ((UINT64_C(1) << 52) - 1)) | (uint64_t)neg << 63);
+}
+
+/* m * 10^e10, where m holds the first 19 significant digits of p..end */
+static double yjson_decimal_to_double(uint64_t m, int e10, int neg, int trunc, const char* p, const char* end) {
+    double d, up;
+    if (!trunc && yjson_fast_path(m, e10, neg, &d))
+        return d;
+    if (yjson_eisel_lemire(m, e10, neg, &d)) {
+        /* a truncated mantissa is fine when its upper bound rounds the same way */
+        if (!trunc || (yjson_eisel_lemire(m + 1, e10, neg, &up) && up == d))
+            return d;
+    }
+    return yjson_decimal_to_double_slow(p, end, neg);
+}
+
+/* m * 10 + d still fits in 64 bits */
+#define YJSON_MANTISSA_FITS(m, d) ((m) < UINT64_MAX / 10 || ((m) == UINT64_MAX / 10 && (d) <= (int)(UINT64_MAX % 10)))
+
 static int yjson_parse_number(yjson_context*c ,yjson_value*v){
     const char* p= c->json;
-    if(*p =='-') p++;
-    if(*p == '0') p++;
+    uint64_t m = 0;
+    int neg = 0, e10 = 0, trunc = 0, exp = 0, eneg = 0, integral = 1;
+    if(YJSON_PEEK(c, p) =='-') {
+        neg = 1;
+        p++;
+    }
+    if(YJSON_PEEK(c, p) == '0') p++;
     else{
-        if(!ISDIGIT1T09(*p)) return YJSON_PARSE_INVALID_VALUE;
-        for(p++; ISDIGIT(*p) ;p++);
+        if(!ISDIGIT1T09(YJSON_PEEK(c, p))) return YJSON_PARSE_INVALID_VALUE;
+        for(; ISDIGIT(YJSON_PEEK(c, p)) ;p++){
+            if(YJSON_MANTISSA_FITS(m, *p - '0'))
+                m = m * 10 + (*p - '0');
+            else{
+                e10++;
+                trunc |= *p != '0';
+                integral = 0;
+            }
+        }
     }
-    if(*p =='.'){
+    if(YJSON_PEEK(c, p) =='.'){
         p++;
-        if(!ISDIGIT(*p)) return YJSON_PARSE_INVALID_VALUE;
-        for(p++; ISDIGIT(*p) ;p++);
+        if(!ISDIGIT(YJSON_PEEK(c, p))) return YJSON_PARSE_INVALID_VALUE;
+        for(; ISDIGIT(YJSON_PEEK(c, p)) ;p++){
+            if(YJSON_MANTISSA_FITS(m, *p - '0')){
+                m = m * 10 + (*p - '0');
+                e10--;
+            }
+            else
+                trunc |= *p != '0';
+        }
+        integral = 0;
     }
-    if(*p == 'e' || *p == 'E'){
+    if(YJSON_PEEK(c, p) == 'e' || YJSON_PEEK(c, p) == 'E'){
         p++;
-        if(*p == '+' || *p =='-') p++;
-        if(!ISDIGIT(*p)) return YJSON_PARSE_INVALID_VALUE;
-        for(p++; ISDIGIT(*p) ;p++);
+        if(YJSON_PEEK(c, p) == '+' || YJSON_PEEK(c, p) =='-') eneg = *p++ == '-';
+        if(!ISDIGIT(YJSON_PEEK(c, p))) return YJSON_PARSE_INVALID_VALUE;
+        for(; ISDIGIT(YJSON_PEEK(c, p)) ;p++)
+            if(exp < 100000)
+                exp = exp * 10 + (*p - '0');
+        e10 += eneg ? -exp : exp;
+        integral = 0;
     }
 
-
-    errno = 0;
-    v->u.n = strtod(c->json,NULL);
-    if(errno ==  ERANGE && (v->u.n == HUGE_VAL || v->u.n == -HUGE_VAL))
-        return YJSON_PARSE_NUMBER_TOO_BIG;
-    c->json= p;
     v->type = YJSON_NUMBER;
+    v->flags = 0;
+    /* integer literals are kept exact; -0 stays a double to keep its sign */
+    if(integral && !neg){
+        if(m <= (uint64_t)INT64_MAX){
+            v->u.i64 = (int64_t)m;
+            v->flags = YJSON_FLAG_INT64;
+        }
+        else{
+            v->u.u64 = m;
+            v->flags = YJSON_FLAG_UINT64;
+        }
+    }
+    else if(integral && m != 0 && m - 1 <= (uint64_t)INT64_MAX){
+        v->u.i64 = -(int64_t)(m - 1) - 1;
+        v->flags = YJSON_FLAG_INT64;
+    }
+    else{
+        v->u.n = yjson_decimal_to_double(m, e10, neg, trunc, c->json, p);
+        if(v->u.n == HUGE_VAL || v->u.n == -HUGE_VAL){
+            v->type = YJSON_NULL;
+            return YJSON_PARSE_NUMBER_TOO_BIG;
+        }
+    }
+    c->json= p;
     return YJSON_PARSE_OK;
-        
 }
+
 static void* yjson_context_push(yjson_context* c,size_t size){
     void* ret;
     assert(size>0);
@@ -82,10 +1613,15 @@ static void* yjson_context_push(yjson_context* c,size_t size){
         }
         while(c->top + size >= c->size)
             c->size += c->size >>1;
-        c->stack = (char*) realloc(c->stack,c->size);
+        c->stack = (char*) YJSON_REALLOC(c->stack,c->size);
+        YJSON_STAT(stack_grows, 1);
     }
     ret = c->stack + c->top;
     c->top +=size;
+#ifdef YJSON_STATS
+    if (yjson_stats_active && c->top > yjson_stats_call.stack_peak)
+        yjson_stats_call.stack_peak = c->top;
+#endif
     return ret;
 }
 static void* yjson_context_pop(yjson_context*c , size_t size){
@@ -93,126 +1629,2606 @@ static void* yjson_context_pop(yjson_context*c , size_t size){
     return c->stack+ (c->top -=size);
 }
 
-static int yjson_parse_string(yjson_context* c, yjson_value* v) {
-    size_t head = c->top, len;
-    const char* p;
+/*
+ * Decodes the string at c->json. The result is left on the stack, or, when
+ * the string holds no escapes, points straight into the input; either way it
+ * is not NUL-terminated. In situ the string is unescaped over the input
+ * itself and terminated there.
+ */
+static const char* yjson_parse_hex4(const yjson_context* c, const char* p, unsigned* u) {
+    int i;
+    *u = 0;
+    for (i = 0; i < 4; i++) {
+        char ch = YJSON_PEEK(c, p);
+        p++;
+        *u <<= 4;
+        if (ch >= '0' && ch <= '9')      *u |= ch - '0';
+        else if (ch >= 'A' && ch <= 'F') *u |= ch - ('A' - 10);
+        else if (ch >= 'a' && ch <= 'f') *u |= ch - ('a' - 10);
+        else return NULL;
+    }
+    return p;
+}
+
+/* writes u as UTF-8 to buf and returns the number of bytes */
+static size_t yjson_encode_utf8(char* buf, unsigned u) {
+    if (u <= 0x7F) {
+        buf[0] = (char)u;
+        return 1;
+    }
+    if (u <= 0x7FF) {
+        buf[0] = (char)(0xC0 | (u >> 6));
+        buf[1] = (char)(0x80 | (u & 0x3F));
+        return 2;
+    }
+    if (u <= 0xFFFF) {
+        buf[0] = (char)(0xE0 | (u >> 12));
+        buf[1] = (char)(0x80 | ((u >> 6) & 0x3F));
+        buf[2] = (char)(0x80 | (u & 0x3F));
+        return 3;
+    }
+    assert(u <= 0x10FFFF);
+    buf[0] = (char)(0xF0 | (u >> 18));
+    buf[1] = (char)(0x80 | ((u >> 12) & 0x3F));
+    buf[2] = (char)(0x80 | ((u >> 6) & 0x3F));
+    buf[3] = (char)(0x80 | (u & 0x3F));
+    return 4;
+}
+
+/*
+ * Strict UTF-8 check of one run of string bytes, done right after the run
+ * was scanned and is still in cache. A run always ends at an ASCII byte, so
+ * a sequence cut short by its end is invalid. ASCII goes 16 bytes at a step;
+ * the rest follows the well-formed byte sequences of Unicode table 3-7:
+ * no overlong forms, no surrogates, nothing above U+10FFFF.
+ */
+static int yjson_validate_utf8(const unsigned char* p, const unsigned char* end) {
+    while (p < end) {
+#ifdef YJSON_SIMD_X86
+        while (end - p >= 16 && _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)p)) == 0)
+            p += 16;
+#endif
+        if (*p < 0x80) {
+            p++;
+            continue;
+        }
+        if (*p >= 0xC2 && *p <= 0xDF) {
+            if (end - p < 2 || (p[1] & 0xC0) != 0x80)
+                return 0;
+            p += 2;
+        }
+        else if (*p >= 0xE0 && *p <= 0xEF) {
+            if (end - p < 3 || (p[2] & 0xC0) != 0x80)
+                return 0;
+            if (*p == 0xE0 ? p[1] < 0xA0 || p[1] > 0xBF :
+                *p == 0xED ? p[1] < 0x80 || p[1] > 0x9F : (p[1] & 0xC0) != 0x80)
+                return 0;
+            p += 3;
+        }
+        else if (*p >= 0xF0 && *p <= 0xF4) {
+            if (end - p < 4 || (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80)
+                return 0;
+            if (*p == 0xF0 ? p[1] < 0x90 || p[1] > 0xBF :
+                *p == 0xF4 ? p[1] < 0x80 || p[1] > 0x8F : (p[1] & 0xC0) != 0x80)
+                return 0;
+            p += 4;
+        }
+        else
+            return 0;
+    }
+    return 1;
+}
+
+static int yjson_parse_string_raw(yjson_context* c, char** str, size_t* len) {
+    size_t head = c->top;
+    const char *p, *q;
+    char *dst = NULL, *start;
+    char ch, buf[4];
+    size_t n;
+    unsigned u, u2;
     EXPECT(c, '\"');
     p = c->json;
+    start = (char*)p;
+    if (c->insitu)
+        dst = start;
     for (;;) {
-        char ch = *p++;
-        switch (ch) {
+        q = c->limit ? yjson_scan_string_n(p, c->limit) : yjson_scan_string(p);
+        if (c->utf8 && !yjson_validate_utf8((const unsigned char*)p, (const unsigned char*)q)) {
+            c->top = head;
+            return YJSON_PARSE_INVALID_UTF8;
+        }
+        if (dst != NULL) {
+            if (dst != p)
+                memmove(dst, p, q - p);
+            dst += q - p;
+        }
+        else if (YJSON_PEEK(c, q) == '\"' && c->top == head) {
+            /* no escapes: hand out the input itself */
+            *str = start;
+            *len = q - p;
+            c->json = q + 1;
+            YJSON_STAT(strings, 1);
+            return YJSON_PARSE_OK;
+        }
+        else if (q != p)
+            memcpy(yjson_context_push(c, q - p), p, q - p);
+        p = q + 1;
+        switch (YJSON_PEEK(c, q)) {
+            case '\"':
+                if (dst != NULL) {
+                    *len = dst - start;
+                    *dst = '\0';
+                    *str = start;
+                }
+                else {
+                    *len = c->top - head;
+                    *str = (char*)yjson_context_pop(c, *len);
+                }
+                c->json = p;
+                YJSON_STAT(strings, 1);
+                return YJSON_PARSE_OK;
             case '\\':
-                switch (*p++) {
-                    case '\"': PUTC(c, '\"'); break;
-                    case '\\': PUTC(c, '\\'); break;
-                    case '/':  PUTC(c, '/' ); break;
-                    case 'b':  PUTC(c, '\b'); break;
-                    case 'f':  PUTC(c, '\f'); break;
-                    case 'n':  PUTC(c, '\n'); break;
-                    case 'r':  PUTC(c, '\r'); break;
-                    case 't':  PUTC(c, '\t'); break;
+                YJSON_STAT(escapes, 1);
+                ch = YJSON_PEEK(c, p);
+                p++;
+                switch (ch) {
+                    case '\"': ch = '\"'; break;
+                    case '\\': ch = '\\'; break;
+                    case '/':  ch = '/' ; break;
+                    case 'b':  ch = '\b'; break;
+                    case 'f':  ch = '\f'; break;
+                    case 'n':  ch = '\n'; break;
+                    case 'r':  ch = '\r'; break;
+                    case 't':  ch = '\t'; break;
+                    case 'u':
+                        if ((p = yjson_parse_hex4(c, p, &u)) == NULL) {
+                            c->top = head;
+                            return YJSON_PARSE_INVALID_UNICODE_HEX;
+                        }
+                        if (u >= 0xD800 && u <= 0xDBFF) {
+                            /* a high surrogate must be followed by a low one */
+                            if (YJSON_PEEK(c, p) != '\\' || YJSON_PEEK(c, p + 1) != 'u') {
+                                c->top = head;
+                                return YJSON_PARSE_INVALID_UNICODE_SURROGATE;
+                            }
+                            if ((p = yjson_parse_hex4(c, p + 2, &u2)) == NULL) {
+                                c->top = head;
+                                return YJSON_PARSE_INVALID_UNICODE_HEX;
+                            }
+                            if (u2 < 0xDC00 || u2 > 0xDFFF) {
+                                c->top = head;
+                                return YJSON_PARSE_INVALID_UNICODE_SURROGATE;
+                            }
+                            u = 0x10000 + ((u - 0xD800) << 10) + (u2 - 0xDC00);
+                        }
+                        else if (u >= 0xDC00 && u <= 0xDFFF) {
+                            c->top = head;
+                            return YJSON_PARSE_INVALID_UNICODE_SURROGATE;
+                        }
+                        n = yjson_encode_utf8(buf, u);
+                        if (dst != NULL) {
+                            memcpy(dst, buf, n);
+                            dst += n;
+                        }
+                        else
+                            memcpy(yjson_context_push(c, n), buf, n);
+                        continue;
                     default:
                         c->top = head;
                         return YJSON_PARSE_INVALID_STRING_ESCAPE;
                 }
+                if (dst != NULL)
+                    *dst++ = ch;
+                else
+                    PUTC(c, ch);
                 break;
-
-            case '\"':
-                len = c->top - head;
-                yjson_set_string(v, (const char*)yjson_context_pop(c, len), len);
-                c->json = p;
-                return YJSON_PARSE_OK;
             case '\0':
-                c->top = head;
-                return YJSON_PARSE_MISS_QUOTATION_MARK;
-            default:
-                if((unsigned char) ch < 0x20){
+                if (YJSON_AT_END(c, p - 1)) {
                     c->top = head;
-                    return YJSON_PARSE_INVALID_STRING_CHAR;
+                    return YJSON_PARSE_MISS_QUOTATION_MARK;
                 }
-
-                PUTC(c, ch);
+                /* fall through */
+            default:
+                c->top = head;
+                return YJSON_PARSE_INVALID_STRING_CHAR;
         }
     }
 }
 
-
-void yjson_set_string(yjson_value* v, const char* s, size_t len){
-    assert(v!=NULL && (s!=NULL ||len ==0));
-    yjson_free(v);
-    v->u.s.s = (char*)malloc(len+1);
-    memcpy(v->u.s.s,s,len);
-    v->u.s.s[len]='\0';
-    v->u.s.len = len;
+/* short strings live in the value itself, NUL included */
+static void yjson_set_inline(yjson_value* v, const char* s, size_t len) {
+    if (len > 0)
+        memcpy(v->u.ss.s, s, len);
+    v->u.ss.s[len] = '\0';
+    v->u.ss.len = (unsigned char)len;
     v->type = YJSON_STRING;
-    
+    v->flags = YJSON_FLAG_INLINE;
 }
 
-void yjson_free(yjson_value* v){
-    assert(v!= NULL);
-    if(v->type == YJSON_STRING)
-        free(v->u.s.s);
-    v->type = YJSON_NULL;
-}
-int yjson_get_boolean(const yjson_value* v) {
-    assert(v != NULL && (v->type == YJSON_TRUE || v->type == YJSON_FALSE));
-    return v->type == YJSON_TRUE;
+static int yjson_parse_string(yjson_context* c, yjson_value* v) {
+    int ret;
+    char* s;
+    size_t len;
+    if ((ret = yjson_parse_string_raw(c, &s, &len)) == YJSON_PARSE_OK) {
+        v->u.s.len = len;
+        v->type = YJSON_STRING;
+        v->flags = YJSON_STRING_FLAGS(c);
+        if (c->intern && len <= c->intern->max_value)
+            v->u.s.s = (char*)yjson_intern_string(c->intern, s, len);
+        else if (c->insitu)
+            v->u.s.s = s;
+        else if (len <= YJSON_INLINE_MAX)
+            yjson_set_inline(v, s, len);
+        else {
+            v->u.s.s = yjson_context_strdup(c, s, len);
+            /* a long string is still owned unless an arena holds it */
+            if (!c->arena)
+                v->flags = 0;
+        }
+    }
+    return ret;
 }
 
-void yjson_set_boolean(yjson_value* v, int b) {
-    yjson_free(v);
-    if(b){
-         v->type = YJSON_TRUE;
+static int yjson_parse_value(yjson_context* c, yjson_value* v);
+
+/* moves the top size elements of the stack into one block owned by v */
+static void yjson_context_pop_array(yjson_context* c, yjson_value* v, size_t size) {
+    v->type = YJSON_ARRAY;
+    v->flags = c->arena ? YJSON_FLAG_EXTERNAL : 0;
+    v->u.a.size = size;
+    v->u.a.e = NULL;
+    if (size > 0) {
+        size *= sizeof(yjson_value);
+        memcpy(v->u.a.e = (yjson_value*)yjson_context_alloc(c, size), yjson_context_pop(c, size), size);
     }
-    else{
-        v->type = YJSON_FALSE;
+}
+
+/*
+ * Objects of YJSON_OBJECT_INDEX_MIN members or more get an open-addressing
+ * index right behind their member block, in the same allocation: a power of
+ * two slots, at most half full, each holding a member number plus one.
+ * Linear probing keeps duplicate keys in document order, so a lookup finds
+ * the first one just like a scan would.
+ */
+#ifndef YJSON_OBJECT_INDEX_MIN
+#define YJSON_OBJECT_INDEX_MIN 16
+#endif
+
+static size_t yjson_index_capacity(size_t size) {
+    size_t cap = YJSON_OBJECT_INDEX_MIN;
+    while (cap < size * 2)
+        cap <<= 1;
+    return cap;
+}
+
+static void yjson_index_build(yjson_value* v) {
+    uint32_t* index = (uint32_t*)(v->u.o.m + v->u.o.size);
+    size_t i, j, mask = yjson_index_capacity(v->u.o.size) - 1;
+#ifdef YJSON_STATS
+    double t = yjson_stats_active ? yjson_stats_now() : 0.0;
+#endif
+    memset(index, 0, (mask + 1) * sizeof(uint32_t));
+    for (i = 0; i < v->u.o.size; i++) {
+        for (j = yjson_hash(v->u.o.m[i].k, v->u.o.m[i].klen) & mask; index[j] != 0; j = (j + 1) & mask)
+            ;
+        index[j] = (uint32_t)(i + 1);
     }
-    
+    v->flags |= YJSON_FLAG_INDEXED;
+    YJSON_STAT(index_seconds, yjson_stats_now() - t);
 }
 
-const char* yjson_get_string(const yjson_value* v) {
-    assert(v != NULL && v->type == YJSON_STRING);
-    return v->u.s.s;
+static void yjson_context_pop_object(yjson_context* c, yjson_value* v, size_t size) {
+    v->type = YJSON_OBJECT;
+    v->flags = (c->arena ? YJSON_FLAG_EXTERNAL : 0) | (YJSON_STRING_FLAGS(c) ? YJSON_FLAG_EXTERNAL_KEYS : 0);
+    v->u.o.size = size;
+    v->u.o.m = NULL;
+    if (size > 0) {
+        int indexed = size >= YJSON_OBJECT_INDEX_MIN && size < UINT32_MAX;
+        size_t bytes = size * sizeof(yjson_member);
+        size_t extra = indexed ? yjson_index_capacity(size) * sizeof(uint32_t) : 0;
+        memcpy(v->u.o.m = (yjson_member*)yjson_context_alloc(c, bytes + extra), yjson_context_pop(c, bytes), bytes);
+        if (indexed)
+            yjson_index_build(v);
+    }
 }
-size_t yjson_get_string_length(const yjson_value* v){
-    assert(v != NULL && v->type == YJSON_STRING);
-    return v->u.s.len;
+
+/* error paths: releases the top size elements of the stack */
+static void yjson_context_drop_array(yjson_context* c, size_t size) {
+    size_t i;
+    for (i = 0; i < size; i++)
+        yjson_free((yjson_value*)yjson_context_pop(c, sizeof(yjson_value)));
 }
 
-static int yjson_parse_value(yjson_context *c , yjson_value *v ){
-    switch(*c->json){
-        case 'n': return yjson_parse_literal(c,v,"null",YJSON_NULL);
-        case 't': return yjson_parse_literal(c,v,"true",YJSON_TRUE);
-        case 'f': return yjson_parse_literal(c,v,"false",YJSON_FALSE);
-        case '"': return yjson_parse_string(c,v);
-        case '\0': return YJSON_PARSE_EXPECT_VALUE;
-        default: return yjson_parse_number(c,v);
+static void yjson_context_drop_object(yjson_context* c, size_t size) {
+    size_t i;
+    for (i = 0; i < size; i++) {
+        yjson_member* mp = (yjson_member*)yjson_context_pop(c, sizeof(yjson_member));
+        if (!YJSON_STRING_FLAGS(c))
+            YJSON_FREE(mp->k);
+        yjson_free(&mp->v);
     }
 }
 
-int yjson_parse(yjson_value* v, const char* json) {
-    yjson_context c;
+static int yjson_parse_array(yjson_context* c, yjson_value* v) {
+    size_t size = 0;
     int ret;
-    assert(v != NULL);
-    c.json = json;
-    c.stack = NULL;
-    c.size = c.top = 0;
-    v->type = YJSON_NULL;
-    yjson_parse_whitespace(&c);
-    if((ret = yjson_parse_value(&c,v))==YJSON_PARSE_OK){
-        yjson_parse_whitespace(&c);
-        if(*c.json !='\0'){
-            v->type = YJSON_NULL;
+    EXPECT(c, '[');
+    yjson_parse_whitespace(c);
+    if (YJSON_PEEK(c, c->json) == ']') {
+        c->json++;
+        yjson_context_pop_array(c, v, 0);
+        return YJSON_PARSE_OK;
+    }
+    for (;;) {
+        yjson_value e;
+        yjson_init(&e);
+        if ((ret = yjson_parse_value(c, &e)) != YJSON_PARSE_OK)
+            break;
+        memcpy(yjson_context_push(c, sizeof(yjson_value)), &e, sizeof(yjson_value));
+        size++;
+        yjson_parse_whitespace(c);
+        if (YJSON_PEEK(c, c->json) == ',') {
+            c->json++;
+            yjson_parse_whitespace(c);
+        }
+        else if (YJSON_PEEK(c, c->json) == ']') {
+            c->json++;
+            yjson_context_pop_array(c, v, size);
+            return YJSON_PARSE_OK;
+        }
+        else {
+            ret = YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+            break;
+        }
+    }
+    yjson_context_drop_array(c, size);
+    return ret;
+}
+
+static int yjson_parse_object(yjson_context* c, yjson_value* v) {
+    size_t size = 0;
+    yjson_member m;
+    int ret;
+    EXPECT(c, '{');
+    yjson_parse_whitespace(c);
+    if (YJSON_PEEK(c, c->json) == '}') {
+        c->json++;
+        yjson_context_pop_object(c, v, 0);
+        return YJSON_PARSE_OK;
+    }
+    m.k = NULL;
+    for (;;) {
+        char* str;
+        yjson_init(&m.v);
+        if (YJSON_PEEK(c, c->json) != '"') {
+            ret = YJSON_PARSE_MISS_KEY;
+            break;
+        }
+        if ((ret = yjson_parse_string_raw(c, &str, &m.klen)) != YJSON_PARSE_OK)
+            break;
+        if (c->intern)
+            m.k = (char*)yjson_intern_string(c->intern, str, m.klen);
+        else
+            m.k = c->insitu ? str : yjson_context_strdup(c, str, m.klen);
+        yjson_parse_whitespace(c);
+        if (YJSON_PEEK(c, c->json) != ':') {
+            ret = YJSON_PARSE_MISS_COLON;
+            break;
+        }
+        c->json++;
+        yjson_parse_whitespace(c);
+        if ((ret = yjson_parse_value(c, &m.v)) != YJSON_PARSE_OK)
+            break;
+        memcpy(yjson_context_push(c, sizeof(yjson_member)), &m, sizeof(yjson_member));
+        size++;
+        m.k = NULL;
+        yjson_parse_whitespace(c);
+        if (YJSON_PEEK(c, c->json) == ',') {
+            c->json++;
+            yjson_parse_whitespace(c);
+        }
+        else if (YJSON_PEEK(c, c->json) == '}') {
+            c->json++;
+            yjson_context_pop_object(c, v, size);
+            return YJSON_PARSE_OK;
+        }
+        else {
+            ret = YJSON_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+            break;
+        }
+    }
+    if (!YJSON_STRING_FLAGS(c))
+        YJSON_FREE(m.k);
+    yjson_context_drop_object(c, size);
+    return ret;
+}
+
+
+void yjson_set_string(yjson_value* v, const char* s, size_t len){
+    assert(v!=NULL && (s!=NULL ||len ==0));
+    yjson_free(v);
+    if (len <= YJSON_INLINE_MAX) {
+        yjson_set_inline(v, s, len);
+        return;
+    }
+    v->u.s.s = (char*)YJSON_MALLOC(len+1);
+    memcpy(v->u.s.s,s,len);
+    v->u.s.s[len]='\0';
+    v->u.s.len = len;
+    v->type = YJSON_STRING;
+    v->flags = 0;
+}
+
+void yjson_free(yjson_value* v){
+    size_t i;
+    assert(v!= NULL);
+    switch(v->type){
+        case YJSON_STRING:
+            if(!(v->flags & (YJSON_FLAG_EXTERNAL | YJSON_FLAG_INLINE)))
+                YJSON_FREE(v->u.s.s);
+            break;
+        case YJSON_ARRAY:
+            for(i = 0; i < v->u.a.size; i++)
+                yjson_free(&v->u.a.e[i]);
+            if(!(v->flags & YJSON_FLAG_EXTERNAL))
+                YJSON_FREE(v->u.a.e);
+            break;
+        case YJSON_OBJECT:
+            for(i = 0; i < v->u.o.size; i++){
+                if(!(v->flags & YJSON_FLAG_EXTERNAL_KEYS))
+                    YJSON_FREE(v->u.o.m[i].k);
+                yjson_free(&v->u.o.m[i].v);
+            }
+            if(!(v->flags & YJSON_FLAG_EXTERNAL))
+                YJSON_FREE(v->u.o.m);
+            break;
+        default: break;
+    }
+    v->type = YJSON_NULL;
+    v->flags = 0;
+}
+int yjson_get_boolean(const yjson_value* v) {
+    assert(v != NULL && (v->type == YJSON_TRUE || v->type == YJSON_FALSE));
+    return v->type == YJSON_TRUE;
+}
+
+void yjson_set_boolean(yjson_value* v, int b) {
+    yjson_free(v);
+    if(b){
+         v->type = YJSON_TRUE;
+    }
+    else{
+        v->type = YJSON_FALSE;
+    }
+    
+}
+
+const char* yjson_get_string(const yjson_value* v) {
+    assert(v != NULL && v->type == YJSON_STRING);
+    return v->flags & YJSON_FLAG_INLINE ? v->u.ss.s : v->u.s.s;
+}
+size_t yjson_get_string_length(const yjson_value* v){
+    assert(v != NULL && v->type == YJSON_STRING);
+    return v->flags & YJSON_FLAG_INLINE ? v->u.ss.len : v->u.s.len;
+}
+
+static int yjson_parse_value(yjson_context *c , yjson_value *v ){
+    int ret;
+    switch(YJSON_PEEK(c, c->json)){
+        case 'n': ret = yjson_parse_literal(c,v,"null",YJSON_NULL); break;
+        case 't': ret = yjson_parse_literal(c,v,"true",YJSON_TRUE); break;
+        case 'f': ret = yjson_parse_literal(c,v,"false",YJSON_FALSE); break;
+        case '"': ret = yjson_parse_string(c,v); break;
+        case '[':
+        case '{':
+            if (c->depth == YJSON_PARSE_MAX_DEPTH)
+                return YJSON_PARSE_TOO_DEEP;
+            c->depth++;
+            ret = *c->json == '[' ? yjson_parse_array(c,v) : yjson_parse_object(c,v);
+            c->depth--;
+            break;
+        case '\0':
+            if (YJSON_AT_END(c, c->json))
+                return YJSON_PARSE_EXPECT_VALUE;
+            return YJSON_PARSE_INVALID_VALUE;
+        default: ret = yjson_parse_number(c,v); break;
+    }
+    if (ret == YJSON_PARSE_OK)
+        YJSON_STAT(values[v->type], 1);
+    return ret;
+}
+
+#ifdef YJSON_STATS
+static void yjson_stats_add(yjson_stats* sum, const yjson_stats* s) {
+    size_t i;
+    sum->calls += s->calls;
+    sum->bytes += s->bytes;
+    for (i = 0; i < sizeof(s->values) / sizeof(s->values[0]); i++)
+        sum->values[i] += s->values[i];
+    sum->strings += s->strings;
+    sum->escapes += s->escapes;
+    if (s->stack_peak > sum->stack_peak)
+        sum->stack_peak = s->stack_peak;
+    sum->stack_grows += s->stack_grows;
+    sum->allocs += s->allocs;
+    sum->alloc_bytes += s->alloc_bytes;
+    sum->parse_seconds += s->parse_seconds;
+    sum->index_seconds += s->index_seconds;
+}
+
+/* a call's counters join the thread totals only when the next call begins */
+static void yjson_stats_begin(void) {
+    yjson_stats_add(&yjson_stats_thread, &yjson_stats_call);
+    memset(&yjson_stats_call, 0, sizeof(yjson_stats));
+    yjson_stats_call.calls = 1;
+    yjson_stats_active = 1;
+}
+
+void yjson_get_stats(yjson_stats* s) {
+    assert(s != NULL);
+    *s = yjson_stats_call;
+}
+
+void yjson_get_thread_stats(yjson_stats* s) {
+    assert(s != NULL);
+    *s = yjson_stats_thread;
+    yjson_stats_add(s, &yjson_stats_call);
+}
+
+void yjson_reset_thread_stats(void) {
+    memset(&yjson_stats_thread, 0, sizeof(yjson_stats));
+    memset(&yjson_stats_call, 0, sizeof(yjson_stats));
+}
+#endif
+
+static int yjson_parse_root(yjson_context* c, yjson_value* v) {
+    int ret;
+#ifdef YJSON_STATS
+    const char* json = c->json;
+    double t = yjson_stats_now();
+    yjson_stats_begin();
+#endif
+    yjson_init(v);
+    yjson_parse_whitespace(c);
+    if((ret = yjson_parse_value(c,v))==YJSON_PARSE_OK){
+        yjson_parse_whitespace(c);
+        if(YJSON_PEEK(c, c->json) !='\0' || !YJSON_AT_END(c, c->json)){
+            yjson_free(v);
+            ret = YJSON_PARSE_ROOT_NOT_SINGULAR;
+        }
+    }
+    assert(c->top ==0);
+#ifdef YJSON_STATS
+    yjson_stats_call.bytes = c->json - json;
+    yjson_stats_call.parse_seconds = yjson_stats_now() - t;
+    yjson_stats_active = 0;
+#endif
+    return ret;
+}
+
+int yjson_parse(yjson_value* v, const char* json) {
+    yjson_context c;
+    int ret;
+    assert(v != NULL);
+    yjson_context_init(&c, json);
+    ret = yjson_parse_root(&c, v);
+    YJSON_FREE(c.stack);
+    return ret;
+}
+
+/* parses on the stack a keeps from one call to the next */
+static int yjson_parse_cached(yjson_context* c, yjson_value* v, yjson_arena* a) {
+    int ret;
+    c->stack = a->stack;
+    c->size = a->stack_size;
+    ret = yjson_parse_root(c, v);
+    a->stack = c->stack;
+    a->stack_size = c->size;
+    return ret;
+}
+
+int yjson_parse_arena(yjson_value* v, const char* json, yjson_arena* a) {
+    yjson_context c;
+    assert(v != NULL && a != NULL);
+    yjson_context_init(&c, json);
+    c.arena = a;
+    return yjson_parse_cached(&c, v, a);
+}
+
+int yjson_parse_n(yjson_value* v, const char* json, size_t len) {
+    return yjson_parse_ex(v, json, len, 0);
+}
+
+int yjson_parse_ex(yjson_value* v, const char* json, size_t len, unsigned flags) {
+    yjson_context c;
+    int ret;
+    assert(v != NULL && (json != NULL || len == 0));
+    if (json == NULL)
+        json = "";
+    assert(!(flags & YJSON_PARSE_PADDED) || json[len] == '\0');
+    yjson_context_init(&c, json);
+    c.end = json + len;
+    /* a padded input ends in a '\0' the scanners stop at by themselves */
+    if (!(flags & YJSON_PARSE_PADDED))
+        c.limit = c.end;
+    c.utf8 = (flags & YJSON_PARSE_VALIDATE_UTF8) != 0;
+    ret = yjson_parse_root(&c, v);
+    YJSON_FREE(c.stack);
+    return ret;
+}
+
+int yjson_parse_intern(yjson_value* v, const char* json, yjson_intern* t) {
+    yjson_context c;
+    int ret;
+    assert(v != NULL && t != NULL);
+    yjson_context_init(&c, json);
+    c.intern = t;
+    ret = yjson_parse_root(&c, v);
+    YJSON_FREE(c.stack);
+    return ret;
+}
+
+int yjson_parse_insitu(yjson_value* v, char* json) {
+    yjson_context c;
+    int ret;
+    assert(v != NULL);
+    yjson_context_init(&c, json);
+    c.insitu = 1;
+    ret = yjson_parse_root(&c, v);
+    YJSON_FREE(c.stack);
+    return ret;
+}
+
+#ifndef YJSON_PARSER_MAX_STACK
+#define YJSON_PARSER_MAX_STACK 65536
+#endif
+
+struct yjson_parser {
+    yjson_arena own;    /* only its parse stack is used while no arena is set */
+    yjson_arena* arena; /* borrowed; values are allocated from it */
+    size_t max_size;
+};
+
+yjson_parser* yjson_parser_create(void) {
+    yjson_parser* p = (yjson_parser*)YJSON_MALLOC(sizeof(yjson_parser));
+    yjson_arena_init(&p->own, NULL, 0);
+    p->arena = NULL;
+    p->max_size = YJSON_PARSER_MAX_STACK;
+    return p;
+}
+
+void yjson_parser_destroy(yjson_parser* p) {
+    if (p != NULL) {
+        yjson_arena_free(&p->own);
+        YJSON_FREE(p);
+    }
+}
+
+void yjson_parser_set_arena(yjson_parser* p, yjson_arena* a) {
+    assert(p != NULL);
+    p->arena = a;
+}
+
+void yjson_parser_set_max_stack(yjson_parser* p, size_t size) {
+    assert(p != NULL);
+    p->max_size = size;
+}
+
+int yjson_parse_with(yjson_parser* p, yjson_value* v, const char* json) {
+    yjson_context c;
+    yjson_arena* a;
+    int ret;
+    assert(p != NULL && v != NULL);
+    a = p->arena != NULL ? p->arena : &p->own;
+    yjson_context_init(&c, json);
+    c.arena = p->arena;
+    ret = yjson_parse_cached(&c, v, a);
+    if (a->stack_size > p->max_size) {
+        /* one unusually large document should not leave the stack that large */
+        if (p->max_size == 0) {
+            YJSON_FREE(a->stack);
+            a->stack = NULL;
+        }
+        else
+            a->stack = (char*)YJSON_REALLOC(a->stack, p->max_size);
+        a->stack_size = p->max_size;
+    }
+    return ret;
+}
+
+/*
+ * Event parser. The same tokenizer as yjson_parse_value() runs over the text,
+ * but nothing is kept: scalars are decoded into a yjson_value on the C stack
+ * and strings are handed out as views, so only a string with escapes touches
+ * the heap (to unescape it on the context stack).
+ */
+#define YJSON_SAX_CALL(ret, call) do { if ((ret = (call)) != 0) return YJSON_PARSE_CANCELED; } while(0)
+
+static int yjson_sax_value(yjson_context* c, const yjson_handler* h, void* user);
+
+static int yjson_sax_array(yjson_context* c, const yjson_handler* h, void* user) {
+    size_t size = 0;
+    int ret;
+    EXPECT(c, '[');
+    if (h->start_array)
+        YJSON_SAX_CALL(ret, h->start_array(user));
+    yjson_parse_whitespace(c);
+    if (*c->json != ']') {
+        for (;;) {
+            if ((ret = yjson_sax_value(c, h, user)) != YJSON_PARSE_OK)
+                return ret;
+            size++;
+            yjson_parse_whitespace(c);
+            if (*c->json == ',') {
+                c->json++;
+                yjson_parse_whitespace(c);
+            }
+            else if (*c->json == ']')
+                break;
+            else
+                return YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+        }
+    }
+    c->json++;
+    if (h->end_array)
+        YJSON_SAX_CALL(ret, h->end_array(user, size));
+    return YJSON_PARSE_OK;
+}
+
+static int yjson_sax_object(yjson_context* c, const yjson_handler* h, void* user) {
+    size_t size = 0, klen;
+    char* k;
+    int ret;
+    EXPECT(c, '{');
+    if (h->start_object)
+        YJSON_SAX_CALL(ret, h->start_object(user));
+    yjson_parse_whitespace(c);
+    if (*c->json != '}') {
+        for (;;) {
+            if (*c->json != '"')
+                return YJSON_PARSE_MISS_KEY;
+            if ((ret = yjson_parse_string_raw(c, &k, &klen)) != YJSON_PARSE_OK)
+                return ret;
+            if (h->key)
+                YJSON_SAX_CALL(ret, h->key(user, k, klen));
+            yjson_parse_whitespace(c);
+            if (*c->json != ':')
+                return YJSON_PARSE_MISS_COLON;
+            c->json++;
+            yjson_parse_whitespace(c);
+            if ((ret = yjson_sax_value(c, h, user)) != YJSON_PARSE_OK)
+                return ret;
+            size++;
+            yjson_parse_whitespace(c);
+            if (*c->json == ',') {
+                c->json++;
+                yjson_parse_whitespace(c);
+            }
+            else if (*c->json == '}')
+                break;
+            else
+                return YJSON_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+        }
+    }
+    c->json++;
+    if (h->end_object)
+        YJSON_SAX_CALL(ret, h->end_object(user, size));
+    return YJSON_PARSE_OK;
+}
+
+static int yjson_sax_value(yjson_context* c, const yjson_handler* h, void* user) {
+    yjson_value v;
+    char* s;
+    size_t len;
+    int ret;
+    yjson_init(&v);
+    switch (*c->json) {
+        case 'n':
+            if ((ret = yjson_parse_literal(c, &v, "null", YJSON_NULL)) == YJSON_PARSE_OK && h->null_value)
+                YJSON_SAX_CALL(ret, h->null_value(user));
+            return ret;
+        case 't':
+            if ((ret = yjson_parse_literal(c, &v, "true", YJSON_TRUE)) == YJSON_PARSE_OK && h->boolean)
+                YJSON_SAX_CALL(ret, h->boolean(user, 1));
+            return ret;
+        case 'f':
+            if ((ret = yjson_parse_literal(c, &v, "false", YJSON_FALSE)) == YJSON_PARSE_OK && h->boolean)
+                YJSON_SAX_CALL(ret, h->boolean(user, 0));
+            return ret;
+        case '"':
+            if ((ret = yjson_parse_string_raw(c, &s, &len)) == YJSON_PARSE_OK && h->string)
+                YJSON_SAX_CALL(ret, h->string(user, s, len));
+            return ret;
+        case '[':
+        case '{':
+            if (c->depth == YJSON_PARSE_MAX_DEPTH)
+                return YJSON_PARSE_TOO_DEEP;
+            c->depth++;
+            ret = *c->json == '[' ? yjson_sax_array(c, h, user) : yjson_sax_object(c, h, user);
+            c->depth--;
+            return ret;
+        case '\0':
+            if (YJSON_AT_END(c, c->json))
+                return YJSON_PARSE_EXPECT_VALUE;
+            return YJSON_PARSE_INVALID_VALUE;
+        default:
+            if ((ret = yjson_parse_number(c, &v)) == YJSON_PARSE_OK && h->number)
+                YJSON_SAX_CALL(ret, h->number(user, &v));
+            return ret;
+    }
+}
+
+int yjson_parse_sax(const char* json, const yjson_handler* h, void* user) {
+    yjson_context c;
+    int ret;
+    assert(json != NULL && h != NULL);
+    yjson_context_init(&c, json);
+    yjson_parse_whitespace(&c);
+    if ((ret = yjson_sax_value(&c, h, user)) == YJSON_PARSE_OK) {
+        yjson_parse_whitespace(&c);
+        if (*c.json != '\0' || !YJSON_AT_END(&c, c.json))
+            ret = YJSON_PARSE_ROOT_NOT_SINGULAR;
+    }
+    YJSON_FREE(c.stack);
+    return ret;
+}
+
+/*
+ * Incremental parser. The structural characters drive a small state machine
+ * whose open containers are kept as frames; children collect on the usual
+ * context stack exactly as in yjson_parse_array()/yjson_parse_object(). A
+ * scalar is handed to the ordinary tokenizer once it is known to be whole:
+ * in place when it ends inside the chunk, otherwise after it has been
+ * gathered, NUL-terminated, in s->token. Memory is thus bounded by the tree
+ * being built plus the longest single token.
+ */
+enum {
+    YJSON_STREAM_VALUE,       /* a value must follow */
+    YJSON_STREAM_ARRAY_FIRST, /* after '[' */
+    YJSON_STREAM_OBJECT_FIRST,/* after '{' */
+    YJSON_STREAM_OBJECT_KEY,  /* after ',' in an object */
+    YJSON_STREAM_COLON,       /* after a key */
+    YJSON_STREAM_AFTER_VALUE, /* after an element or member */
+    YJSON_STREAM_DONE         /* the root value is complete */
+};
+
+enum {
+    YJSON_TOKEN_NONE,
+    YJSON_TOKEN_STRING,
+    YJSON_TOKEN_KEY,
+    YJSON_TOKEN_NUMBER,
+    YJSON_TOKEN_LITERAL
+};
+
+typedef struct {
+    yjson_type type;
+    size_t size;    /* children pushed on the context stack so far */
+    char* key;      /* key waiting for its value */
+    size_t klen;
+} yjson_stream_frame;
+
+struct yjson_stream {
+    yjson_context c;
+    yjson_stream_frame* frames;
+    size_t depth, frames_size;
+    int state, error;
+    int token, escape;          /* token being gathered across chunks */
+    char* tok;
+    size_t toklen, toksize;
+    yjson_value root;
+};
+
+yjson_stream* yjson_stream_create(void) {
+    yjson_stream* s = (yjson_stream*)YJSON_MALLOC(sizeof(yjson_stream));
+    yjson_context_init(&s->c, NULL);
+    s->frames = NULL;
+    s->depth = s->frames_size = 0;
+    s->tok = NULL;
+    s->toklen = s->toksize = 0;
+    s->state = YJSON_STREAM_VALUE;
+    s->error = YJSON_PARSE_OK;
+    s->token = YJSON_TOKEN_NONE;
+    s->escape = 0;
+    yjson_init(&s->root);
+    return s;
+}
+
+/* drops any partial document; buffers are kept for the next one */
+void yjson_stream_reset(yjson_stream* s) {
+    assert(s != NULL);
+    while (s->depth > 0) {
+        yjson_stream_frame* f = &s->frames[--s->depth];
+        YJSON_FREE(f->key);
+        if (f->type == YJSON_ARRAY)
+            yjson_context_drop_array(&s->c, f->size);
+        else
+            yjson_context_drop_object(&s->c, f->size);
+    }
+    assert(s->c.top == 0);
+    yjson_free(&s->root);
+    s->state = YJSON_STREAM_VALUE;
+    s->error = YJSON_PARSE_OK;
+    s->token = YJSON_TOKEN_NONE;
+    s->escape = 0;
+    s->toklen = 0;
+}
+
+void yjson_stream_destroy(yjson_stream* s) {
+    if (s == NULL)
+        return;
+    yjson_stream_reset(s);
+    YJSON_FREE(s->c.stack);
+    YJSON_FREE(s->frames);
+    YJSON_FREE(s->tok);
+    YJSON_FREE(s);
+}
+
+static int yjson_stream_fail(yjson_stream* s, int error) {
+    yjson_stream_reset(s);
+    return s->error = error;
+}
+
+static void yjson_stream_token_append(yjson_stream* s, const char* p, size_t len) {
+    if (s->toklen + len + 1 > s->toksize) {
+        size_t size = s->toksize ? s->toksize : YJSON_PARSE_STACK_INIT_SIZE;
+        while (s->toklen + len + 1 > size)
+            size += size >> 1;
+        s->tok = (char*)YJSON_REALLOC(s->tok, s->toksize = size);
+    }
+    memcpy(s->tok + s->toklen, p, len);
+    s->toklen += len;
+    s->tok[s->toklen] = '\0';
+}
+
+/* returns the end of the current token, or NULL if it runs past end */
+static const char* yjson_stream_token_end(yjson_stream* s, const char* p, const char* end) {
+    switch (s->token) {
+        case YJSON_TOKEN_STRING:
+        case YJSON_TOKEN_KEY:
+            for (; p < end; p++) {
+                if (s->escape)
+                    s->escape = 0;
+                else if (*p == '\\')
+                    s->escape = 1;
+                else if (*p == '"' || (unsigned char)*p < 0x20)
+                    /* closing quote, or a bad byte the tokenizer will report */
+                    return p + 1;
+            }
+            return NULL;
+        case YJSON_TOKEN_NUMBER:
+            while (p < end && (ISDIGIT(*p) || *p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E'))
+                p++;
+            return p < end ? p : NULL;
+        default:
+            while (p < end && *p >= 'a' && *p <= 'z')
+                p++;
+            return p < end ? p : NULL;
+    }
+}
+
+/* hands a finished value to the open container, or makes it the root */
+static void yjson_stream_emit(yjson_stream* s, yjson_value* v) {
+    yjson_stream_frame* f;
+    if (s->depth == 0) {
+        memcpy(&s->root, v, sizeof(yjson_value));
+        s->state = YJSON_STREAM_DONE;
+        return;
+    }
+    f = &s->frames[s->depth - 1];
+    if (f->type == YJSON_ARRAY)
+        memcpy(yjson_context_push(&s->c, sizeof(yjson_value)), v, sizeof(yjson_value));
+    else {
+        yjson_member* m = (yjson_member*)yjson_context_push(&s->c, sizeof(yjson_member));
+        m->k = f->key;
+        m->klen = f->klen;
+        memcpy(&m->v, v, sizeof(yjson_value));
+        f->key = NULL;
+    }
+    f->size++;
+    s->state = YJSON_STREAM_AFTER_VALUE;
+}
+
+static void yjson_stream_open(yjson_stream* s, yjson_type type) {
+    yjson_stream_frame* f;
+    if (s->depth == s->frames_size) {
+        s->frames_size = s->frames_size ? s->frames_size + (s->frames_size >> 1) : 16;
+        s->frames = (yjson_stream_frame*)YJSON_REALLOC(s->frames, s->frames_size * sizeof(yjson_stream_frame));
+    }
+    f = &s->frames[s->depth++];
+    f->type = type;
+    f->size = 0;
+    f->key = NULL;
+    s->state = type == YJSON_ARRAY ? YJSON_STREAM_ARRAY_FIRST : YJSON_STREAM_OBJECT_FIRST;
+}
+
+static void yjson_stream_close(yjson_stream* s) {
+    yjson_stream_frame* f = &s->frames[--s->depth];
+    yjson_value v;
+    yjson_init(&v);
+    if (f->type == YJSON_ARRAY)
+        yjson_context_pop_array(&s->c, &v, f->size);
+    else
+        yjson_context_pop_object(&s->c, &v, f->size);
+    yjson_stream_emit(s, &v);
+}
+
+/* runs the tokenizer over a whole token at p; *next gets where it stopped */
+static int yjson_stream_scalar(yjson_stream* s, const char* p, const char* end, const char** next) {
+    int ret, token = s->token;
+    s->token = YJSON_TOKEN_NONE;
+    s->c.json = p;
+    s->c.end = end;
+    if (token == YJSON_TOKEN_KEY) {
+        yjson_stream_frame* f = &s->frames[s->depth - 1];
+        char* str;
+        if ((ret = yjson_parse_string_raw(&s->c, &str, &f->klen)) != YJSON_PARSE_OK)
+            return ret;
+        f->key = yjson_context_strdup(&s->c, str, f->klen);
+        s->state = YJSON_STREAM_COLON;
+    }
+    else {
+        yjson_value v;
+        yjson_init(&v);
+        if ((ret = yjson_parse_value(&s->c, &v)) != YJSON_PARSE_OK)
+            return ret;
+        yjson_stream_emit(s, &v);
+    }
+    *next = s->c.json;
+    return YJSON_PARSE_OK;
+}
+
+static int yjson_stream_run(yjson_stream* s, const char* p, const char* end) {
+    const char* q;
+    int ret;
+    while (p < end) {
+        if (s->token != YJSON_TOKEN_NONE) {
+            /* a token carried over from an earlier chunk */
+            if ((q = yjson_stream_token_end(s, p, end)) == NULL) {
+                yjson_stream_token_append(s, p, end - p);
+                return YJSON_PARSE_NEED_MORE;
+            }
+            yjson_stream_token_append(s, p, q - p);
+            p = q;
+            if ((ret = yjson_stream_scalar(s, s->tok, s->tok + s->toklen, &q)) != YJSON_PARSE_OK)
+                return ret;
+            /* whatever the tokenizer left over is an error after a value */
+            if ((ret = yjson_stream_run(s, q, s->tok + s->toklen)) != YJSON_PARSE_OK && ret != YJSON_PARSE_NEED_MORE)
+                return ret;
+            s->toklen = 0;
+            continue;
+        }
+        if (ISWHITESPACE(*p)) {
+            p++;
+            continue;
+        }
+        switch (s->state) {
+            case YJSON_STREAM_ARRAY_FIRST:
+                if (*p == ']') {
+                    p++;
+                    yjson_stream_close(s);
+                    continue;
+                }
+                /* fall through */
+            case YJSON_STREAM_VALUE:
+                switch (*p) {
+                    case '[':
+                    case '{':
+                        if (s->depth == YJSON_PARSE_MAX_DEPTH)
+                            return YJSON_PARSE_TOO_DEEP;
+                        yjson_stream_open(s, *p++ == '[' ? YJSON_ARRAY : YJSON_OBJECT);
+                        continue;
+                    case '"': s->token = YJSON_TOKEN_STRING; break;
+                    case 'n': case 't': case 'f': s->token = YJSON_TOKEN_LITERAL; break;
+                    default:
+                        if (*p != '-' && !ISDIGIT(*p))
+                            return YJSON_PARSE_INVALID_VALUE;
+                        s->token = YJSON_TOKEN_NUMBER;
+                }
+                break;
+            case YJSON_STREAM_OBJECT_FIRST:
+                if (*p == '}') {
+                    p++;
+                    yjson_stream_close(s);
+                    continue;
+                }
+                /* fall through */
+            case YJSON_STREAM_OBJECT_KEY:
+                if (*p != '"')
+                    return YJSON_PARSE_MISS_KEY;
+                s->token = YJSON_TOKEN_KEY;
+                break;
+            case YJSON_STREAM_COLON:
+                if (*p != ':')
+                    return YJSON_PARSE_MISS_COLON;
+                p++;
+                s->state = YJSON_STREAM_VALUE;
+                continue;
+            case YJSON_STREAM_AFTER_VALUE:
+                if (s->frames[s->depth - 1].type == YJSON_ARRAY) {
+                    if (*p == ',')
+                        s->state = YJSON_STREAM_VALUE;
+                    else if (*p == ']')
+                        yjson_stream_close(s);
+                    else
+                        return YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                }
+                else {
+                    if (*p == ',')
+                        s->state = YJSON_STREAM_OBJECT_KEY;
+                    else if (*p == '}')
+                        yjson_stream_close(s);
+                    else
+                        return YJSON_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                }
+                p++;
+                continue;
+            default:
+                return YJSON_PARSE_ROOT_NOT_SINGULAR;
+        }
+        /* a scalar starts at p */
+        s->escape = 0;
+        if ((q = yjson_stream_token_end(s, p + (*p == '"'), end)) == NULL) {
+            s->toklen = 0;
+            yjson_stream_token_append(s, p, end - p);
+            return YJSON_PARSE_NEED_MORE;
+        }
+        if ((ret = yjson_stream_scalar(s, p, end, &p)) != YJSON_PARSE_OK)
+            return ret;
+    }
+    return s->state == YJSON_STREAM_DONE && s->token == YJSON_TOKEN_NONE ? YJSON_PARSE_OK : YJSON_PARSE_NEED_MORE;
+}
+
+int yjson_stream_feed(yjson_stream* s, const char* chunk, size_t len) {
+    int ret;
+    assert(s != NULL && (chunk != NULL || len == 0));
+    if (s->error != YJSON_PARSE_OK)
+        return s->error;
+    ret = yjson_stream_run(s, chunk, chunk + len);
+    if (ret != YJSON_PARSE_OK && ret != YJSON_PARSE_NEED_MORE)
+        return yjson_stream_fail(s, ret);
+    return ret;
+}
+
+int yjson_stream_finish(yjson_stream* s, yjson_value* v) {
+    int ret = YJSON_PARSE_OK;
+    assert(s != NULL && v != NULL);
+    yjson_init(v);
+    if (s->error != YJSON_PARSE_OK)
+        ret = s->error;
+    else {
+        if (s->token != YJSON_TOKEN_NONE) {
+            /* end of input terminates the pending token */
+            const char* q;
+            if (s->toklen == 0)
+                yjson_stream_token_append(s, "", 0);
+            if ((ret = yjson_stream_scalar(s, s->tok, s->tok + s->toklen, &q)) == YJSON_PARSE_OK)
+                ret = yjson_stream_run(s, q, s->tok + s->toklen);
+            s->toklen = 0;
+        }
+        if (ret == YJSON_PARSE_OK || ret == YJSON_PARSE_NEED_MORE) {
+            switch (s->state) {
+                case YJSON_STREAM_DONE:
+                    memcpy(v, &s->root, sizeof(yjson_value));
+                    yjson_init(&s->root);
+                    ret = YJSON_PARSE_OK;
+                    break;
+                case YJSON_STREAM_OBJECT_FIRST:
+                case YJSON_STREAM_OBJECT_KEY:   ret = YJSON_PARSE_MISS_KEY; break;
+                case YJSON_STREAM_COLON:        ret = YJSON_PARSE_MISS_COLON; break;
+                case YJSON_STREAM_AFTER_VALUE:
+                    ret = s->frames[s->depth - 1].type == YJSON_ARRAY ?
+                        YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET : YJSON_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                    break;
+                default:                        ret = YJSON_PARSE_EXPECT_VALUE; break;
+            }
+        }
+    }
+    yjson_stream_reset(s);
+    return ret;
+}
+
+/*
+ * NDJSON batches. The input is cut into batches of about batch_size bytes
+ * that end on a newline, and workers claim them one at a time. A worker
+ * parses each record straight out of the input, bounded by its newline,
+ * into its own arena, so nothing is shared but the claim counter. In
+ * ordered mode a worker holds its parsed batch until the batches before it
+ * have been delivered.
+ */
+#ifndef YJSON_NDJSON_BATCH_SIZE
+#define YJSON_NDJSON_BATCH_SIZE (1 << 20)
+#endif
+
+#ifdef YJSON_THREADS
+#define YJSON_LOCK(job) pthread_mutex_lock(&(job)->lock)
+#define YJSON_UNLOCK(job) pthread_mutex_unlock(&(job)->lock)
+#else
+#define YJSON_LOCK(job) ((void)0)
+#define YJSON_UNLOCK(job) ((void)0)
+#endif
+
+typedef struct {
+    const char* json;
+    size_t len, batch_size;
+    size_t next;        /* offset of the first unclaimed byte */
+    size_t batches;     /* batches claimed so far */
+    size_t delivered;   /* batches delivered, in ordered mode */
+    int ordered, ret;
+    yjson_record_fn fn;
+    void* user;
+#ifdef YJSON_THREADS
+    pthread_mutex_t lock;
+    pthread_cond_t turn;
+#endif
+} yjson_ndjson_job;
+
+typedef struct {
+    size_t offset;
+    int status;
+    yjson_value v;
+} yjson_ndjson_record;
+
+typedef struct {
+    yjson_ndjson_job* job;
+    yjson_arena arena;
+    yjson_ndjson_record* records;
+    size_t nrecords, recsize;
+} yjson_ndjson_worker;
+
+/* parses [json, end) as yjson_parse_n() would, into a */
+static int yjson_parse_record(yjson_value* v, const char* json, const char* end, yjson_arena* a) {
+    yjson_context c;
+    yjson_context_init(&c, json);
+    c.end = c.limit = end;
+    c.arena = a;
+    return yjson_parse_cached(&c, v, a);
+}
+
+static int yjson_ndjson_claim(yjson_ndjson_job* job, size_t* begin, size_t* end, size_t* seq) {
+    int ret = 0;
+    YJSON_LOCK(job);
+    if (job->ret == YJSON_PARSE_OK && job->next < job->len) {
+        size_t e = job->next + job->batch_size;
+        if (e >= job->len)
+            e = job->len;
+        else {
+            const char* nl = (const char*)memchr(job->json + e, '\n', job->len - e);
+            e = nl ? (size_t)(nl - job->json) + 1 : job->len;
+        }
+        *begin = job->next;
+        *end = job->next = e;
+        *seq = job->batches++;
+        ret = 1;
+    }
+    YJSON_UNLOCK(job);
+    return ret;
+}
+
+/* read under the lock: another worker's fn may have stopped the run */
+static int yjson_ndjson_stopped(yjson_ndjson_job* job) {
+    int ret;
+    YJSON_LOCK(job);
+    ret = job->ret;
+    YJSON_UNLOCK(job);
+    return ret != YJSON_PARSE_OK;
+}
+
+static void yjson_ndjson_cancel(yjson_ndjson_job* job) {
+    YJSON_LOCK(job);
+    job->ret = YJSON_PARSE_CANCELED;
+    YJSON_UNLOCK(job);
+}
+
+static void yjson_ndjson_deliver(yjson_ndjson_worker* w, size_t seq) {
+    yjson_ndjson_job* job = w->job;
+    size_t i;
+    int ret;
+    YJSON_LOCK(job);
+#ifdef YJSON_THREADS
+    while (job->delivered != seq && job->ret == YJSON_PARSE_OK)
+        pthread_cond_wait(&job->turn, &job->lock);
+#endif
+    ret = job->ret;
+    YJSON_UNLOCK(job);
+    for (i = 0; i < w->nrecords && ret == YJSON_PARSE_OK; i++)
+        if (job->fn(job->user, w->records[i].offset, w->records[i].status, &w->records[i].v) != 0)
+            ret = YJSON_PARSE_CANCELED;
+    YJSON_LOCK(job);
+    if (ret != YJSON_PARSE_OK)
+        job->ret = ret;
+    job->delivered++;
+#ifdef YJSON_THREADS
+    pthread_cond_broadcast(&job->turn);
+#endif
+    YJSON_UNLOCK(job);
+}
+
+static void yjson_ndjson_batch(yjson_ndjson_worker* w, size_t begin, size_t end, size_t seq) {
+    yjson_ndjson_job* job = w->job;
+    const char *p, *q, *last;
+    w->nrecords = 0;
+    for (p = job->json + begin, last = job->json + end; p < last; p = q + 1) {
+        yjson_value v;
+        int status;
+        if (yjson_ndjson_stopped(job))
+            break;
+        if ((q = (const char*)memchr(p, '\n', last - p)) == NULL)
+            q = last;
+        /* blank lines are not records */
+        if ((status = yjson_parse_record(&v, p, q, &w->arena)) == YJSON_PARSE_EXPECT_VALUE)
+            continue;
+        if (!job->ordered) {
+            if (job->fn(job->user, (size_t)(p - job->json), status, &v) != 0) {
+                yjson_ndjson_cancel(job);
+                break;
+            }
+            yjson_arena_reset(&w->arena);
+            continue;
+        }
+        if (w->nrecords == w->recsize) {
+            w->recsize = w->recsize ? w->recsize + (w->recsize >> 1) : 64;
+            w->records = (yjson_ndjson_record*)YJSON_REALLOC(w->records, w->recsize * sizeof(yjson_ndjson_record));
+        }
+        w->records[w->nrecords].offset = (size_t)(p - job->json);
+        w->records[w->nrecords].status = status;
+        memcpy(&w->records[w->nrecords++].v, &v, sizeof(yjson_value));
+    }
+    if (job->ordered) {
+        yjson_ndjson_deliver(w, seq);
+        yjson_arena_reset(&w->arena);
+    }
+}
+
+static void* yjson_ndjson_run(void* arg) {
+    yjson_ndjson_worker* w = (yjson_ndjson_worker*)arg;
+    size_t begin, end, seq;
+    while (yjson_ndjson_claim(w->job, &begin, &end, &seq))
+        yjson_ndjson_batch(w, begin, end, seq);
+    return NULL;
+}
+
+static unsigned yjson_ndjson_threads(const yjson_ndjson_options* opt) {
+#ifdef YJSON_THREADS
+    long n;
+    if (opt != NULL && opt->threads > 0)
+        return opt->threads;
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1;
+#else
+    (void)opt;
+    return 1;
+#endif
+}
+
+int yjson_parse_ndjson(const char* json, size_t len, const yjson_ndjson_options* opt, yjson_record_fn fn, void* user) {
+    yjson_ndjson_job job;
+    yjson_ndjson_worker* w;
+    unsigned i, n = yjson_ndjson_threads(opt);
+    assert((json != NULL || len == 0) && fn != NULL);
+    job.json = json;
+    job.len = len;
+    job.batch_size = opt != NULL && opt->batch_size > 0 ? opt->batch_size : YJSON_NDJSON_BATCH_SIZE;
+    job.next = job.batches = job.delivered = 0;
+    job.ordered = opt != NULL && opt->ordered;
+    job.ret = YJSON_PARSE_OK;
+    job.fn = fn;
+    job.user = user;
+    if (n > len / job.batch_size + 1)
+        n = (unsigned)(len / job.batch_size + 1);
+    w = (yjson_ndjson_worker*)YJSON_MALLOC(n * sizeof(yjson_ndjson_worker));
+    for (i = 0; i < n; i++) {
+        w[i].job = &job;
+        yjson_arena_init(&w[i].arena, NULL, 0);
+        w[i].records = NULL;
+        w[i].nrecords = w[i].recsize = 0;
+    }
+#ifdef YJSON_THREADS
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.turn, NULL);
+    if (n > 1) {
+        pthread_t* t = (pthread_t*)YJSON_MALLOC((n - 1) * sizeof(pthread_t));
+        unsigned started;
+        for (started = 0; started < n - 1; started++)
+            if (pthread_create(&t[started], NULL, yjson_ndjson_run, &w[started + 1]) != 0)
+                break;
+        yjson_ndjson_run(&w[0]);
+        while (started > 0)
+            pthread_join(t[--started], NULL);
+        YJSON_FREE(t);
+    }
+    else
+#endif
+        yjson_ndjson_run(&w[0]);
+#ifdef YJSON_THREADS
+    pthread_cond_destroy(&job.turn);
+    pthread_mutex_destroy(&job.lock);
+#endif
+    for (i = 0; i < n; i++) {
+        yjson_arena_free(&w[i].arena);
+        YJSON_FREE(w[i].records);
+    }
+    YJSON_FREE(w);
+    return job.ret;
+}
+
+int yjson_parse_ndjson_file(const char* path, const yjson_ndjson_options* opt, yjson_record_fn fn, void* user) {
+    int ret;
+#ifdef YJSON_MMAP
+    struct stat st;
+    void* map = NULL;
+    int fd;
+    assert(path != NULL);
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return YJSON_PARSE_IO_ERROR;
+    if (fstat(fd, &st) != 0 || (st.st_size > 0 &&
+        (map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)) {
+        close(fd);
+        return YJSON_PARSE_IO_ERROR;
+    }
+    close(fd);
+    if (map == NULL)
+        return yjson_parse_ndjson("", 0, opt, fn, user);
+    posix_madvise(map, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+    ret = yjson_parse_ndjson((const char*)map, (size_t)st.st_size, opt, fn, user);
+    munmap(map, (size_t)st.st_size);
+#else
+    /* no mapping here: read the file whole instead */
+    FILE* fp;
+    char* buf;
+    long size;
+    assert(path != NULL);
+    if ((fp = fopen(path, "rb")) == NULL)
+        return YJSON_PARSE_IO_ERROR;
+    if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) != 0) {
+        fclose(fp);
+        return YJSON_PARSE_IO_ERROR;
+    }
+    buf = (char*)YJSON_MALLOC((size_t)size + 1);
+    if (fread(buf, 1, (size_t)size, fp) != (size_t)size) {
+        YJSON_FREE(buf);
+        fclose(fp);
+        return YJSON_PARSE_IO_ERROR;
+    }
+    fclose(fp);
+    ret = yjson_parse_ndjson(buf, (size_t)size, opt, fn, user);
+    YJSON_FREE(buf);
+#endif
+    return ret;
+}
+
+/*
+ * Lazy documents. One pass checks the grammar and lays down a tape with an
+ * entry per token: its offset in the input, for containers the member count
+ * and the tape index just past the container, so that siblings are one hop
+ * apart. The token's first byte tells its type. Strings and numbers are only
+ * decoded by the accessors, straight from the input, which the document
+ * borrows. The tape and scratch stack are kept across parses.
+ */
+typedef struct {
+    uint32_t pos;   /* offset of the token */
+    uint32_t next;  /* tape index of the next sibling */
+    uint32_t size;  /* elements or members of a container */
+} yjson_doc_entry;
+
+struct yjson_doc {
+    const char* json;
+    yjson_doc_entry* tape;
+    size_t count, cap;
+    char* stack;
+    size_t stack_size;
+};
+
+yjson_doc* yjson_doc_create(void) {
+    yjson_doc* d = (yjson_doc*)YJSON_MALLOC(sizeof(yjson_doc));
+    d->json = NULL;
+    d->tape = NULL;
+    d->count = d->cap = 0;
+    d->stack = NULL;
+    d->stack_size = 0;
+    return d;
+}
+
+void yjson_doc_destroy(yjson_doc* d) {
+    if (d == NULL)
+        return;
+    YJSON_FREE(d->tape);
+    YJSON_FREE(d->stack);
+    YJSON_FREE(d);
+}
+
+/*
+ * Checks the number grammar without converting. Only a number with an
+ * exponent or a very long integer part can overflow, so only those are
+ * converted, to reject them as yjson_parse() would.
+ */
+static int yjson_doc_number(yjson_context* c) {
+    const char *p = c->json, *q;
+    int convert = 0;
+    if (*p == '-')
+        p++;
+    if (*p == '0')
+        p++;
+    else {
+        if (!ISDIGIT1T09(*p))
+            return YJSON_PARSE_INVALID_VALUE;
+        for (q = p; ISDIGIT(*p); p++)
+            ;
+        convert = p - q > 308;
+    }
+    if (*p == '.') {
+        p++;
+        if (!ISDIGIT(*p))
+            return YJSON_PARSE_INVALID_VALUE;
+        while (ISDIGIT(*p))
+            p++;
+    }
+    /* the exponent is left to yjson_parse_number() */
+    if (*p == 'e' || *p == 'E')
+        convert = 1;
+    if (convert) {
+        yjson_value v;
+        yjson_init(&v);
+        return yjson_parse_number(c, &v);
+    }
+    c->json = p;
+    return YJSON_PARSE_OK;
+}
+
+static size_t yjson_doc_push(yjson_doc* d, const char* p) {
+    if (d->count == d->cap) {
+        d->cap = d->cap ? d->cap + (d->cap >> 1) : 256;
+        d->tape = (yjson_doc_entry*)YJSON_REALLOC(d->tape, d->cap * sizeof(yjson_doc_entry));
+    }
+    d->tape[d->count].pos = (uint32_t)(p - d->json);
+    d->tape[d->count].next = (uint32_t)(d->count + 1);
+    d->tape[d->count].size = 0;
+    return d->count++;
+}
+
+static int yjson_doc_value(yjson_context* c, yjson_doc* d) {
+    size_t i, size = 0;
+    char* s;
+    size_t len;
+    int ret;
+    yjson_value v;
+    if ((size_t)(c->json - d->json) >= UINT32_MAX)
+        return YJSON_PARSE_TOO_LARGE;
+    i = yjson_doc_push(d, c->json);
+    yjson_init(&v);
+    switch (*c->json) {
+        case 'n': return yjson_parse_literal(c, &v, "null", YJSON_NULL);
+        case 't': return yjson_parse_literal(c, &v, "true", YJSON_TRUE);
+        case 'f': return yjson_parse_literal(c, &v, "false", YJSON_FALSE);
+        case '"': return yjson_parse_string_raw(c, &s, &len);
+        case '[':
+            if (c->depth++ == YJSON_PARSE_MAX_DEPTH)
+                return YJSON_PARSE_TOO_DEEP;
+            c->json++;
+            yjson_parse_whitespace(c);
+            if (*c->json != ']') {
+                for (;;) {
+                    if ((ret = yjson_doc_value(c, d)) != YJSON_PARSE_OK)
+                        return ret;
+                    size++;
+                    yjson_parse_whitespace(c);
+                    if (*c->json == ',') {
+                        c->json++;
+                        yjson_parse_whitespace(c);
+                    }
+                    else if (*c->json == ']')
+                        break;
+                    else
+                        return YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                }
+            }
+            break;
+        case '{':
+            if (c->depth++ == YJSON_PARSE_MAX_DEPTH)
+                return YJSON_PARSE_TOO_DEEP;
+            c->json++;
+            yjson_parse_whitespace(c);
+            if (*c->json != '}') {
+                for (;;) {
+                    if (*c->json != '"')
+                        return YJSON_PARSE_MISS_KEY;
+                    if ((ret = yjson_doc_value(c, d)) != YJSON_PARSE_OK)
+                        return ret;
+                    yjson_parse_whitespace(c);
+                    if (*c->json != ':')
+                        return YJSON_PARSE_MISS_COLON;
+                    c->json++;
+                    yjson_parse_whitespace(c);
+                    if ((ret = yjson_doc_value(c, d)) != YJSON_PARSE_OK)
+                        return ret;
+                    size++;
+                    yjson_parse_whitespace(c);
+                    if (*c->json == ',') {
+                        c->json++;
+                        yjson_parse_whitespace(c);
+                    }
+                    else if (*c->json == '}')
+                        break;
+                    else
+                        return YJSON_PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                }
+            }
+            break;
+        case '\0':
+            if (YJSON_AT_END(c, c->json))
+                return YJSON_PARSE_EXPECT_VALUE;
+            return YJSON_PARSE_INVALID_VALUE;
+        default:
+            return yjson_doc_number(c);
+    }
+    /* only arrays and objects get here; an error abandons the whole parse */
+    c->depth--;
+    c->json++;
+    d->tape[i].next = (uint32_t)d->count;
+    d->tape[i].size = (uint32_t)size;
+    return YJSON_PARSE_OK;
+}
+
+int yjson_doc_parse(yjson_doc* d, const char* json) {
+    yjson_context c;
+    int ret;
+    assert(d != NULL && json != NULL);
+    d->json = json;
+    d->count = 0;
+    yjson_context_init(&c, json);
+    c.stack = d->stack;
+    c.size = d->stack_size;
+    yjson_parse_whitespace(&c);
+    if ((ret = yjson_doc_value(&c, d)) == YJSON_PARSE_OK) {
+        yjson_parse_whitespace(&c);
+        if (*c.json != '\0')
             ret = YJSON_PARSE_ROOT_NOT_SINGULAR;
-        }
-            
     }
+    d->stack = c.stack;
+    d->stack_size = c.size;
+    if (ret != YJSON_PARSE_OK)
+        d->count = 0;
+    return ret;
+}
 
-    assert(c.top ==0);
-    free(c.stack);
+#define YJSON_DOC_TOKEN(d, n) ((d)->json + (d)->tape[n].pos)
+
+/* builds an ordinary value from the token at n */
+static int yjson_get_value_at(const yjson_doc* d, yjson_node n, yjson_value* v) {
+    yjson_context c;
+    int ret;
+    yjson_context_init(&c, YJSON_DOC_TOKEN(d, n));
+    yjson_init(v);
+    ret = yjson_parse_value(&c, v);
+    YJSON_FREE(c.stack);
     return ret;
-    
+}
+
+yjson_type yjson_doc_get_type(const yjson_doc* d, yjson_node n) {
+    assert(d != NULL && n < d->count);
+    switch (*YJSON_DOC_TOKEN(d, n)) {
+        case 'n': return YJSON_NULL;
+        case 't': return YJSON_TRUE;
+        case 'f': return YJSON_FALSE;
+        case '"': return YJSON_STRING;
+        case '[': return YJSON_ARRAY;
+        case '{': return YJSON_OBJECT;
+        default:  return YJSON_NUMBER;
+    }
+}
+
+size_t yjson_doc_get_size(const yjson_doc* d, yjson_node n) {
+    assert(d != NULL && n < d->count);
+    assert(*YJSON_DOC_TOKEN(d, n) == '[' || *YJSON_DOC_TOKEN(d, n) == '{');
+    return d->tape[n].size;
+}
+
+yjson_node yjson_doc_get_element(const yjson_doc* d, yjson_node n, size_t index) {
+    assert(d != NULL && n < d->count && *YJSON_DOC_TOKEN(d, n) == '[');
+    if (index >= d->tape[n].size)
+        return YJSON_NODE_NONE;
+    for (n++; index > 0; index--)
+        n = d->tape[n].next;
+    return n;
+}
+
+const char* yjson_doc_get_string(yjson_doc* d, yjson_node n, size_t* len) {
+    yjson_context c;
+    char* s;
+    assert(d != NULL && n < d->count && *YJSON_DOC_TOKEN(d, n) == '"' && len != NULL);
+    yjson_context_init(&c, YJSON_DOC_TOKEN(d, n));
+    c.stack = d->stack;
+    c.size = d->stack_size;
+    /* already validated; an escaped string is decoded into the scratch stack */
+    yjson_parse_string_raw(&c, &s, len);
+    d->stack = c.stack;
+    d->stack_size = c.size;
+    return s;
+}
+
+yjson_node yjson_doc_find(yjson_doc* d, yjson_node n, const char* key, size_t klen) {
+    size_t i, size, len;
+    const char* k;
+    assert(d != NULL && n < d->count && *YJSON_DOC_TOKEN(d, n) == '{' && (key != NULL || klen == 0));
+    /* members are key, value pairs; the value links to the next key */
+    for (i = 0, size = d->tape[n++].size; i < size; i++, n = d->tape[n + 1].next) {
+        k = yjson_doc_get_string(d, n, &len);
+        if (len == klen && (klen == 0 || memcmp(k, key, klen) == 0))
+            return n + 1;
+    }
+    return YJSON_NODE_NONE;
+}
+
+yjson_node yjson_doc_get_path(yjson_doc* d, const char* path) {
+    yjson_node n = 0;
+    assert(d != NULL && path != NULL);
+    if (d->count == 0)
+        return YJSON_NODE_NONE;
+    while (*path != '\0' && n != YJSON_NODE_NONE) {
+        if (*path == '[') {
+            size_t index = 0;
+            if (!ISDIGIT(path[1]))
+                return YJSON_NODE_NONE;
+            path++;
+            while (ISDIGIT(*path))
+                index = index * 10 + (*path++ - '0');
+            if (*path++ != ']' || *YJSON_DOC_TOKEN(d, n) != '[')
+                return YJSON_NODE_NONE;
+            n = yjson_doc_get_element(d, n, index);
+        }
+        else {
+            const char* key = path += *path == '.';
+            while (*path != '\0' && *path != '.' && *path != '[')
+                path++;
+            if (*YJSON_DOC_TOKEN(d, n) != '{')
+                return YJSON_NODE_NONE;
+            n = yjson_doc_find(d, n, key, path - key);
+        }
+    }
+    return n;
+}
+
+int yjson_doc_get_boolean(const yjson_doc* d, yjson_node n) {
+    assert(d != NULL && n < d->count);
+    assert(*YJSON_DOC_TOKEN(d, n) == 't' || *YJSON_DOC_TOKEN(d, n) == 'f');
+    return *YJSON_DOC_TOKEN(d, n) == 't';
+}
+
+double yjson_doc_get_number(const yjson_doc* d, yjson_node n) {
+    yjson_value v;
+    assert(d != NULL && n < d->count && yjson_doc_get_type(d, n) == YJSON_NUMBER);
+    yjson_get_value_at(d, n, &v);
+    return yjson_get_number(&v);
+}
+
+int yjson_doc_get_value(const yjson_doc* d, yjson_node n, yjson_value* v) {
+    assert(d != NULL && n < d->count && v != NULL);
+    return yjson_get_value_at(d, n, v);
+}
+
+#ifndef YJSON_PARSE_STRINGIFY_INIT_SIZE
+#define YJSON_PARSE_STRINGIFY_INIT_SIZE 256
+#endif
+
+#define PUTS(c, s, len) memcpy(yjson_context_push(c, len), s, len)
+
+/*
+ * Shortest round-trip double formatting with Grisu2 (Florian Loitsch,
+ * "Printing Floating-Point Numbers Quickly and Accurately with Integers"),
+ * laid out after Milo Yip's implementation. Grisu2 always produces digits
+ * that read back to the same double and almost always the shortest ones.
+ */
+typedef struct {
+    uint64_t f;
+    int e;
+} yjson_diyfp;
+
+static const uint64_t yjson_cached_powers_f[] = {
+    UINT64_C(0xFA8FD5A0081C0288), UINT64_C(0xBAAEE17FA23EBF76), UINT64_C(0x8B16FB203055AC76), UINT64_C(0xCF42894A5DCE35EA),
+    UINT64_C(0x9A6BB0AA55653B2D), UINT64_C(0xE61ACF033D1A45DF), UINT64_C(0xAB70FE17C79AC6CA), UINT64_C(0xFF77B1FCBEBCDC4F),
+    UINT64_C(0xBE5691EF416BD60C), UINT64_C(0x8DD01FAD907FFC3C), UINT64_C(0xD3515C2831559A83), UINT64_C(0x9D71AC8FADA6C9B5),
+    UINT64_C(0xEA9C227723EE8BCB), UINT64_C(0xAECC49914078536D), UINT64_C(0x823C12795DB6CE57), UINT64_C(0xC21094364DFB5637),
+    UINT64_C(0x9096EA6F3848984F), UINT64_C(0xD77485CB25823AC7), UINT64_C(0xA086CFCD97BF97F4), UINT64_C(0xEF340A98172AACE5),
+    UINT64_C(0xB23867FB2A35B28E), UINT64_C(0x84C8D4DFD2C63F3B), UINT64_C(0xC5DD44271AD3CDBA), UINT64_C(0x936B9FCEBB25C996),
+    UINT64_C(0xDBAC6C247D62A584), UINT64_C(0xA3AB66580D5FDAF6), UINT64_C(0xF3E2F893DEC3F126), UINT64_C(0xB5B5ADA8AAFF80B8),
+    UINT64_C(0x87625F056C7C4A8B), UINT64_C(0xC9BCFF6034C13053), UINT64_C(0x964E858C91BA2655), UINT64_C(0xDFF9772470297EBD),
+    UINT64_C(0xA6DFBD9FB8E5B88F), UINT64_C(0xF8A95FCF88747D94), UINT64_C(0xB94470938FA89BCF), UINT64_C(0x8A08F0F8BF0F156B),
+    UINT64_C(0xCDB02555653131B6), UINT64_C(0x993FE2C6D07B7FAC), UINT64_C(0xE45C10C42A2B3B06), UINT64_C(0xAA242499697392D3),
+    UINT64_C(0xFD87B5F28300CA0E), UINT64_C(0xBCE5086492111AEB), UINT64_C(0x8CBCCC096F5088CC), UINT64_C(0xD1B71758E219652C),
+    UINT64_C(0x9C40000000000000), UINT64_C(0xE8D4A51000000000), UINT64_C(0xAD78EBC5AC620000), UINT64_C(0x813F3978F8940984),
+    UINT64_C(0xC097CE7BC90715B3), UINT64_C(0x8F7E32CE7BEA5C70), UINT64_C(0xD5D238A4ABE98068), UINT64_C(0x9F4F2726179A2245),
+    UINT64_C(0xED63A231D4C4FB27), UINT64_C(0xB0DE65388CC8ADA8), UINT64_C(0x83C7088E1AAB65DB), UINT64_C(0xC45D1DF942711D9A),
+    UINT64_C(0x924D692CA61BE758), UINT64_C(0xDA01EE641A708DEA), UINT64_C(0xA26DA3999AEF774A), UINT64_C(0xF209787BB47D6B85),
+    UINT64_C(0xB454E4A179DD1877), UINT64_C(0x865B86925B9BC5C2), UINT64_C(0xC83553C5C8965D3D), UINT64_C(0x952AB45CFA97A0B3),
+    UINT64_C(0xDE469FBD99A05FE3), UINT64_C(0xA59BC234DB398C25), UINT64_C(0xF6C69A72A3989F5C), UINT64_C(0xB7DCBF5354E9BECE),
+    UINT64_C(0x88FCF317F22241E2), UINT64_C(0xCC20CE9BD35C78A5), UINT64_C(0x98165AF37B2153DF), UINT64_C(0xE2A0B5DC971F303A),
+    UINT64_C(0xA8D9D1535CE3B396), UINT64_C(0xFB9B7CD9A4A7443C), UINT64_C(0xBB764C4CA7A44410), UINT64_C(0x8BAB8EEFB6409C1A),
+    UINT64_C(0xD01FEF10A657842C), UINT64_C(0x9B10A4E5E9913129), UINT64_C(0xE7109BFBA19C0C9D), UINT64_C(0xAC2820D9623BF429),
+    UINT64_C(0x80444B5E7AA7CF85), UINT64_C(0xBF21E44003ACDD2D), UINT64_C(0x8E679C2F5E44FF8F), UINT64_C(0xD433179D9C8CB841),
+    UINT64_C(0x9E19DB92B4E31BA9), UINT64_C(0xEB96BF6EBADF77D9), UINT64_C(0xAF87023B9BF0EE6B)
+};
+
+static const short yjson_cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+    -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+    1013, 1039, 1066
+};
+
+static yjson_diyfp yjson_diyfp_make(uint64_t f, int e) {
+    yjson_diyfp r;
+    r.f = f;
+    r.e = e;
+    return r;
+}
+
+static yjson_diyfp yjson_diyfp_mul(yjson_diyfp x, yjson_diyfp y) {
+    uint64_t h, l;
+    h = yjson_mul64(x.f, y.f, &l);
+    /* round the dropped half */
+    return yjson_diyfp_make(h + (l >> 63), x.e + y.e + 64);
+}
+
+static yjson_diyfp yjson_diyfp_normalize(yjson_diyfp x) {
+    int s = yjson_clz64(x.f);
+    return yjson_diyfp_make(x.f << s, x.e - s);
+}
+
+static void yjson_grisu_round(char* buf, int len, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buf[len - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static const uint32_t yjson_pow10_32[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+static int yjson_count_digits32(uint32_t n) {
+    int k = 1;
+    while (k < 10 && n >= yjson_pow10_32[k])
+        k++;
+    return k;
+}
+
+static int yjson_grisu2(double d, char* buf, int* k) {
+    uint64_t bits, f, delta, p2;
+    int e, len = 0, kappa, idx;
+    uint32_t p1;
+    double dk;
+    yjson_diyfp v, w_p, w_m, c_mk, W, Wp, Wm, one;
+
+    memcpy(&bits, &d, sizeof(d));
+    f = bits & ((UINT64_C(1) << 52) - 1);
+    e = (int)(bits >> 52 & 0x7FF);
+    if (e != 0) {
+        f += UINT64_C(1) << 52;
+        e -= 1075;
+    }
+    else
+        e = -1074;
+    v = yjson_diyfp_make(f, e);
+
+    /* boundaries m- and m+ of the rounding interval, on a common exponent */
+    w_p = yjson_diyfp_make((f << 1) + 1, e - 1);
+    while (!(w_p.f & (UINT64_C(1) << 53))) {
+        w_p.f <<= 1;
+        w_p.e--;
+    }
+    w_p.f <<= 10;
+    w_p.e -= 10;
+    w_m = f == UINT64_C(1) << 52 ? yjson_diyfp_make((f << 2) - 1, e - 2) : yjson_diyfp_make((f << 1) - 1, e - 1);
+    w_m.f <<= w_m.e - w_p.e;
+    w_m.e = w_p.e;
+
+    /* cached power c_mk = 10^-k that brings w_p.e into [-60, -32] */
+    dk = (-61 - w_p.e) * 0.30102999566398114 + 347;
+    idx = (int)dk;
+    if (dk - idx > 0.0)
+        idx++;
+    idx = (idx >> 3) + 1;
+    *k = -(-348 + (idx << 3));
+    c_mk = yjson_diyfp_make(yjson_cached_powers_f[idx], yjson_cached_powers_e[idx]);
+
+    W = yjson_diyfp_mul(yjson_diyfp_normalize(v), c_mk);
+    Wp = yjson_diyfp_mul(w_p, c_mk);
+    Wm = yjson_diyfp_mul(w_m, c_mk);
+    Wm.f++;
+    Wp.f--;
+    delta = Wp.f - Wm.f;
+
+    /* digit generation */
+    one = yjson_diyfp_make(UINT64_C(1) << -Wp.e, Wp.e);
+    p1 = (uint32_t)(Wp.f >> -one.e);
+    p2 = Wp.f & (one.f - 1);
+    kappa = yjson_count_digits32(p1);
+    while (kappa > 0) {
+        uint64_t tmp;
+        uint32_t dig = p1 / yjson_pow10_32[kappa - 1];
+        p1 %= yjson_pow10_32[kappa - 1];
+        if (dig || len)
+            buf[len++] = (char)('0' + dig);
+        kappa--;
+        tmp = ((uint64_t)p1 << -one.e) + p2;
+        if (tmp <= delta) {
+            *k += kappa;
+            yjson_grisu_round(buf, len, delta, tmp, (uint64_t)yjson_pow10_32[kappa] << -one.e, Wp.f - W.f);
+            return len;
+        }
+    }
+    for (;;) {
+        uint64_t unit = 1;
+        int i;
+        char dig;
+        p2 *= 10;
+        delta *= 10;
+        dig = (char)(p2 >> -one.e);
+        if (dig || len)
+            buf[len++] = (char)('0' + dig);
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *k += kappa;
+            for (i = 0; i < -kappa && i < 20; i++)
+                unit *= 10;
+            yjson_grisu_round(buf, len, delta, p2, one.f, -kappa < 20 ? (Wp.f - W.f) * unit : 0);
+            return len;
+        }
+    }
+}
+
+static char* yjson_write_exponent(int k, char* p) {
+    *p++ = 'e';
+    if (k < 0) {
+        *p++ = '-';
+        k = -k;
+    }
+    if (k >= 100) {
+        *p++ = (char)('0' + k / 100);
+        k %= 100;
+        *p++ = (char)('0' + k / 10);
+    }
+    else if (k >= 10)
+        *p++ = (char)('0' + k / 10);
+    *p++ = (char)('0' + k % 10);
+    return p;
+}
+
+/* writes d as the shortest text that parses back to it; returns the end */
+static char* yjson_dtoa(double d, char* buf) {
+    int len, k, kk, i;
+    if (d != d || d - d != 0) {
+        /* NaN and infinities have no JSON form */
+        memcpy(buf, "null", 4);
+        return buf + 4;
+    }
+    if (d == 0.0) {
+        if (1.0 / d < 0)
+            *buf++ = '-';
+        memcpy(buf, "0.0", 3);
+        return buf + 3;
+    }
+    if (d < 0) {
+        *buf++ = '-';
+        d = -d;
+    }
+    len = yjson_grisu2(d, buf, &k);
+    kk = len + k; /* 10^(kk-1) <= d < 10^kk */
+    if (k >= 0 && kk <= 21) {
+        /* 1234e7 -> 12340000000.0, the ".0" keeps it a double on reparse */
+        for (i = len; i < kk; i++)
+            buf[i] = '0';
+        buf[kk] = '.';
+        buf[kk + 1] = '0';
+        return buf + kk + 2;
+    }
+    if (kk > 0 && kk <= 21) {
+        /* 1234e-2 -> 12.34 */
+        memmove(buf + kk + 1, buf + kk, len - kk);
+        buf[kk] = '.';
+        return buf + len + 1;
+    }
+    if (kk > -6 && kk <= 0) {
+        /* 1234e-6 -> 0.001234 */
+        int offset = 2 - kk;
+        memmove(buf + offset, buf, len);
+        buf[0] = '0';
+        buf[1] = '.';
+        for (i = 2; i < offset; i++)
+            buf[i] = '0';
+        return buf + len + offset;
+    }
+    if (len == 1)
+        /* 1e30 */
+        return yjson_write_exponent(kk - 1, buf + 1);
+    /* 1234e30 -> 1.234e33 */
+    memmove(buf + 2, buf + 1, len - 1);
+    buf[1] = '.';
+    return yjson_write_exponent(kk - 1, buf + len + 1);
+}
+
+static char* yjson_u64toa(uint64_t n, char* buf) {
+    char tmp[20];
+    int i = 0;
+    do {
+        tmp[i++] = (char)('0' + n % 10);
+        n /= 10;
+    } while (n != 0);
+    while (i > 0)
+        *buf++ = tmp[--i];
+    return buf;
+}
+
+static void yjson_stringify_number(yjson_context* c, const yjson_value* v) {
+    char* buf = (char*)yjson_context_push(c, 32);
+    char* end;
+    if (v->flags & YJSON_FLAG_INT64) {
+        if (v->u.i64 < 0) {
+            *buf = '-';
+            end = yjson_u64toa(0 - (uint64_t)v->u.i64, buf + 1);
+        }
+        else
+            end = yjson_u64toa((uint64_t)v->u.i64, buf);
+    }
+    else if (v->flags & YJSON_FLAG_UINT64)
+        end = yjson_u64toa(v->u.u64, buf);
+    else
+        end = yjson_dtoa(v->u.n, buf);
+    c->top -= 32 - (end - buf);
+}
+
+static void yjson_stringify_string(yjson_context* c, const char* s, size_t len) {
+    static const char hex_digits[] = "0123456789ABCDEF";
+    const char* end = s + len;
+    PUTC(c, '"');
+    for (;;) {
+        /* strings are NUL-terminated, so the scanner stops by end at the latest */
+        const char* q = yjson_scan_string(s);
+        char* p;
+        if (q > end)
+            q = end;
+        if (q != s)
+            PUTS(c, s, (size_t)(q - s));
+        if (q == end)
+            break;
+        p = (char*)yjson_context_push(c, 2);
+        p[0] = '\\';
+        switch (*q) {
+            case '\"': p[1] = '\"'; break;
+            case '\\': p[1] = '\\'; break;
+            case '\b': p[1] = 'b';  break;
+            case '\f': p[1] = 'f';  break;
+            case '\n': p[1] = 'n';  break;
+            case '\r': p[1] = 'r';  break;
+            case '\t': p[1] = 't';  break;
+            default:
+                p[1] = 'u';
+                p = (char*)yjson_context_push(c, 4);
+                p[0] = '0';
+                p[1] = '0';
+                p[2] = hex_digits[(unsigned char)*q >> 4];
+                p[3] = hex_digits[(unsigned char)*q & 15];
+        }
+        s = q + 1;
+    }
+    PUTC(c, '"');
+}
+
+/* returns 0 if v nests deeper than YJSON_PARSE_MAX_DEPTH */
+static int yjson_stringify_value(yjson_context* c, const yjson_value* v, size_t depth) {
+    size_t i;
+    if ((v->type == YJSON_ARRAY || v->type == YJSON_OBJECT) && depth >= YJSON_PARSE_MAX_DEPTH)
+        return 0;
+    switch (v->type) {
+        case YJSON_NULL:   PUTS(c, "null",  4); break;
+        case YJSON_FALSE:  PUTS(c, "false", 5); break;
+        case YJSON_TRUE:   PUTS(c, "true",  4); break;
+        case YJSON_NUMBER: yjson_stringify_number(c, v); break;
+        case YJSON_STRING: yjson_stringify_string(c, yjson_get_string(v), yjson_get_string_length(v)); break;
+        case YJSON_ARRAY:
+            PUTC(c, '[');
+            for (i = 0; i < v->u.a.size; i++) {
+                if (i > 0)
+                    PUTC(c, ',');
+                if (!yjson_stringify_value(c, &v->u.a.e[i], depth + 1))
+                    return 0;
+            }
+            PUTC(c, ']');
+            break;
+        case YJSON_OBJECT:
+            PUTC(c, '{');
+            for (i = 0; i < v->u.o.size; i++) {
+                if (i > 0)
+                    PUTC(c, ',');
+                yjson_stringify_string(c, v->u.o.m[i].k, v->u.o.m[i].klen);
+                PUTC(c, ':');
+                if (!yjson_stringify_value(c, &v->u.o.m[i].v, depth + 1))
+                    return 0;
+            }
+            PUTC(c, '}');
+            break;
+        default: assert(0 && "invalid type");
+    }
+    return 1;
+}
+
+char* yjson_stringify(const yjson_value* v, size_t* length) {
+    yjson_context c;
+    assert(v != NULL);
+    yjson_context_init(&c, NULL);
+    c.stack = (char*)YJSON_MALLOC(c.size = YJSON_PARSE_STRINGIFY_INIT_SIZE);
+    if (!yjson_stringify_value(&c, v, 0)) {
+        YJSON_FREE(c.stack);
+        return NULL;
+    }
+    if (length)
+        *length = c.top;
+    PUTC(&c, '\0');
+    return c.stack;
+}
+
+/*
+ * Binary encoding. A 12-byte header (magic, byte-order mark, total size) is
+ * followed by the root node; every node starts with a one-byte tag:
+ *
+ *   null, false, true                tag
+ *   double, int64, uint64            tag, 8 bytes in native order
+ *   int32                            tag, 4 bytes (an int64 that fits)
+ *   string                           tag, uint32 length, bytes, '\0'
+ *   array                            tag, uint32 size, size uint32 offsets
+ *   object                           tag, uint32 size, size (key, value) offset pairs
+ *   indexed object                   as object with uint32 capacity after size
+ *                                    and the hash slots after the pairs
+ *
+ * Offsets count from the start of the buffer, so it can be mapped anywhere.
+ * Nodes are laid out depth first with each container's children right after
+ * its table, and an object's key right before its value, unless the same key
+ * was written before, in which case the offset points back at that copy.
+ * yjson_binary_check() relies on this layout to validate a buffer in a
+ * single pass. Multi-byte fields are unaligned and read with memcpy().
+ * Containers nest at most YJSON_PARSE_MAX_DEPTH deep, as in parsed text,
+ * which bounds the recursion of the checker and of the decoder behind it.
+ */
+
+enum {
+    YJSON_BIN_DOUBLE = YJSON_NUMBER,
+    YJSON_BIN_INT64 = YJSON_OBJECT + 1,
+    YJSON_BIN_UINT64,
+    YJSON_BIN_INDEXED_OBJECT,
+    YJSON_BIN_INT32
+};
+
+/* keys written so far: a slot holds the offset of the key node, 0 if empty */
+typedef struct {
+    uint32_t* slots;
+    size_t cap, count;
+} yjson_bin_keys;
+
+static const char yjson_bin_magic[4] = { 'Y', 'J', 'B', '1' };
+
+static uint32_t yjson_bin_u32(const unsigned char* p) {
+    uint32_t u;
+    memcpy(&u, p, sizeof(u));
+    return u;
+}
+
+static void yjson_bin_set_u32(yjson_context* c, size_t at, size_t x) {
+    uint32_t u = (uint32_t)x;
+    memcpy(c->stack + at, &u, sizeof(u));
+}
+
+static void yjson_bin_put_u32(yjson_context* c, size_t x) {
+    size_t at = c->top;
+    yjson_context_push(c, sizeof(uint32_t));
+    yjson_bin_set_u32(c, at, x);
+}
+
+static void yjson_bin_put_string(yjson_context* c, const char* s, size_t len) {
+    PUTC(c, YJSON_STRING);
+    yjson_bin_put_u32(c, len);
+    if (len > 0)
+        PUTS(c, s, len);
+    PUTC(c, '\0');
+}
+
+static void yjson_bin_put_key(yjson_context* c, yjson_bin_keys* keys, size_t at, const char* k, size_t klen) {
+    uint32_t* slot;
+    size_t i, mask;
+    if (keys->count * 2 >= keys->cap) {
+        /* rehash the keys already written by their contents */
+        uint32_t* old = keys->slots;
+        size_t n = keys->cap;
+        keys->cap = n ? n * 2 : 256;
+        keys->slots = (uint32_t*)YJSON_MALLOC(keys->cap * sizeof(uint32_t));
+        memset(keys->slots, 0, keys->cap * sizeof(uint32_t));
+        for (i = 0, mask = keys->cap - 1; i < n; i++) {
+            const unsigned char* p = (const unsigned char*)c->stack + old[i];
+            if (old[i] == 0)
+                continue;
+            for (slot = keys->slots + (yjson_hash((const char*)p + 5, yjson_bin_u32(p + 1)) & mask); *slot != 0; )
+                slot = keys->slots + ((slot - keys->slots + 1) & mask);
+            *slot = old[i];
+        }
+        YJSON_FREE(old);
+    }
+    mask = keys->cap - 1;
+    for (slot = keys->slots + (yjson_hash(k, klen) & mask); *slot != 0; slot = keys->slots + ((slot - keys->slots + 1) & mask)) {
+        const unsigned char* p = (const unsigned char*)c->stack + *slot;
+        if (yjson_bin_u32(p + 1) == klen && memcmp(p + 5, k, klen) == 0) {
+            yjson_bin_set_u32(c, at, *slot);
+            return;
+        }
+    }
+    if (c->top <= UINT32_MAX) {
+        *slot = (uint32_t)c->top;
+        keys->count++;
+    }
+    yjson_bin_set_u32(c, at, c->top);
+    yjson_bin_put_string(c, k, klen);
+}
+
+/* returns 0 if v nests deeper than YJSON_PARSE_MAX_DEPTH */
+static int yjson_bin_put_value(yjson_context* c, yjson_bin_keys* keys, const yjson_value* v, size_t depth) {
+    size_t i, j, table, size, cap, mask;
+    if ((v->type == YJSON_ARRAY || v->type == YJSON_OBJECT) && depth >= YJSON_PARSE_MAX_DEPTH)
+        return 0;
+    switch (v->type) {
+        case YJSON_NUMBER:
+            if ((v->flags & YJSON_FLAG_INT64) && v->u.i64 >= INT32_MIN && v->u.i64 <= INT32_MAX) {
+                int32_t i32 = (int32_t)v->u.i64;
+                PUTC(c, YJSON_BIN_INT32);
+                PUTS(c, &i32, sizeof(int32_t));
+            }
+            else if (v->flags & YJSON_FLAG_INT64) {
+                PUTC(c, YJSON_BIN_INT64);
+                PUTS(c, &v->u.i64, sizeof(int64_t));
+            }
+            else if (v->flags & YJSON_FLAG_UINT64) {
+                PUTC(c, YJSON_BIN_UINT64);
+                PUTS(c, &v->u.u64, sizeof(uint64_t));
+            }
+            else {
+                PUTC(c, YJSON_BIN_DOUBLE);
+                PUTS(c, &v->u.n, sizeof(double));
+            }
+            break;
+        case YJSON_STRING:
+            yjson_bin_put_string(c, yjson_get_string(v), yjson_get_string_length(v));
+            break;
+        case YJSON_ARRAY:
+            PUTC(c, YJSON_ARRAY);
+            yjson_bin_put_u32(c, size = v->u.a.size);
+            table = c->top;
+            if (size > 0)
+                yjson_context_push(c, size * sizeof(uint32_t));
+            for (i = 0; i < size; i++) {
+                yjson_bin_set_u32(c, table + i * sizeof(uint32_t), c->top);
+                if (!yjson_bin_put_value(c, keys, &v->u.a.e[i], depth + 1))
+                    return 0;
+            }
+            break;
+        case YJSON_OBJECT:
+            size = v->u.o.size;
+            cap = size >= YJSON_OBJECT_INDEX_MIN ? yjson_index_capacity(size) : 0;
+            PUTC(c, cap ? YJSON_BIN_INDEXED_OBJECT : YJSON_OBJECT);
+            yjson_bin_put_u32(c, size);
+            if (cap)
+                yjson_bin_put_u32(c, cap);
+            table = c->top;
+            if (size > 0)
+                memset(yjson_context_push(c, (size * 2 + cap) * sizeof(uint32_t)), 0, (size * 2 + cap) * sizeof(uint32_t));
+            for (i = 0; i < size; i++) {
+                yjson_bin_put_key(c, keys, table + i * 2 * sizeof(uint32_t), v->u.o.m[i].k, v->u.o.m[i].klen);
+                yjson_bin_set_u32(c, table + (i * 2 + 1) * sizeof(uint32_t), c->top);
+                if (!yjson_bin_put_value(c, keys, &v->u.o.m[i].v, depth + 1))
+                    return 0;
+            }
+            /* the same index as in memory: a slot holds the member number + 1 */
+            table += size * 2 * sizeof(uint32_t);
+            for (i = 0, mask = cap - 1; i < size && cap; i++) {
+                j = yjson_hash(v->u.o.m[i].k, v->u.o.m[i].klen) & mask;
+                while (yjson_bin_u32((const unsigned char*)c->stack + table + j * sizeof(uint32_t)) != 0)
+                    j = (j + 1) & mask;
+                yjson_bin_set_u32(c, table + j * sizeof(uint32_t), i + 1);
+            }
+            break;
+        default:
+            PUTC(c, (char)v->type);
+            break;
+    }
+    return 1;
+}
+
+char* yjson_encode_binary(const yjson_value* v, size_t* length) {
+    yjson_context c;
+    yjson_bin_keys keys;
+    uint32_t mark = 0x01020304;
+    int ok;
+    assert(v != NULL);
+    yjson_context_init(&c, NULL);
+    c.stack = (char*)YJSON_MALLOC(c.size = YJSON_PARSE_STRINGIFY_INIT_SIZE);
+    PUTS(&c, yjson_bin_magic, sizeof(yjson_bin_magic));
+    PUTS(&c, &mark, sizeof(mark));
+    yjson_context_push(&c, sizeof(uint32_t));
+    keys.slots = NULL;
+    keys.cap = keys.count = 0;
+    ok = yjson_bin_put_value(&c, &keys, v, 0);
+    YJSON_FREE(keys.slots);
+    if (!ok || c.top > UINT32_MAX) {
+        YJSON_FREE(c.stack);
+        return NULL;
+    }
+    yjson_bin_set_u32(&c, 8, c.top);
+    if (length)
+        *length = c.top;
+    return c.stack;
+}
+
+/* returns the end of the node at n, or 0 if it is malformed or too deep */
+static size_t yjson_bin_check(const unsigned char* b, size_t size, size_t n, size_t depth) {
+    size_t i, count, cap = 0, end, pairs, used;
+    if (n >= size)
+        return 0;
+    switch (b[n]) {
+        case YJSON_NULL:
+        case YJSON_FALSE:
+        case YJSON_TRUE:
+            return n + 1;
+        case YJSON_BIN_DOUBLE:
+        case YJSON_BIN_INT64:
+        case YJSON_BIN_UINT64:
+            return size - n > 8 ? n + 9 : 0;
+        case YJSON_BIN_INT32:
+            return size - n > 4 ? n + 5 : 0;
+        case YJSON_STRING:
+            if (size - n < 5 || (count = yjson_bin_u32(b + n + 1)) >= size - n - 5 || b[n + 5 + count] != '\0')
+                return 0;
+            return n + 6 + count;
+        case YJSON_ARRAY:
+            if (depth >= YJSON_PARSE_MAX_DEPTH || size - n < 5 || (count = yjson_bin_u32(b + n + 1)) > (size - n - 5) / 4)
+                return 0;
+            end = n + 5 + count * 4;
+            for (i = 0; i < count; i++)
+                if (yjson_bin_u32(b + n + 5 + i * 4) != end || (end = yjson_bin_check(b, size, end, depth + 1)) == 0)
+                    return 0;
+            return end;
+        case YJSON_BIN_INDEXED_OBJECT:
+        case YJSON_OBJECT:
+            if (depth >= YJSON_PARSE_MAX_DEPTH || size - n < 5 || (count = yjson_bin_u32(b + n + 1)) > (size - n - 5) / 8)
+                return 0;
+            n += 5;
+            if (b[n - 5] == YJSON_BIN_INDEXED_OBJECT) {
+                /* a power of two of at least 2 * count, or a probe might never end */
+                if (size - n < 4 || (cap = yjson_bin_u32(b + n)) < count * 2 || cap == 0 || (cap & (cap - 1)) != 0)
+                    return 0;
+                n += 4;
+            }
+            if (count > (size - n) / 8 || cap > (size - n - count * 8) / 4)
+                return 0;
+            pairs = n;
+            end = n + (count * 2 + cap) * 4;
+            for (i = 0; i < count * 2; i++) {
+                size_t at = yjson_bin_u32(b + pairs + i * 4);
+                if (i % 2 == 0 && at < end) {
+                    /* points back at a key written earlier */
+                    if (b[at] != YJSON_STRING || yjson_bin_check(b, size, at, depth + 1) == 0)
+                        return 0;
+                    continue;
+                }
+                if (at != end || (i % 2 == 0 && b[end] != YJSON_STRING))
+                    return 0;
+                if ((end = yjson_bin_check(b, size, end, depth + 1)) == 0)
+                    return 0;
+            }
+            /* one slot per member, so every probe meets an empty slot */
+            for (i = used = 0; i < cap; i++) {
+                size_t slot = yjson_bin_u32(b + pairs + (count * 2 + i) * 4);
+                if (slot > count)
+                    return 0;
+                used += slot != 0;
+            }
+            return cap && used != count ? 0 : end;
+        default:
+            return 0;
+    }
+}
+
+int yjson_binary_check(const void* data, size_t length) {
+    const unsigned char* b = (const unsigned char*)data;
+    uint32_t mark;
+    if (b == NULL || length < YJSON_BINARY_ROOT || memcmp(b, yjson_bin_magic, sizeof(yjson_bin_magic)) != 0)
+        return YJSON_PARSE_INVALID_BINARY;
+    memcpy(&mark, b + 4, sizeof(mark));
+    if (mark != 0x01020304 || yjson_bin_u32(b + 8) != length)
+        return YJSON_PARSE_INVALID_BINARY;
+    if (yjson_bin_check(b, length, YJSON_BINARY_ROOT, 0) != length)
+        return YJSON_PARSE_INVALID_BINARY;
+    return YJSON_PARSE_OK;
+}
+
+#define YJSON_BIN_TAG(data, n) (((const unsigned char*)(data))[n])
+
+yjson_type yjson_binary_get_type(const void* data, yjson_node n) {
+    int tag;
+    assert(data != NULL && n != YJSON_NODE_NONE);
+    tag = YJSON_BIN_TAG(data, n);
+    if (tag == YJSON_BIN_INDEXED_OBJECT)
+        return YJSON_OBJECT;
+    return tag > YJSON_OBJECT ? YJSON_NUMBER : (yjson_type)tag;
+}
+
+size_t yjson_binary_get_size(const void* data, yjson_node n) {
+    assert(yjson_binary_get_type(data, n) == YJSON_ARRAY || yjson_binary_get_type(data, n) == YJSON_OBJECT);
+    return yjson_bin_u32((const unsigned char*)data + n + 1);
+}
+
+yjson_node yjson_binary_get_element(const void* data, yjson_node n, size_t index) {
+    assert(data != NULL && n != YJSON_NODE_NONE && YJSON_BIN_TAG(data, n) == YJSON_ARRAY);
+    if (index >= yjson_binary_get_size(data, n))
+        return YJSON_NODE_NONE;
+    return yjson_bin_u32((const unsigned char*)data + n + 5 + index * 4);
+}
+
+/* the object's (key, value) table */
+static const unsigned char* yjson_bin_pairs(const void* data, yjson_node n) {
+    assert(data != NULL && n != YJSON_NODE_NONE && yjson_binary_get_type(data, n) == YJSON_OBJECT);
+    return (const unsigned char*)data + n + (YJSON_BIN_TAG(data, n) == YJSON_BIN_INDEXED_OBJECT ? 9 : 5);
+}
+
+const char* yjson_binary_get_key(const void* data, yjson_node n, size_t index, size_t* len) {
+    yjson_node k;
+    assert(index < yjson_binary_get_size(data, n));
+    k = yjson_bin_u32(yjson_bin_pairs(data, n) + index * 8);
+    return yjson_binary_get_string(data, k, len);
+}
+
+yjson_node yjson_binary_get_member(const void* data, yjson_node n, size_t index) {
+    assert(index < yjson_binary_get_size(data, n));
+    return yjson_bin_u32(yjson_bin_pairs(data, n) + index * 8 + 4);
+}
+
+yjson_node yjson_binary_find(const void* data, yjson_node n, const char* key, size_t klen) {
+    const unsigned char* pairs = yjson_bin_pairs(data, n);
+    size_t i, j, size = yjson_binary_get_size(data, n);
+    const char* k;
+    size_t len;
+    assert(key != NULL || klen == 0);
+    if (YJSON_BIN_TAG(data, n) == YJSON_BIN_INDEXED_OBJECT) {
+        const unsigned char* slots = pairs + size * 8;
+        size_t mask = yjson_bin_u32((const unsigned char*)data + n + 5) - 1;
+        for (j = yjson_hash(key, klen) & mask; (i = yjson_bin_u32(slots + j * 4)) != 0; j = (j + 1) & mask) {
+            k = yjson_binary_get_key(data, n, i - 1, &len);
+            if (len == klen && memcmp(k, key, klen) == 0)
+                return yjson_binary_get_member(data, n, i - 1);
+        }
+        return YJSON_NODE_NONE;
+    }
+    for (i = 0; i < size; i++) {
+        k = yjson_binary_get_key(data, n, i, &len);
+        if (len == klen && memcmp(k, key, klen) == 0)
+            return yjson_binary_get_member(data, n, i);
+    }
+    return YJSON_NODE_NONE;
+}
+
+int yjson_binary_get_boolean(const void* data, yjson_node n) {
+    assert(data != NULL && n != YJSON_NODE_NONE);
+    assert(YJSON_BIN_TAG(data, n) == YJSON_TRUE || YJSON_BIN_TAG(data, n) == YJSON_FALSE);
+    return YJSON_BIN_TAG(data, n) == YJSON_TRUE;
+}
+
+double yjson_binary_get_number(const void* data, yjson_node n) {
+    const unsigned char* p = (const unsigned char*)data + n + 1;
+    double d;
+    int64_t i64;
+    uint64_t u64;
+    int32_t i32;
+    assert(yjson_binary_get_type(data, n) == YJSON_NUMBER);
+    switch (YJSON_BIN_TAG(data, n)) {
+        case YJSON_BIN_INT32:  memcpy(&i32, p, sizeof(i32)); return i32;
+        case YJSON_BIN_INT64:  memcpy(&i64, p, sizeof(i64)); return (double)i64;
+        case YJSON_BIN_UINT64: memcpy(&u64, p, sizeof(u64)); return (double)u64;
+        default:               memcpy(&d, p, sizeof(d)); return d;
+    }
+}
+
+const char* yjson_binary_get_string(const void* data, yjson_node n, size_t* len) {
+    assert(data != NULL && n != YJSON_NODE_NONE && YJSON_BIN_TAG(data, n) == YJSON_STRING && len != NULL);
+    *len = yjson_bin_u32((const unsigned char*)data + n + 1);
+    return (const char*)data + n + 5;
+}
+
+static void yjson_bin_get_value(const void* data, yjson_node n, yjson_value* v) {
+    const unsigned char* p = (const unsigned char*)data + n + 1;
+    const char* s;
+    size_t i, size, len;
+    int32_t i32;
+    v->flags = 0;
+    switch (YJSON_BIN_TAG(data, n)) {
+        case YJSON_BIN_DOUBLE:
+            v->type = YJSON_NUMBER;
+            memcpy(&v->u.n, p, sizeof(double));
+            break;
+        case YJSON_BIN_INT32:
+            v->type = YJSON_NUMBER;
+            v->flags = YJSON_FLAG_INT64;
+            memcpy(&i32, p, sizeof(int32_t));
+            v->u.i64 = i32;
+            break;
+        case YJSON_BIN_INT64:
+            v->type = YJSON_NUMBER;
+            v->flags = YJSON_FLAG_INT64;
+            memcpy(&v->u.i64, p, sizeof(int64_t));
+            break;
+        case YJSON_BIN_UINT64:
+            v->type = YJSON_NUMBER;
+            v->flags = YJSON_FLAG_UINT64;
+            memcpy(&v->u.u64, p, sizeof(uint64_t));
+            break;
+        case YJSON_STRING:
+            s = yjson_binary_get_string(data, n, &len);
+            if (len <= YJSON_INLINE_MAX)
+                yjson_set_inline(v, s, len);
+            else {
+                v->type = YJSON_STRING;
+                v->u.s.s = (char*)YJSON_MALLOC(len + 1);
+                memcpy(v->u.s.s, s, len + 1);
+                v->u.s.len = len;
+            }
+            break;
+        case YJSON_ARRAY:
+            v->type = YJSON_ARRAY;
+            v->u.a.size = size = yjson_binary_get_size(data, n);
+            v->u.a.e = size > 0 ? (yjson_value*)YJSON_MALLOC(size * sizeof(yjson_value)) : NULL;
+            for (i = 0; i < size; i++)
+                yjson_bin_get_value(data, yjson_binary_get_element(data, n, i), &v->u.a.e[i]);
+            break;
+        case YJSON_OBJECT:
+        case YJSON_BIN_INDEXED_OBJECT:
+            v->type = YJSON_OBJECT;
+            v->u.o.size = size = yjson_binary_get_size(data, n);
+            v->u.o.m = NULL;
+            if (size > 0) {
+                /* rebuilt for this build's YJSON_OBJECT_INDEX_MIN */
+                int indexed = size >= YJSON_OBJECT_INDEX_MIN && size < UINT32_MAX;
+                size_t extra = indexed ? yjson_index_capacity(size) * sizeof(uint32_t) : 0;
+                v->u.o.m = (yjson_member*)YJSON_MALLOC(size * sizeof(yjson_member) + extra);
+                for (i = 0; i < size; i++) {
+                    s = yjson_binary_get_key(data, n, i, &len);
+                    v->u.o.m[i].k = (char*)YJSON_MALLOC(len + 1);
+                    memcpy(v->u.o.m[i].k, s, len + 1);
+                    v->u.o.m[i].klen = len;
+                    yjson_bin_get_value(data, yjson_binary_get_member(data, n, i), &v->u.o.m[i].v);
+                }
+                if (indexed)
+                    yjson_index_build(v);
+            }
+            break;
+        default:
+            v->type = (yjson_type)YJSON_BIN_TAG(data, n);
+            break;
+    }
+}
+
+int yjson_binary_get_value(const void* data, yjson_node n, yjson_value* v) {
+    assert(data != NULL && n != YJSON_NODE_NONE && v != NULL);
+    yjson_bin_get_value(data, n, v);
+    return YJSON_PARSE_OK;
+}
 
+int yjson_decode_binary(yjson_value* v, const void* data, size_t length) {
+    int ret;
+    assert(v != NULL);
+    yjson_init(v);
+    if ((ret = yjson_binary_check(data, length)) != YJSON_PARSE_OK)
+        return ret;
+    yjson_bin_get_value(data, YJSON_BINARY_ROOT, v);
+    return YJSON_PARSE_OK;
 }
 
 yjson_type yjson_get_type(const yjson_value* v){
@@ -221,6 +4237,10 @@ yjson_type yjson_get_type(const yjson_value* v){
 }
 double yjson_get_number(const yjson_value *v){
     assert(v !=NULL && v->type == YJSON_NUMBER);
+    if(v->flags & YJSON_FLAG_INT64)
+        return (double)v->u.i64;
+    if(v->flags & YJSON_FLAG_UINT64)
+        return (double)v->u.u64;
     return v->u.n;
 }
 void yjson_set_number(yjson_value* v, double n) {
@@ -229,3 +4249,112 @@ void yjson_set_number(yjson_value* v, double n) {
     v->type = YJSON_NUMBER;
 }
 
+int yjson_is_int64(const yjson_value* v) {
+    assert(v != NULL);
+    return v->type == YJSON_NUMBER && ((v->flags & YJSON_FLAG_INT64) ||
+        ((v->flags & YJSON_FLAG_UINT64) && v->u.u64 <= (uint64_t)INT64_MAX));
+}
+
+int yjson_is_uint64(const yjson_value* v) {
+    assert(v != NULL);
+    return v->type == YJSON_NUMBER && ((v->flags & YJSON_FLAG_UINT64) ||
+        ((v->flags & YJSON_FLAG_INT64) && v->u.i64 >= 0));
+}
+
+int64_t yjson_get_int64(const yjson_value* v) {
+    assert(v != NULL && v->type == YJSON_NUMBER);
+    if(v->flags & YJSON_FLAG_INT64)
+        return v->u.i64;
+    if(v->flags & YJSON_FLAG_UINT64)
+        return v->u.u64 > (uint64_t)INT64_MAX ? INT64_MAX : (int64_t)v->u.u64;
+    if (v->u.n != v->u.n)
+        return 0;
+    if (v->u.n >= 9223372036854775808.0)
+        return INT64_MAX;
+    if (v->u.n < -9223372036854775808.0)
+        return INT64_MIN;
+    return (int64_t)v->u.n;
+}
+
+uint64_t yjson_get_uint64(const yjson_value* v) {
+    assert(v != NULL && v->type == YJSON_NUMBER);
+    if(v->flags & YJSON_FLAG_UINT64)
+        return v->u.u64;
+    if(v->flags & YJSON_FLAG_INT64)
+        return v->u.i64 < 0 ? 0 : (uint64_t)v->u.i64;
+    if (!(v->u.n > 0.0))
+        return 0;
+    if (v->u.n >= 18446744073709551616.0)
+        return UINT64_MAX;
+    return (uint64_t)v->u.n;
+}
+
+void yjson_set_int64(yjson_value* v, int64_t n) {
+    yjson_free(v);
+    v->u.i64 = n;
+    v->type = YJSON_NUMBER;
+    v->flags = YJSON_FLAG_INT64;
+}
+
+void yjson_set_uint64(yjson_value* v, uint64_t n) {
+    yjson_free(v);
+    v->u.u64 = n;
+    v->type = YJSON_NUMBER;
+    v->flags = YJSON_FLAG_UINT64;
+}
+
+size_t yjson_get_array_size(const yjson_value* v) {
+    assert(v != NULL && v->type == YJSON_ARRAY);
+    return v->u.a.size;
+}
+
+yjson_value* yjson_get_array_element(const yjson_value* v, size_t index) {
+    assert(v != NULL && v->type == YJSON_ARRAY);
+    assert(index < v->u.a.size);
+    return &v->u.a.e[index];
+}
+
+size_t yjson_get_object_size(const yjson_value* v) {
+    assert(v != NULL && v->type == YJSON_OBJECT);
+    return v->u.o.size;
+}
+
+const char* yjson_get_object_key(const yjson_value* v, size_t index) {
+    assert(v != NULL && v->type == YJSON_OBJECT);
+    assert(index < v->u.o.size);
+    return v->u.o.m[index].k;
+}
+
+size_t yjson_get_object_key_length(const yjson_value* v, size_t index) {
+    assert(v != NULL && v->type == YJSON_OBJECT);
+    assert(index < v->u.o.size);
+    return v->u.o.m[index].klen;
+}
+
+yjson_value* yjson_get_object_value(const yjson_value* v, size_t index) {
+    assert(v != NULL && v->type == YJSON_OBJECT);
+    assert(index < v->u.o.size);
+    return &v->u.o.m[index].v;
+}
+
+#define YJSON_KEY_EQ(m, key, klen) ((m)->klen == (klen) && ((klen) == 0 || memcmp((m)->k, key, klen) == 0))
+
+yjson_value* yjson_find_object_value(const yjson_value* v, const char* key, size_t klen) {
+    const yjson_member* m;
+    size_t i;
+    assert(v != NULL && v->type == YJSON_OBJECT && (key != NULL || klen == 0));
+    if (v->flags & YJSON_FLAG_INDEXED) {
+        const uint32_t* index = (const uint32_t*)(v->u.o.m + v->u.o.size);
+        size_t mask = yjson_index_capacity(v->u.o.size) - 1;
+        for (i = yjson_hash(key, klen) & mask; index[i] != 0; i = (i + 1) & mask) {
+            m = &v->u.o.m[index[i] - 1];
+            if (YJSON_KEY_EQ(m, key, klen))
+                return (yjson_value*)&m->v;
+        }
+        return NULL;
+    }
+    for (i = 0, m = v->u.o.m; i < v->u.o.size; i++, m++)
+        if (YJSON_KEY_EQ(m, key, klen))
+            return (yjson_value*)&m->v;
+    return NULL;
+}
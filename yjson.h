@@ -2,10 +2,11 @@
 #define YJSON_H_
 
 #include <stddef.h> /* size_t */
+#include <stdint.h> /* int64_t, uint64_t */
 
 #define yjson_set_null(v) yjson_free(v)
 
-typedef enum{ 
+typedef enum{
     YJSON_NULL,
     YJSON_FALSE,
     YJSON_TRUE,
@@ -16,34 +17,318 @@ typedef enum{
 
 }   yjson_type;
 
-typedef struct {
-    union 
+typedef struct yjson_value yjson_value;
+typedef struct yjson_member yjson_member;
+
+/* 不超过 YJSON_INLINE_MAX 字节的字符串直接存放在值内 */
+#define YJSON_INLINE_MAX 14
+
+/* 数组元素和对象成员在容器闭合时一次性拷贝到一块连续内存中 */
+struct yjson_value {
+    union
     {
+        struct{ yjson_member* m; size_t size;}o;
+        struct{ yjson_value* e; size_t size;}a;
         struct{ char*s ; size_t len;}s;
+        struct{ char s[YJSON_INLINE_MAX + 1]; unsigned char len;}ss; /* YJSON_FLAG_INLINE */
         double n;
+        int64_t i64;
+        uint64_t u64;
     } u;
-    
+
     yjson_type type;
-} yjson_value;
+    unsigned char flags;
+};
+
+/* flags: 值的存储不归该值所有（例如来自 arena），yjson_free 不会释放它 */
+#define YJSON_FLAG_EXTERNAL      0x01
+#define YJSON_FLAG_EXTERNAL_KEYS 0x02 /* 对象的 key 不归该对象所有 */
+#define YJSON_FLAG_INT64         0x04 /* 数字以 u.i64 精确保存 */
+#define YJSON_FLAG_UINT64        0x08 /* 数字以 u.u64 精确保存（大于 INT64_MAX） */
+#define YJSON_FLAG_INDEXED       0x10 /* 对象的成员块之后附有哈希索引 */
+#define YJSON_FLAG_INLINE        0x20 /* 字符串保存在 u.ss 中；移动该值后需重新取指针 */
+
+struct yjson_member {
+    char* k; size_t klen;
+    yjson_value v;
+};
 
 
 enum {
     YJSON_PARSE_OK = 0,
-    YJSON_PARSE_EXPECT_VALUE, // JSON 只含有空白 ,没有值
-    YJSON_PARSE_INVALID_VALUE,// 无效字符
-    YJSON_PARSE_ROOT_NOT_SINGULAR, // 一个值之后 ，除了空白字符，还有其他字符
+    YJSON_PARSE_EXPECT_VALUE, /* JSON 只含有空白 ,没有值 */
+    YJSON_PARSE_INVALID_VALUE,/* 无效字符 */
+    YJSON_PARSE_ROOT_NOT_SINGULAR, /* 一个值之后 ，除了空白字符，还有其他字符 */
     YJSON_PARSE_NUMBER_TOO_BIG,
     YJSON_PARSE_MISS_QUOTATION_MARK,
     YJSON_PARSE_INVALID_STRING_ESCAPE,
-    YJSON_PARSE_INVALID_STRING_CHAR
+    YJSON_PARSE_INVALID_STRING_CHAR,
+    YJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET,
+    YJSON_PARSE_MISS_KEY,
+    YJSON_PARSE_MISS_COLON,
+    YJSON_PARSE_MISS_COMMA_OR_CURLY_BRACKET,
+    YJSON_PARSE_NEED_MORE, /* 流式解析：输入尚未结束 */
+    YJSON_PARSE_CANCELED,  /* 事件回调要求中止解析 */
+    YJSON_PARSE_IO_ERROR,  /* 文件无法打开或映射 */
+    YJSON_PARSE_TOO_LARGE, /* 超出 yjson_doc 的 4 GiB 上限 */
+    YJSON_PARSE_INVALID_UNICODE_HEX,
+    YJSON_PARSE_INVALID_UNICODE_SURROGATE,
+    YJSON_PARSE_INVALID_UTF8, /* 字符串不是合法的 UTF-8（YJSON_PARSE_VALIDATE_UTF8） */
+    YJSON_PARSE_INVALID_BINARY, /* 二进制编码损坏，或来自字节序不同的机器 */
+    YJSON_PARSE_TOO_DEEP   /* 数组和对象嵌套超过 YJSON_PARSE_MAX_DEPTH（默认 1024）层 */
 };
 
 
-#define yjson_init(v) do { (v)->type = YJSON_NULL; } while(0)
+#define yjson_init(v) do { (v)->type = YJSON_NULL; (v)->flags = 0; } while(0)
+
+/*
+ * Bump allocator for whole-document parsing. Every string, key and child
+ * block of a document parsed with yjson_parse_arena() comes out of the arena;
+ * yjson_arena_reset() releases all of them at once and keeps the memory for
+ * the next parse, so a worker reusing one arena stops allocating once it has
+ * seen its largest document.
+ */
+typedef struct yjson_arena_block yjson_arena_block;
+
+typedef struct {
+    char* buf; size_t size, top;    /* block currently being filled */
+    yjson_arena_block* head;        /* blocks owned by the arena */
+    void* user; size_t user_size;   /* caller-supplied first block */
+    size_t block_size;
+    char* stack; size_t stack_size; /* parse stack kept across parses */
+} yjson_arena;
+
 
 
 int yjson_parse(yjson_value* v, const char* json);
 
+/* buf may be NULL, in which case all memory is owned by the arena */
+void yjson_arena_init(yjson_arena* a, void* buf, size_t size);
+void yjson_arena_reset(yjson_arena* a);
+void yjson_arena_free(yjson_arena* a);
+int yjson_parse_arena(yjson_value* v, const char* json, yjson_arena* a);
+
+/*
+ * Parses exactly len bytes, which need not be NUL-terminated; a '\0' among
+ * them is an invalid character like any other control byte. The input is
+ * parsed where it is and nothing past json[len - 1] is read. With
+ * YJSON_PARSE_PADDED the caller promises that the YJSON_PADDING bytes after
+ * json[len - 1] are readable and zero, which lets the scanners skip their
+ * bounds checks (a read() into a buffer one byte larger, or a file mapping
+ * that does not end on a page boundary).
+ * YJSON_PARSE_VALIDATE_UTF8 rejects strings and keys that are not well-formed
+ * UTF-8 with YJSON_PARSE_INVALID_UTF8; otherwise their bytes pass through.
+ */
+#define YJSON_PADDING 1
+#define YJSON_PARSE_PADDED 0x01
+#define YJSON_PARSE_VALIDATE_UTF8 0x02
+
+int yjson_parse_n(yjson_value* v, const char* json, size_t len);
+int yjson_parse_ex(yjson_value* v, const char* json, size_t len, unsigned flags);
+
+/*
+ * Intern table shared by any number of parses. yjson_parse_intern() stores
+ * every object key, and every string value of at most max_value bytes, once
+ * in the table and points the document at that copy, so equal keys compare
+ * equal by pointer. The strings live until the table is destroyed; documents
+ * do not own them. A table must not be used by two threads at once.
+ */
+typedef struct yjson_intern yjson_intern;
+
+yjson_intern* yjson_intern_create(size_t max_value);
+void yjson_intern_destroy(yjson_intern* t);
+/* returns the table's NUL-terminated copy of s, adding it if needed */
+const char* yjson_intern_string(yjson_intern* t, const char* s, size_t len);
+int yjson_parse_intern(yjson_value* v, const char* json, yjson_intern* t);
+
+#ifdef YJSON_STATS
+/*
+ * Parse statistics, compiled in only with -DYJSON_STATS (for the library and
+ * its callers alike). Every tree parse (yjson_parse() and the other
+ * yjson_parse_*() functions that produce a yjson_value) records one call;
+ * yjson_get_stats() returns the last call on this thread and
+ * yjson_get_thread_stats() the sum of all calls on this thread since
+ * yjson_reset_thread_stats(). Summed stats keep the largest stack_peak.
+ */
+typedef struct {
+    size_t calls;
+    size_t bytes;          /* input consumed, up to the error if there was one */
+    size_t values[7];      /* values parsed, indexed by yjson_type */
+    size_t strings;        /* strings and keys */
+    size_t escapes;        /* backslash escapes inside them */
+    size_t stack_peak;     /* bytes of parse stack in use at most */
+    size_t stack_grows;    /* times the parse stack was reallocated */
+    size_t allocs;         /* heap or arena allocations, stack excluded */
+    size_t alloc_bytes;
+    double parse_seconds;  /* whole call, including the phase below */
+    double index_seconds;  /* building object indexes */
+} yjson_stats;
+
+void yjson_get_stats(yjson_stats* s);
+void yjson_get_thread_stats(yjson_stats* s);
+void yjson_reset_thread_stats(void);
+#endif
+
+/*
+ * Destructive parse: strings and keys are unescaped inside json itself and
+ * point into it, so json must outlive v. Its contents are unspecified after
+ * the call.
+ */
+int yjson_parse_insitu(yjson_value* v, char* json);
+
+/*
+ * Reusable parser. yjson_parse_with() is yjson_parse() without the per-call
+ * setup: the parse stack stays allocated between calls, so a worker parsing
+ * many small messages stops allocating it after the first. A call that grows
+ * the stack beyond the parser's limit (YJSON_PARSER_MAX_STACK bytes unless
+ * changed with yjson_parser_set_max_stack(); 0 keeps nothing) shrinks it back
+ * before returning. After yjson_parser_set_arena(p, a) documents are parsed
+ * into a as by yjson_parse_arena(), on the stack a keeps, until the arena is
+ * set back to NULL; the parser only borrows a. A parser must not be used by
+ * two threads at once.
+ */
+typedef struct yjson_parser yjson_parser;
+
+yjson_parser* yjson_parser_create(void);
+void yjson_parser_destroy(yjson_parser* p);
+void yjson_parser_set_max_stack(yjson_parser* p, size_t size);
+void yjson_parser_set_arena(yjson_parser* p, yjson_arena* a);
+int yjson_parse_with(yjson_parser* p, yjson_value* v, const char* json);
+
+/*
+ * Event parsing without building a tree. Each callback returns 0 to go on;
+ * anything else stops the parse, which then returns YJSON_PARSE_CANCELED.
+ * Callbacks left NULL are skipped. Strings and keys are views that are not
+ * NUL-terminated and stay valid only during the call. A number is passed as
+ * a yjson_value to read with yjson_get_number() or yjson_get_int64().
+ * Events for an invalid document may be delivered before the error is found.
+ */
+typedef struct {
+    int (*null_value)(void* user);
+    int (*boolean)(void* user, int b);
+    int (*number)(void* user, const yjson_value* n);
+    int (*string)(void* user, const char* s, size_t len);
+    int (*start_object)(void* user);
+    int (*key)(void* user, const char* k, size_t len);
+    int (*end_object)(void* user, size_t size);
+    int (*start_array)(void* user);
+    int (*end_array)(void* user, size_t size);
+} yjson_handler;
+
+int yjson_parse_sax(const char* json, const yjson_handler* h, void* user);
+
+/*
+ * Incremental parsing of a document that arrives in chunks of any size.
+ * yjson_stream_feed() returns YJSON_PARSE_NEED_MORE while the document is
+ * incomplete, YJSON_PARSE_OK once the root value is complete, or the error
+ * yjson_parse() would report for the same text. A number at the root can
+ * only end with the input, so always call yjson_stream_finish() to obtain
+ * the value; it also resets the stream for the next document.
+ */
+typedef struct yjson_stream yjson_stream;
+
+yjson_stream* yjson_stream_create(void);
+void yjson_stream_destroy(yjson_stream* s);
+void yjson_stream_reset(yjson_stream* s);
+int yjson_stream_feed(yjson_stream* s, const char* chunk, size_t len);
+int yjson_stream_finish(yjson_stream* s, yjson_value* v);
+
+/*
+ * Newline-delimited JSON: one document per line, blank lines skipped. The
+ * records are parsed in batches by a pool of threads, each with its own
+ * context stack and arena, and handed to fn together with their byte offset
+ * and parse status. The value is only valid during the call. Unordered, fn
+ * runs concurrently on the worker threads; ordered, calls come one at a time
+ * in file order. fn returns 0 to go on, anything else to stop with
+ * YJSON_PARSE_CANCELED; calls already under way on other workers finish, but
+ * no new one starts. Records that fail to parse do not stop the run.
+ */
+typedef int (*yjson_record_fn)(void* user, size_t offset, int status, const yjson_value* v);
+
+typedef struct {
+    unsigned threads;  /* 0: one per online CPU */
+    int ordered;       /* deliver records in input order */
+    size_t batch_size; /* bytes claimed by a worker at a time; 0: 1 MiB */
+} yjson_ndjson_options;
+
+/* opt may be NULL for the defaults */
+int yjson_parse_ndjson(const char* json, size_t len, const yjson_ndjson_options* opt, yjson_record_fn fn, void* user);
+int yjson_parse_ndjson_file(const char* path, const yjson_ndjson_options* opt, yjson_record_fn fn, void* user);
+
+/*
+ * Lazy document: yjson_doc_parse() validates json and indexes its tokens
+ * without decoding any of them; nodes are then navigated and decoded on
+ * demand. json is borrowed: nodes point into it, so it must stay valid and
+ * unchanged until d is parsed again or destroyed. A yjson_doc can be reused,
+ * in which case it stops allocating once it has seen its largest document.
+ * Inputs are limited to 4 GiB.
+ *
+ * Paths are member names joined by '.' with array indices in brackets, as in
+ * "a.b[3]"; names holding '.' or '[' need yjson_doc_find(). A missing member,
+ * an index out of range or a type mismatch along the way gives
+ * YJSON_NODE_NONE.
+ */
+typedef struct yjson_doc yjson_doc;
+typedef size_t yjson_node;
+#define YJSON_NODE_NONE ((yjson_node)-1)
+
+yjson_doc* yjson_doc_create(void);
+void yjson_doc_destroy(yjson_doc* d);
+int yjson_doc_parse(yjson_doc* d, const char* json);
+
+yjson_node yjson_doc_get_path(yjson_doc* d, const char* path);
+yjson_node yjson_doc_find(yjson_doc* d, yjson_node n, const char* key, size_t klen);
+yjson_node yjson_doc_get_element(const yjson_doc* d, yjson_node n, size_t index);
+yjson_type yjson_doc_get_type(const yjson_doc* d, yjson_node n);
+size_t yjson_doc_get_size(const yjson_doc* d, yjson_node n);
+int yjson_doc_get_boolean(const yjson_doc* d, yjson_node n);
+double yjson_doc_get_number(const yjson_doc* d, yjson_node n);
+/* not NUL-terminated; valid until the next call on d if it held escapes */
+const char* yjson_doc_get_string(yjson_doc* d, yjson_node n, size_t* len);
+/* copies the node out as an ordinary value, e.g. for an exact integer */
+int yjson_doc_get_value(const yjson_doc* d, yjson_node n, yjson_value* v);
+
+/* returns a NUL-terminated JSON text from YJSON_MALLOC (malloc() by
+ * default); length excludes the NUL. NULL if v nests deeper than
+ * YJSON_PARSE_MAX_DEPTH, which only a value built by hand can. */
+char* yjson_stringify(const yjson_value* v, size_t* length);
+
+/*
+ * Compact binary encoding for caching parsed documents. The encoding holds
+ * no pointers, only offsets from its start, so it can be written to a file
+ * and mapped back anywhere; strings are length-prefixed and NUL-terminated,
+ * numbers keep their native double or exact integer form, and containers
+ * carry offset tables (large objects also a hash index) for direct access.
+ * It is only readable on machines with the same byte order.
+ *
+ * yjson_encode_binary() returns a buffer from YJSON_MALLOC, or NULL if the
+ * encoding would exceed 4 GiB or containers nest deeper than
+ * YJSON_PARSE_MAX_DEPTH (1024 by default), the most yjson_binary_check()
+ * and the parsers accept. yjson_decode_binary() rebuilds a yjson_value.
+ * Alternatively the buffer is read in place through the yjson_binary_*()
+ * accessors, starting from YJSON_BINARY_ROOT; they trust the buffer, so one
+ * that did not come from this process must pass yjson_binary_check() first.
+ */
+#define YJSON_BINARY_ROOT ((yjson_node)12)
+
+char* yjson_encode_binary(const yjson_value* v, size_t* length);
+int yjson_decode_binary(yjson_value* v, const void* data, size_t length);
+
+int yjson_binary_check(const void* data, size_t length);
+yjson_type yjson_binary_get_type(const void* data, yjson_node n);
+/* elements of an array or members of an object */
+size_t yjson_binary_get_size(const void* data, yjson_node n);
+yjson_node yjson_binary_get_element(const void* data, yjson_node n, size_t index);
+const char* yjson_binary_get_key(const void* data, yjson_node n, size_t index, size_t* len);
+yjson_node yjson_binary_get_member(const void* data, yjson_node n, size_t index);
+yjson_node yjson_binary_find(const void* data, yjson_node n, const char* key, size_t klen);
+int yjson_binary_get_boolean(const void* data, yjson_node n);
+double yjson_binary_get_number(const void* data, yjson_node n);
+/* NUL-terminated, inside data */
+const char* yjson_binary_get_string(const void* data, yjson_node n, size_t* len);
+/* copies the node out as an ordinary value, e.g. for an exact integer */
+int yjson_binary_get_value(const void* data, yjson_node n, yjson_value* v);
+
 void yjson_free(yjson_value* v);
 
 yjson_type yjson_get_type(const yjson_value* v);
@@ -57,9 +342,32 @@ void yjson_set_boolean(yjson_value* v, int b);
 double yjson_get_number(const yjson_value* v);
 void yjson_set_number(yjson_value* v, double n);
 
+/*
+ * Integer literals are stored exactly; yjson_is_int64() and yjson_is_uint64()
+ * tell whether v holds one that fits. For any other number the getters
+ * truncate toward zero and saturate at the ends of the range (negative
+ * numbers give 0 as uint64_t, NaN gives 0).
+ */
+int yjson_is_int64(const yjson_value* v);
+int yjson_is_uint64(const yjson_value* v);
+int64_t yjson_get_int64(const yjson_value* v);
+uint64_t yjson_get_uint64(const yjson_value* v);
+void yjson_set_int64(yjson_value* v, int64_t n);
+void yjson_set_uint64(yjson_value* v, uint64_t n);
+
 const char* yjson_get_string(const yjson_value* v);
 size_t yjson_get_string_length(const yjson_value* v);
 void yjson_set_string(yjson_value* v, const char* s, size_t len);
 
+size_t yjson_get_array_size(const yjson_value* v);
+yjson_value* yjson_get_array_element(const yjson_value* v, size_t index);
+
+size_t yjson_get_object_size(const yjson_value* v);
+const char* yjson_get_object_key(const yjson_value* v, size_t index);
+size_t yjson_get_object_key_length(const yjson_value* v, size_t index);
+yjson_value* yjson_get_object_value(const yjson_value* v, size_t index);
+/* the first member named key, or NULL; large objects are looked up by hash */
+yjson_value* yjson_find_object_value(const yjson_value* v, const char* key, size_t klen);
+
 
-#endif
\ No newline at end of file
+#endif